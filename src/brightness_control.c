@@ -3,53 +3,106 @@
  */
 
 #include "brightness_control.h"
+#include "ddc_worker.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-#include <sys/wait.h>
-#include <regex.h>
 
 /* Monitor structure */
 struct _Monitor {
+    int ref_count;           /* Main loop only */
     char *device_path;
     char *display_name;
-    char *model_name;         /* Raw model name from ddccontrol (e.g. "Samsung standard LCD") */
+    char *model_name;         /* Raw model name from EDID or ddccontrol (e.g. "DELL U2719D") */
+    char *identity;           /* Stable EDID identity ("MFG-PRODUCT-SERIAL"), NULL if unknown */
     gboolean available;
     gboolean is_internal;
-    int current_brightness;  /* Last brightness value actually sent to monitor (-1 = unknown) */
+    int current_brightness;  /* Last brightness value confirmed on the monitor by a write or read (-1 = unknown) */
+    gint64 brightness_confirmed_at;   /* Wall-clock time current_brightness was confirmed (us, 0 = never) */
+    gboolean brightness_from_cache;   /* current_brightness was seeded from the persistent cache */
     int target_brightness;   /* Target brightness for gradual transitions (-1 = no transition) */
+    int transition_start_brightness;  /* Brightness the current transition started from */
+    gint64 transition_start_time;     /* Monotonic start of the current transition (us) */
+    gint64 transition_duration;       /* Requested transition duration (us) */
+    BrightnessEasing transition_easing;
+    gboolean transition_manual;       /* Current transition was requested by the user */
     double stable_lux;       /* Last lux value used to set brightness (for hysteresis, -1.0 = unknown) */
+    LightSensorFilter *lux_filter;    /* Light-sensor mode filter chain, created on first use */
+    LightSensorCurve *lux_curve;      /* Compiled lux -> brightness curve, created on first use */
+    DdcQueue *ddc_queue;     /* DDC/CI command queue on the bus worker, created on first command */
+    MonitorHealthState health_state;  /* DDC circuit breaker state */
+    guint failure_count;              /* Consecutive failed DDC commands */
+    guint backoff_ms;                 /* Current backoff (0 = never tripped since last success) */
+    gint64 retry_at;                  /* Monotonic time the open breaker admits a probe (us) */
+
+    /* Statistics (see monitor_append_stats()) */
+    MonitorOpStats op_stats[MONITOR_OP_COUNT];
+    guint retry_count;
+    guint cooldown_count;
+    guint writes_per_minute[60];      /* Ring indexed by minute % 60 */
+    gint64 writes_minute;             /* Monotonic minute of the newest ring slot */
 };
 
-/* Monitor list structure */
+/* Monitor list structure: monitors in order, plus lookup indexes whose keys
+ * are copied when a monitor is added */
 struct _MonitorList {
-    GList *monitors;
+    GPtrArray *monitors;
+    GHashTable *by_device_path;  /* device path -> Monitor* */
+    GHashTable *by_config_key;   /* monitor_get_config_key() -> Monitor* */
 };
 
 /* Create new monitor */
 Monitor* monitor_new(const char *device_path, const char *name)
 {
     Monitor *monitor = g_new0(Monitor, 1);
+    monitor->ref_count = 1;
     monitor->device_path = g_strdup(device_path);
     monitor->display_name = g_strdup(name ? name : device_path);
     monitor->model_name = NULL;
+    monitor->identity = NULL;
     monitor->available = TRUE;
     monitor->is_internal = FALSE;  /* Will be set during detection */
     monitor->current_brightness = -1;  /* Unknown initial brightness */
+    monitor->brightness_confirmed_at = 0;
+    monitor->brightness_from_cache = FALSE;
     monitor->target_brightness = -1;   /* No transition pending */
+    monitor->transition_start_brightness = -1;
+    monitor->transition_start_time = 0;
+    monitor->transition_duration = 0;
+    monitor->transition_easing = BRIGHTNESS_EASING_LINEAR;
+    monitor->transition_manual = FALSE;
     monitor->stable_lux = -1.0;        /* Unknown initial lux */
+    monitor->lux_filter = NULL;
+    monitor->lux_curve = NULL;
+    monitor->ddc_queue = NULL;
+    monitor->health_state = MONITOR_HEALTH_CLOSED;
+    monitor->failure_count = 0;
+    monitor->backoff_ms = 0;
+    monitor->retry_at = 0;
 
     return monitor;
 }
 
-/* Free monitor */
-void monitor_free(Monitor *monitor)
+/* Take a reference to a monitor */
+Monitor* monitor_ref(Monitor *monitor)
 {
     if (monitor) {
+        monitor->ref_count++;
+    }
+    return monitor;
+}
+
+/* Drop a reference; the last one frees the monitor */
+void monitor_unref(Monitor *monitor)
+{
+    if (monitor && --monitor->ref_count == 0) {
+        ddc_queue_detach(monitor->ddc_queue);
+        light_sensor_filter_free(monitor->lux_filter);
+        light_sensor_curve_free(monitor->lux_curve);
         g_free(monitor->device_path);
         g_free(monitor->display_name);
         g_free(monitor->model_name);
+        g_free(monitor->identity);
         g_free(monitor);
     }
 }
@@ -60,6 +113,41 @@ const char* monitor_get_device_path(Monitor *monitor)
     return monitor ? monitor->device_path : NULL;
 }
 
+/* Refresh a monitor from a newer detection of the same physical monitor.
+ * Brightness, transition, lux state and link health are kept, unless the
+ * monitor moved to another bus: then its command queue and health start over. */
+void monitor_update_from(Monitor *monitor, Monitor *detected)
+{
+    if (!monitor || !detected || monitor == detected) {
+        return;
+    }
+
+    if (g_strcmp0(monitor->device_path, detected->device_path) != 0) {
+        ddc_queue_detach(monitor->ddc_queue);
+        monitor->ddc_queue = NULL;
+        monitor->health_state = MONITOR_HEALTH_CLOSED;
+        monitor->failure_count = 0;
+        monitor->backoff_ms = 0;
+        monitor->retry_at = 0;
+        g_free(monitor->device_path);
+        monitor->device_path = g_strdup(detected->device_path);
+    }
+
+    g_free(monitor->display_name);
+    monitor->display_name = g_strdup(detected->display_name);
+    monitor_set_model_name(monitor, detected->model_name);
+    monitor->is_internal = detected->is_internal;
+    monitor->available = TRUE;
+
+    /* A probe that read the brightness is newer than what we know */
+    if (detected->brightness_confirmed_at > monitor->brightness_confirmed_at &&
+        !detected->brightness_from_cache) {
+        monitor->current_brightness = detected->current_brightness;
+        monitor->brightness_confirmed_at = detected->brightness_confirmed_at;
+        monitor->brightness_from_cache = FALSE;
+    }
+}
+
 /* Get monitor display name */
 const char* monitor_get_display_name(Monitor *monitor)
 {
@@ -80,6 +168,27 @@ void monitor_set_model_name(Monitor *monitor, const char *model_name)
     monitor->model_name = model_name ? g_strdup(model_name) : NULL;
 }
 
+/* Get EDID identity */
+const char* monitor_get_identity(Monitor *monitor)
+{
+    return monitor ? monitor->identity : NULL;
+}
+
+/* Set EDID identity */
+void monitor_set_identity(Monitor *monitor, const char *identity)
+{
+    if (!monitor) return;
+    g_free(monitor->identity);
+    monitor->identity = identity ? g_strdup(identity) : NULL;
+}
+
+/* Key for per-monitor settings: EDID identity, or the bus path when unknown */
+const char* monitor_get_config_key(Monitor *monitor)
+{
+    if (!monitor) return NULL;
+    return monitor->identity ? monitor->identity : monitor->device_path;
+}
+
 /* Check if monitor is internal display */
 gboolean monitor_is_internal(const Monitor *monitor)
 {
@@ -94,101 +203,21 @@ void monitor_set_internal(Monitor *monitor, gboolean is_internal)
     }
 }
 
-/* Get current brightness from monitor */
-int monitor_get_brightness(Monitor *monitor)
+/* Get the DDC/CI command queue for a monitor, opening the bus on first use */
+static DdcQueue* monitor_get_ddc_queue(Monitor *monitor)
 {
-    if (!monitor || !monitor->available) {
-        return -1;
-    }
-    
-    /* Execute ddccontrol command to read brightness */
-    char command[256];
-    snprintf(command, sizeof(command), "ddccontrol -r 0x10 dev:%s 2>/dev/null", 
-             monitor->device_path);
-    
-    FILE *fp = popen(command, "r");
-    if (!fp) {
-        g_warning("Failed to execute ddccontrol command");
-        return -1;
+    if (!monitor->ddc_queue) {
+        monitor->ddc_queue = ddc_queue_new(monitor->device_path);
     }
-    
-    char line[512];
-    int brightness = -1;
-
-    /* Compile regex once before the loop for better performance */
-    regex_t regex;
-    regmatch_t matches[3];
-    int regex_compiled = (regcomp(&regex, "Control 0x10: \\+/([0-9]+)/([0-9]+)", REG_EXTENDED) == 0);
-
-    if (!regex_compiled) {
-        g_warning("Failed to compile regex for brightness parsing");
-        pclose(fp);
-        return -1;
-    }
-
-    while (fgets(line, sizeof(line), fp)) {
-        /* Parse output: "Control 0x10: +/current/max [...]" */
-        if (regexec(&regex, line, 3, matches, 0) == 0) {
-            /* Extract current value */
-            char current_str[16];
-            int len = matches[1].rm_eo - matches[1].rm_so;
-            if (len < sizeof(current_str)) {
-                strncpy(current_str, line + matches[1].rm_so, len);
-                current_str[len] = '\0';
-                brightness = atoi(current_str);
-                break;  /* Found match, exit loop */
-            }
-        }
-    }
-
-    regfree(&regex);
-    pclose(fp);
-    
-    if (brightness < 0) {
-        g_warning("Failed to read brightness from monitor %s", monitor->device_path);
-        monitor->available = FALSE;
-    }
-    
-    return brightness;
+    return monitor->ddc_queue;
 }
 
-/* Set monitor brightness */
-gboolean monitor_set_brightness(Monitor *monitor, int brightness)
+/* Record a brightness value the monitor has just confirmed */
+static void monitor_confirm_brightness(Monitor *monitor, int brightness)
 {
-    if (!monitor || !monitor->available) {
-        return FALSE;
-    }
-
-    if (brightness < 0 || brightness > 100) {
-        g_warning("Invalid brightness value: %d", brightness);
-        return FALSE;
-    }
-
-    /* Skip redundant commands - don't send if brightness unchanged */
-    if (monitor->current_brightness == brightness) {
-        g_debug("Brightness unchanged at %d%% for %s, skipping DDC-CI command",
-                brightness, monitor->device_path);
-        return TRUE;  /* Not an error, just unnecessary */
-    }
-
-    /* Execute ddccontrol command to set brightness */
-    char command[256];
-    snprintf(command, sizeof(command), "ddccontrol -r 0x10 -w %d dev:%s >/dev/null 2>&1",
-             brightness, monitor->device_path);
-
-    int result = system(command);
-
-    if (result != 0) {
-        g_warning("Failed to set brightness on monitor %s", monitor->device_path);
-        monitor->available = FALSE;
-        return FALSE;
-    }
-
-    /* Update current brightness tracking on success */
     monitor->current_brightness = brightness;
-    g_debug("Successfully set brightness to %d%% for %s", brightness, monitor->device_path);
-
-    return TRUE;
+    monitor->brightness_confirmed_at = g_get_real_time();
+    monitor->brightness_from_cache = FALSE;
 }
 
 /* Check if monitor is available */
@@ -211,18 +240,145 @@ int monitor_get_current_brightness(Monitor *monitor)
     return monitor ? monitor->current_brightness : -1;
 }
 
+/* Seed the brightness from the persistent cache; a value confirmed this session wins */
+void monitor_seed_brightness(Monitor *monitor, int brightness, gint64 confirmed_at)
+{
+    if (!monitor || monitor->brightness_confirmed_at > 0 || brightness < 0 || brightness > 100) {
+        return;
+    }
+    monitor->current_brightness = brightness;
+    monitor->brightness_confirmed_at = confirmed_at;
+    monitor->brightness_from_cache = TRUE;
+}
+
+/* Wall-clock time the current brightness was confirmed (us, 0 = never) */
+gint64 monitor_get_brightness_confirmed_at(Monitor *monitor)
+{
+    return monitor ? monitor->brightness_confirmed_at : 0;
+}
+
+/* Whether the known brightness should be re-read: seeded from the cache and not
+ * yet confirmed this session, unknown, or older than max_age_seconds */
+gboolean monitor_brightness_needs_revalidation(Monitor *monitor, int max_age_seconds)
+{
+    if (!monitor) {
+        return FALSE;
+    }
+    if (monitor->current_brightness < 0 || monitor->brightness_from_cache) {
+        return TRUE;
+    }
+    return g_get_real_time() - monitor->brightness_confirmed_at > (gint64)max_age_seconds * G_USEC_PER_SEC;
+}
+
 /* Get target brightness (for gradual transitions) */
 int monitor_get_target_brightness(Monitor *monitor)
 {
     return monitor ? monitor->target_brightness : -1;
 }
 
-/* Set target brightness (for gradual transitions) */
+/* Set target brightness directly, without transition timing (-1 cancels the transition) */
 void monitor_set_target_brightness(Monitor *monitor, int brightness)
 {
     if (monitor) {
         monitor->target_brightness = brightness;
+        monitor->transition_start_brightness = monitor->current_brightness;
+        monitor->transition_start_time = g_get_monotonic_time();
+        monitor->transition_duration = 0;
+        monitor->transition_manual = FALSE;
+    }
+}
+
+/* Start a timed transition from the last confirmed brightness to target.
+ * Re-requesting the target that is already in progress keeps the running transition. */
+void monitor_start_transition(Monitor *monitor, int target, guint duration_ms, BrightnessEasing easing,
+                              gboolean manual)
+{
+    if (!monitor || target < 0 || target > 100) {
+        return;
+    }
+
+    if (monitor->target_brightness == target) {
+        return;
+    }
+
+    if (monitor->target_brightness < 0 && monitor->current_brightness == target) {
+        return;
+    }
+
+    monitor->target_brightness = target;
+    monitor->transition_start_brightness = monitor->current_brightness;
+    monitor->transition_start_time = g_get_monotonic_time();
+    monitor->transition_duration = (gint64)duration_ms * 1000;
+    monitor->transition_easing = easing;
+    monitor->transition_manual = manual;
+}
+
+/* Whether the running transition was started by the user (not automatic control) */
+gboolean monitor_is_transition_manual(Monitor *monitor)
+{
+    return monitor && monitor->target_brightness >= 0 && monitor->transition_manual;
+}
+
+/* Apply easing to linear progress in [0, 1] */
+static double apply_easing(BrightnessEasing easing, double t)
+{
+    switch (easing) {
+        case BRIGHTNESS_EASING_EASE_IN_OUT:
+            return t * t * (3.0 - 2.0 * t);
+        case BRIGHTNESS_EASING_LINEAR:
+        default:
+            return t;
+    }
+}
+
+/* Brightness the running transition should be at, at monotonic time now (-1 = no transition) */
+int monitor_get_transition_brightness(Monitor *monitor, gint64 now)
+{
+    if (!monitor || monitor->target_brightness < 0) {
+        return -1;
     }
+
+    int start = monitor->transition_start_brightness;
+    int target = monitor->target_brightness;
+
+    /* Unknown starting point or zero duration: go straight to target */
+    if (start < 0 || monitor->transition_duration <= 0) {
+        return target;
+    }
+
+    double t = (double)(now - monitor->transition_start_time) / (double)monitor->transition_duration;
+    if (t <= 0.0) return start;
+    if (t >= 1.0) return target;
+
+    double delta = (target - start) * apply_easing(monitor->transition_easing, t);
+    return start + (int)(delta >= 0 ? delta + 0.5 : delta - 0.5);
+}
+
+/* Monotonic time at which the running transition should finish (0 = no transition) */
+gint64 monitor_get_transition_end_time(Monitor *monitor)
+{
+    if (!monitor || monitor->target_brightness < 0) {
+        return 0;
+    }
+    return monitor->transition_start_time + monitor->transition_duration;
+}
+
+/* Requested duration of the running transition (us, 0 = none or immediate) */
+gint64 monitor_get_transition_duration(Monitor *monitor)
+{
+    if (!monitor || monitor->target_brightness < 0) {
+        return 0;
+    }
+    return monitor->transition_duration;
+}
+
+/* Average time one brightness write occupies the monitor's bus (ms, 0 = not measured yet) */
+int monitor_get_write_latency_ms(Monitor *monitor)
+{
+    if (!monitor) {
+        return 0;
+    }
+    return (int)(ddc_queue_get_write_latency(monitor->ddc_queue) / 1000);
 }
 
 /* Get stable lux value (last lux used to set brightness) */
@@ -239,73 +395,440 @@ void monitor_set_stable_lux(Monitor *monitor, double lux)
     }
 }
 
-/* Get brightness with auto-refresh retry capability */
-int monitor_get_brightness_with_retry(Monitor *monitor, MonitorRefreshCallback refresh_callback)
+/* Get lux filter */
+LightSensorFilter* monitor_get_lux_filter(Monitor *monitor)
+{
+    return monitor ? monitor->lux_filter : NULL;
+}
+
+/* Set lux filter (takes ownership) */
+void monitor_set_lux_filter(Monitor *monitor, LightSensorFilter *filter)
 {
     if (!monitor) {
+        light_sensor_filter_free(filter);
+        return;
+    }
+
+    if (monitor->lux_filter != filter) {
+        light_sensor_filter_free(monitor->lux_filter);
+        monitor->lux_filter = filter;
+    }
+}
+
+/* Get compiled curve */
+LightSensorCurve* monitor_get_lux_curve(Monitor *monitor)
+{
+    return monitor ? monitor->lux_curve : NULL;
+}
+
+/* Set compiled curve (takes ownership) */
+void monitor_set_lux_curve(Monitor *monitor, LightSensorCurve *curve)
+{
+    if (!monitor) {
+        light_sensor_curve_free(curve);
+        return;
+    }
+
+    if (monitor->lux_curve != curve) {
+        light_sensor_curve_free(monitor->lux_curve);
+        monitor->lux_curve = curve;
+    }
+}
+
+/* Get circuit breaker state */
+MonitorHealthState monitor_get_health_state(Monitor *monitor)
+{
+    return monitor ? monitor->health_state : MONITOR_HEALTH_CLOSED;
+}
+
+/* Circuit breaker state name for logs and diagnostics */
+const char* monitor_health_state_to_string(MonitorHealthState state)
+{
+    switch (state) {
+        case MONITOR_HEALTH_CLOSED:    return "closed";
+        case MONITOR_HEALTH_OPEN:      return "open";
+        case MONITOR_HEALTH_HALF_OPEN: return "half-open";
+        default:                       return "unknown";
+    }
+}
+
+/* Get number of consecutive DDC failures */
+guint monitor_get_failure_count(Monitor *monitor)
+{
+    return monitor ? monitor->failure_count : 0;
+}
+
+/* Get current backoff length */
+guint monitor_get_backoff_ms(Monitor *monitor)
+{
+    return monitor ? monitor->backoff_ms : 0;
+}
+
+/* Milliseconds until the breaker admits another command */
+gint64 monitor_get_retry_delay_ms(Monitor *monitor, gint64 now)
+{
+    if (!monitor || monitor->health_state != MONITOR_HEALTH_OPEN || now >= monitor->retry_at) {
+        return 0;
+    }
+    /* Round up so a timer armed with this delay does not fire early */
+    return (monitor->retry_at - now + 999) / 1000;
+}
+
+/* Decide whether a DDC command may be sent now. An expired backoff admits one
+ * probe (HALF_OPEN); further commands wait until the probe has completed. */
+static gboolean monitor_health_admit(Monitor *monitor)
+{
+    switch (monitor->health_state) {
+        case MONITOR_HEALTH_OPEN:
+            if (g_get_monotonic_time() < monitor->retry_at) {
+                return FALSE;
+            }
+            monitor->health_state = MONITOR_HEALTH_HALF_OPEN;
+            monitor->retry_count++;
+            g_message("Probing DDC link to %s after %u ms backoff", monitor->device_path, monitor->backoff_ms);
+            return TRUE;
+        case MONITOR_HEALTH_HALF_OPEN:
+            return ddc_queue_get_pending(monitor->ddc_queue) == 0;
+        case MONITOR_HEALTH_CLOSED:
+        default:
+            return TRUE;
+    }
+}
+
+/* Feed a DDC command outcome into the circuit breaker */
+static void monitor_health_record(Monitor *monitor, gboolean success)
+{
+    if (success) {
+        if (monitor->health_state != MONITOR_HEALTH_CLOSED) {
+            g_message("DDC link to %s recovered", monitor->device_path);
+        }
+        monitor->health_state = MONITOR_HEALTH_CLOSED;
+        monitor->failure_count = 0;
+        monitor->backoff_ms = 0;
+        monitor->retry_at = 0;
+        return;
+    }
+
+    monitor->failure_count++;
+
+    /* A failed probe reopens; a closed breaker trips after repeated failures */
+    if (monitor->health_state == MONITOR_HEALTH_HALF_OPEN ||
+        (monitor->health_state == MONITOR_HEALTH_CLOSED &&
+         monitor->failure_count >= MONITOR_HEALTH_FAILURE_THRESHOLD)) {
+        monitor->backoff_ms = monitor->backoff_ms > 0
+            ? MIN(monitor->backoff_ms * 2, MONITOR_HEALTH_BACKOFF_MAX_MS)
+            : MONITOR_HEALTH_BACKOFF_INITIAL_MS;
+        monitor->retry_at = g_get_monotonic_time() + (gint64)monitor->backoff_ms * 1000;
+        monitor->health_state = MONITOR_HEALTH_OPEN;
+        monitor->cooldown_count++;
+        g_warning("DDC link to %s failing (%u consecutive failures), pausing commands for %u ms",
+                  monitor->device_path, monitor->failure_count, monitor->backoff_ms);
+    }
+}
+
+/* Histogram bucket for a latency: values below 4 us get their own bucket,
+ * above that each power of two is split into four equal parts */
+static int latency_bucket_index(gint64 latency)
+{
+    if (latency < 4) {
+        return latency > 0 ? (int)latency : 0;
+    }
+
+    int msb = (int)g_bit_storage((gulong)latency) - 1;
+    int index = (msb - 1) * 4 + (int)((latency >> (msb - 2)) & 3);
+    return MIN(index, MONITOR_LATENCY_BUCKETS - 1);
+}
+
+/* Smallest latency that falls into a bucket */
+static gint64 latency_bucket_lower(int index)
+{
+    if (index < 4) {
+        return index;
+    }
+    return (gint64)(4 + index % 4) << (index / 4 - 1);
+}
+
+/* Move the writes-per-minute ring up to the current minute */
+static void monitor_advance_write_ring(Monitor *monitor, gint64 minute)
+{
+    if (minute - monitor->writes_minute >= 60) {
+        memset(monitor->writes_per_minute, 0, sizeof(monitor->writes_per_minute));
+    } else {
+        for (gint64 m = monitor->writes_minute + 1; m <= minute; m++) {
+            monitor->writes_per_minute[m % 60] = 0;
+        }
+    }
+    monitor->writes_minute = MAX(monitor->writes_minute, minute);
+}
+
+/* Record a command that reached the bus */
+static void monitor_stats_record(Monitor *monitor, MonitorOperation op, gboolean success, gint64 latency)
+{
+    MonitorOpStats *stats = &monitor->op_stats[op];
+
+    if (success) {
+        stats->succeeded++;
+    } else {
+        stats->failed++;
+    }
+    stats->latency_counts[latency_bucket_index(latency)]++;
+    stats->latency_max = MAX(stats->latency_max, latency);
+
+    if (op == MONITOR_OP_WRITE) {
+        gint64 minute = g_get_monotonic_time() / (60 * G_USEC_PER_SEC);
+        monitor_advance_write_ring(monitor, minute);
+        monitor->writes_per_minute[minute % 60]++;
+    }
+}
+
+/* Get statistics for one kind of command */
+const MonitorOpStats* monitor_get_op_stats(Monitor *monitor, MonitorOperation op)
+{
+    if (!monitor || op < 0 || op >= MONITOR_OP_COUNT) {
+        return NULL;
+    }
+    return &monitor->op_stats[op];
+}
+
+/* Get number of probes sent after a backoff */
+guint monitor_get_retry_count(Monitor *monitor)
+{
+    return monitor ? monitor->retry_count : 0;
+}
+
+/* Get number of times the circuit breaker opened */
+guint monitor_get_cooldown_count(Monitor *monitor)
+{
+    return monitor ? monitor->cooldown_count : 0;
+}
+
+/* Get number of brightness writes sent in the last 60 minutes */
+guint monitor_get_writes_last_hour(Monitor *monitor)
+{
+    if (!monitor) {
+        return 0;
+    }
+
+    monitor_advance_write_ring(monitor, g_get_monotonic_time() / (60 * G_USEC_PER_SEC));
+
+    guint writes = 0;
+    for (int i = 0; i < 60; i++) {
+        writes += monitor->writes_per_minute[i];
+    }
+    return writes;
+}
+
+/* Latency percentile from the histogram: the upper bound of the bucket that
+ * holds it, capped at the largest latency seen */
+gint64 monitor_op_stats_percentile(const MonitorOpStats *stats, double fraction)
+{
+    guint64 total = stats ? stats->succeeded + stats->failed : 0;
+    if (total == 0) {
         return -1;
     }
 
-    /* First attempt */
-    int brightness = monitor_get_brightness(monitor);
+    guint64 rank = (guint64)(fraction * (double)total + 0.5);
+    rank = CLAMP(rank, 1, total);
 
-    /* If first attempt failed and we have a refresh callback, trigger auto-refresh */
-    if (brightness < 0 && refresh_callback && monitor->available == FALSE) {
-        g_message("Brightness read failed, attempting auto-refresh...");
+    guint64 seen = 0;
+    for (int i = 0; i < MONITOR_LATENCY_BUCKETS; i++) {
+        seen += stats->latency_counts[i];
+        if (seen >= rank) {
+            return MIN(latency_bucket_lower(i + 1), stats->latency_max);
+        }
+    }
+    return stats->latency_max;
+}
+
+/* One line per operation: counters, percentiles and the non-empty buckets */
+static void append_op_stats(GString *report, const char *name, const MonitorOpStats *stats)
+{
+    g_string_append_printf(report, "  %s: %" G_GUINT64_FORMAT " ok, %" G_GUINT64_FORMAT " failed, %"
+                           G_GUINT64_FORMAT " refused",
+                           name, stats->succeeded, stats->failed, stats->refused);
+
+    if (stats->succeeded + stats->failed == 0) {
+        g_string_append(report, "\n");
+        return;
+    }
 
-        /* Trigger refresh - this may recreate monitor objects.
-         * We don't retry here because the monitor pointer may be stale after refresh.
-         * The caller should retry with the updated monitor reference. */
-        if (refresh_callback()) {
-            g_message("Auto-refresh completed - caller should retry with updated monitor");
-        } else {
-            g_warning("Auto-refresh failed");
+    g_string_append_printf(report, "; latency p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+                           monitor_op_stats_percentile(stats, 0.50) / 1000.0,
+                           monitor_op_stats_percentile(stats, 0.90) / 1000.0,
+                           monitor_op_stats_percentile(stats, 0.99) / 1000.0,
+                           stats->latency_max / 1000.0);
+
+    g_string_append_printf(report, "    %s histogram (ms):", name);
+    for (int i = 0; i < MONITOR_LATENCY_BUCKETS; i++) {
+        if (stats->latency_counts[i] > 0) {
+            g_string_append_printf(report, " [%.2f-%.2f) %" G_GUINT64_FORMAT,
+                                   latency_bucket_lower(i) / 1000.0, latency_bucket_lower(i + 1) / 1000.0,
+                                   stats->latency_counts[i]);
         }
     }
+    g_string_append(report, "\n");
+}
+
+/* Append a human-readable statistics report for the monitor */
+void monitor_append_stats(Monitor *monitor, GString *report)
+{
+    if (!monitor || !report) {
+        return;
+    }
+
+    g_string_append_printf(report, "%s [%s]%s\n", monitor->display_name,
+                           monitor_get_config_key(monitor), monitor->available ? "" : " (absent)");
+    g_string_append_printf(report, "  link %s, %u consecutive failures, %u cooldowns, %u retries, "
+                           "%u writes in the last hour\n",
+                           monitor_health_state_to_string(monitor->health_state), monitor->failure_count,
+                           monitor->cooldown_count, monitor->retry_count,
+                           monitor_get_writes_last_hour(monitor));
+    append_op_stats(report, "read", &monitor->op_stats[MONITOR_OP_READ]);
+    append_op_stats(report, "write", &monitor->op_stats[MONITOR_OP_WRITE]);
+}
+
+/* Pending asynchronous brightness command */
+typedef struct {
+    Monitor *monitor;
+    MonitorBrightnessCallback callback;
+    gpointer user_data;
+} BrightnessRequest;
+
+static BrightnessRequest* brightness_request_new(Monitor *monitor, MonitorBrightnessCallback callback,
+                                                 gpointer user_data)
+{
+    BrightnessRequest *request = g_new0(BrightnessRequest, 1);
+    request->monitor = monitor;
+    request->callback = callback;
+    request->user_data = user_data;
+    return request;
+}
+
+/* Bus worker finished a brightness read (main loop) */
+static void on_brightness_read(gboolean success, int value, int max_value, gpointer user_data)
+{
+    (void)max_value;
+    BrightnessRequest *request = (BrightnessRequest*)user_data;
+    Monitor *monitor = request->monitor;
 
-    return brightness;
+    monitor_stats_record(monitor, MONITOR_OP_READ, success, ddc_queue_get_last_elapsed(monitor->ddc_queue));
+
+    if (success) {
+        /* Reads are ordered with writes on the bus, so this is the confirmed value */
+        monitor_confirm_brightness(monitor, value);
+    } else {
+        g_warning("Failed to read brightness from monitor %s", monitor->device_path);
+        value = -1;
+    }
+    monitor_health_record(monitor, success);
+
+    if (request->callback) {
+        request->callback(monitor, value, success, request->user_data);
+    }
 }
 
-/* Set brightness with auto-refresh retry capability */
-gboolean monitor_set_brightness_with_retry(Monitor *monitor, int brightness, MonitorRefreshCallback refresh_callback)
+/* Bus worker finished a brightness write (main loop) */
+static void on_brightness_written(gboolean success, int value, int max_value, gpointer user_data)
+{
+    (void)max_value;
+    BrightnessRequest *request = (BrightnessRequest*)user_data;
+    Monitor *monitor = request->monitor;
+
+    monitor_stats_record(monitor, MONITOR_OP_WRITE, success, ddc_queue_get_last_elapsed(monitor->ddc_queue));
+
+    if (success) {
+        monitor_confirm_brightness(monitor, value);
+        g_debug("Successfully set brightness to %d%% for %s", value, monitor->device_path);
+    } else {
+        g_warning("Failed to set brightness on monitor %s", monitor->device_path);
+    }
+    monitor_health_record(monitor, success);
+
+    if (request->callback) {
+        request->callback(monitor, value, success, request->user_data);
+    }
+}
+
+/* Read brightness on the monitor's bus worker; callback runs on the main loop.
+ * The callback is not invoked if the monitor is freed before completion. */
+void monitor_get_brightness_async(Monitor *monitor, MonitorBrightnessCallback callback, gpointer user_data)
 {
     if (!monitor) {
-        return FALSE;
+        return;
     }
 
-    /* First attempt */
-    gboolean success = monitor_set_brightness(monitor, brightness);
-
-    /* If first attempt failed and we have a refresh callback, trigger auto-refresh
-     * The refresh_callback itself now has rate limiting to prevent runaway loops */
-    if (!success && refresh_callback && monitor->available == FALSE) {
-        /* Only trigger refresh if this is a new failure, not a redundant retry attempt
-         * Skip if brightness value hasn't changed - this prevents feedback loops from
-         * repeated set attempts with the same value */
-        if (monitor->current_brightness != brightness) {
-            g_message("Brightness set failed (monitor unavailable), attempting auto-refresh...");
-
-            /* Trigger refresh - this may recreate monitor objects.
-             * We don't retry here because the monitor pointer may be stale after refresh.
-             * The caller should retry with the updated monitor reference. */
-            if (refresh_callback()) {
-                g_message("Auto-refresh completed - caller should retry with updated monitor");
-            } else {
-                g_warning("Auto-refresh failed");
-            }
-        } else {
-            g_debug("Skipping auto-refresh for redundant brightness set attempt");
+    if (!monitor->available || !monitor_health_admit(monitor)) {
+        if (monitor->available) {
+            monitor->op_stats[MONITOR_OP_READ].refused++;
         }
+        if (callback) {
+            callback(monitor, -1, FALSE, user_data);
+        }
+        return;
     }
 
-    return success;
+    ddc_queue_get_vcp(monitor_get_ddc_queue(monitor), DDC_VCP_BRIGHTNESS,
+                      on_brightness_read, brightness_request_new(monitor, callback, user_data), g_free);
+}
+
+/* Write brightness on the monitor's bus worker; callback runs on the main loop.
+ * Writes are coalesced: while an earlier write is still waiting for the bus it is
+ * replaced by this one (its callback is not invoked), so only the newest value is
+ * sent. current_brightness is updated when the write has been confirmed. */
+void monitor_set_brightness_async(Monitor *monitor, int brightness,
+                                  MonitorBrightnessCallback callback, gpointer user_data)
+{
+    if (!monitor) {
+        return;
+    }
+
+    if (!monitor->available || brightness < 0 || brightness > 100) {
+        if (brightness < 0 || brightness > 100) {
+            g_warning("Invalid brightness value: %d", brightness);
+        }
+        if (callback) {
+            callback(monitor, brightness, FALSE, user_data);
+        }
+        return;
+    }
+
+    /* Skip redundant commands - nothing queued and value already on the monitor */
+    if (monitor->current_brightness == brightness &&
+        ddc_queue_get_pending(monitor->ddc_queue) == 0) {
+        g_debug("Brightness unchanged at %d%% for %s, skipping DDC-CI command",
+                brightness, monitor->device_path);
+        if (callback) {
+            callback(monitor, brightness, TRUE, user_data);
+        }
+        return;
+    }
+
+    if (!monitor_health_admit(monitor)) {
+        monitor->op_stats[MONITOR_OP_WRITE].refused++;
+        g_debug("DDC link to %s is backing off, dropping brightness %d%%", monitor->device_path, brightness);
+        if (callback) {
+            callback(monitor, brightness, FALSE, user_data);
+        }
+        return;
+    }
+
+    ddc_queue_set_vcp_latest(monitor_get_ddc_queue(monitor), DDC_VCP_BRIGHTNESS, brightness,
+                             on_brightness_written, brightness_request_new(monitor, callback, user_data), g_free);
+}
+
+/* Check if DDC commands are queued or running for this monitor */
+gboolean monitor_has_pending_commands(Monitor *monitor)
+{
+    return monitor ? ddc_queue_get_pending(monitor->ddc_queue) > 0 : FALSE;
 }
 
 /* Create new monitor list */
 MonitorList* monitor_list_new(void)
 {
     MonitorList *list = g_new0(MonitorList, 1);
-    list->monitors = NULL;
+    list->monitors = g_ptr_array_new();
+    list->by_device_path = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    list->by_config_key = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
     return list;
 }
 
@@ -313,40 +836,121 @@ MonitorList* monitor_list_new(void)
 void monitor_list_free(MonitorList *list)
 {
     if (list) {
-        g_list_free_full(list->monitors, (GDestroyNotify)monitor_free);
+        g_hash_table_destroy(list->by_device_path);
+        g_hash_table_destroy(list->by_config_key);
+        for (guint i = 0; i < list->monitors->len; i++) {
+            monitor_unref(g_ptr_array_index(list->monitors, i));
+        }
+        g_ptr_array_free(list->monitors, TRUE);
         g_free(list);
     }
 }
 
+/* Add an index entry for a monitor (first monitor wins on duplicate keys) */
+static void index_monitor(GHashTable *index, const char *key, Monitor *monitor)
+{
+    if (key && !g_hash_table_contains(index, key)) {
+        g_hash_table_insert(index, g_strdup(key), monitor);
+    }
+}
+
+/* Drop a monitor's index entry if it points to this monitor */
+static void unindex_monitor(GHashTable *index, const char *key, Monitor *monitor)
+{
+    if (key && g_hash_table_lookup(index, key) == monitor) {
+        g_hash_table_remove(index, key);
+    }
+}
+
 /* Add monitor to list */
 void monitor_list_add(MonitorList *list, Monitor *monitor)
 {
     if (list && monitor) {
-        list->monitors = g_list_append(list->monitors, monitor);
+        g_ptr_array_add(list->monitors, monitor);
+        index_monitor(list->by_device_path, monitor->device_path, monitor);
+        index_monitor(list->by_config_key, monitor_get_config_key(monitor), monitor);
     }
 }
 
 /* Get monitor by index */
 Monitor* monitor_list_get_monitor(MonitorList *list, int index)
 {
-    if (!list || index < 0) {
+    if (!list || index < 0 || (guint)index >= list->monitors->len) {
         return NULL;
     }
-    
-    GList *item = g_list_nth(list->monitors, index);
-    return item ? (Monitor*)item->data : NULL;
+
+    return g_ptr_array_index(list->monitors, index);
 }
 
 /* Get monitor count */
 int monitor_list_get_count(MonitorList *list)
 {
-    return list ? g_list_length(list->monitors) : 0;
+    return list ? (int)list->monitors->len : 0;
+}
+
+/* Adapts a GCompareFunc on monitors to the array's pointer-to-element arguments */
+static gint compare_monitor_entries(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    GCompareFunc *compare_func = user_data;
+    return (*compare_func)(*(Monitor * const *)a, *(Monitor * const *)b);
 }
 
 /* Sort monitor list using provided comparison function */
 void monitor_list_sort(MonitorList *list, GCompareFunc compare_func)
 {
     if (list && compare_func) {
-        list->monitors = g_list_sort(list->monitors, compare_func);
+        g_ptr_array_sort_with_data(list->monitors, compare_monitor_entries, &compare_func);
+    }
+}
+
+/* Find the index of a monitor in the list (-1 if absent) */
+int monitor_list_index_of(MonitorList *list, Monitor *monitor)
+{
+    guint index;
+
+    if (!list || !monitor || !g_ptr_array_find(list->monitors, monitor, &index)) {
+        return -1;
+    }
+    return (int)index;
+}
+
+/* Remove a monitor from the list without freeing it */
+gboolean monitor_list_remove(MonitorList *list, Monitor *monitor)
+{
+    if (!list || !monitor || !g_ptr_array_remove(list->monitors, monitor)) {
+        return FALSE;
     }
-}
\ No newline at end of file
+    unindex_monitor(list->by_device_path, monitor->device_path, monitor);
+    unindex_monitor(list->by_config_key, monitor_get_config_key(monitor), monitor);
+    return TRUE;
+}
+
+/* Find a monitor by its /dev/i2c-N path */
+Monitor* monitor_list_find_by_device_path(MonitorList *list, const char *device_path)
+{
+    return list && device_path ? g_hash_table_lookup(list->by_device_path, device_path) : NULL;
+}
+
+/* Find a monitor by its settings key (EDID identity, or bus path when unknown) */
+Monitor* monitor_list_find_by_config_key(MonitorList *list, const char *config_key)
+{
+    return list && config_key ? g_hash_table_lookup(list->by_config_key, config_key) : NULL;
+}
+
+/* Start iterating a list in order */
+void monitor_list_iter_init(MonitorListIter *iter, MonitorList *list)
+{
+    iter->list = list;
+    iter->index = 0;
+}
+
+/* Advance to the next monitor; FALSE once the list is exhausted */
+gboolean monitor_list_iter_next(MonitorListIter *iter, Monitor **monitor)
+{
+    if (!iter->list || iter->index >= iter->list->monitors->len) {
+        return FALSE;
+    }
+
+    *monitor = g_ptr_array_index(iter->list->monitors, iter->index++);
+    return TRUE;
+}
@@ -6,6 +6,7 @@
 #define BRIGHTNESS_CONTROL_H
 
 #include <glib.h>
+#include "light_sensor.h"
 
 G_BEGIN_DECLS
 
@@ -16,36 +17,136 @@ typedef struct _Monitor Monitor;
 typedef struct _MonitorList MonitorList;
 
 /* Monitor functions */
+/* Monitors are reference counted (main loop only). monitor_new() returns the
+ * first reference; a MonitorList owns one reference per monitor it holds. */
 Monitor* monitor_new(const char *device_path, const char *name);
-void monitor_free(Monitor *monitor);
+Monitor* monitor_ref(Monitor *monitor);
+void monitor_unref(Monitor *monitor);
 void monitor_set_internal(Monitor *monitor, gboolean is_internal);
 
 const char* monitor_get_device_path(Monitor *monitor);
 const char* monitor_get_display_name(Monitor *monitor);
 const char* monitor_get_model_name(Monitor *monitor);
 void monitor_set_model_name(Monitor *monitor, const char *model_name);
+const char* monitor_get_identity(Monitor *monitor);
+void monitor_set_identity(Monitor *monitor, const char *identity);
+/* Take over name, bus and availability from a newer detection of the same
+ * monitor, keeping brightness, transition, lux and (same bus) link state */
+void monitor_update_from(Monitor *monitor, Monitor *detected);
+/* Config key for per-monitor settings: the EDID identity, so settings follow
+ * the monitor across I2C bus renumbering; the device path if there is no EDID */
+const char* monitor_get_config_key(Monitor *monitor);
 gboolean monitor_is_internal(const Monitor *monitor);
 
-int monitor_get_brightness(Monitor *monitor);
-gboolean monitor_set_brightness(Monitor *monitor, int brightness);
 gboolean monitor_is_available(Monitor *monitor);
 void monitor_set_available(Monitor *monitor, gboolean available);
 
 /* Brightness tracking for gradual transitions */
+typedef enum {
+    BRIGHTNESS_EASING_LINEAR = 0,
+    BRIGHTNESS_EASING_EASE_IN_OUT
+} BrightnessEasing;
+
 int monitor_get_current_brightness(Monitor *monitor);
+
+/* Persistent brightness cache support: a seeded value is used right away (UI,
+ * transitions) and flagged for background revalidation. Timestamps are
+ * wall-clock (g_get_real_time()) so they stay meaningful across restarts. */
+void monitor_seed_brightness(Monitor *monitor, int brightness, gint64 confirmed_at);
+gint64 monitor_get_brightness_confirmed_at(Monitor *monitor);
+gboolean monitor_brightness_needs_revalidation(Monitor *monitor, int max_age_seconds);
+
 int monitor_get_target_brightness(Monitor *monitor);
 void monitor_set_target_brightness(Monitor *monitor, int brightness);
+void monitor_start_transition(Monitor *monitor, int target, guint duration_ms, BrightnessEasing easing,
+                              gboolean manual);
+gboolean monitor_is_transition_manual(Monitor *monitor);
+int monitor_get_transition_brightness(Monitor *monitor, gint64 now);
+gint64 monitor_get_transition_end_time(Monitor *monitor);
+gint64 monitor_get_transition_duration(Monitor *monitor);
+int monitor_get_write_latency_ms(Monitor *monitor);
+
+/* DDC link health (per-monitor circuit breaker).
+ * CLOSED: commands flow normally. After MONITOR_HEALTH_FAILURE_THRESHOLD
+ * consecutive failures the breaker OPENs and commands are refused until the
+ * backoff expires; the next command is then sent as a single HALF_OPEN probe.
+ * A successful probe closes the breaker, a failed one reopens it with the
+ * backoff doubled (up to MONITOR_HEALTH_BACKOFF_MAX_MS). */
+typedef enum {
+    MONITOR_HEALTH_CLOSED = 0,
+    MONITOR_HEALTH_OPEN,
+    MONITOR_HEALTH_HALF_OPEN
+} MonitorHealthState;
+
+#define MONITOR_HEALTH_FAILURE_THRESHOLD 3
+#define MONITOR_HEALTH_BACKOFF_INITIAL_MS 2000
+#define MONITOR_HEALTH_BACKOFF_MAX_MS 60000
+
+MonitorHealthState monitor_get_health_state(Monitor *monitor);
+const char* monitor_health_state_to_string(MonitorHealthState state);
+guint monitor_get_failure_count(Monitor *monitor);
+guint monitor_get_backoff_ms(Monitor *monitor);
+/* Milliseconds until the breaker admits another command (0 = now) */
+gint64 monitor_get_retry_delay_ms(Monitor *monitor, gint64 now);
+
+/* DDC command statistics, kept for the monitor's lifetime (a monitor that is
+ * re-detected keeps its object and so its history). Latencies are bus
+ * transaction times in HDR-style log-linear buckets: four per power of two,
+ * so a bucket's bounds are within 25% of any value recorded in it. */
+typedef enum {
+    MONITOR_OP_READ = 0,
+    MONITOR_OP_WRITE,
+    MONITOR_OP_COUNT
+} MonitorOperation;
+
+#define MONITOR_LATENCY_BUCKETS 96  /* Microseconds, up to ~16 s */
+
+typedef struct {
+    guint64 succeeded;
+    guint64 failed;         /* Sent, but the monitor did not answer */
+    guint64 refused;        /* Not sent: the link was backing off */
+    gint64 latency_max;     /* Microseconds */
+    guint64 latency_counts[MONITOR_LATENCY_BUCKETS];
+} MonitorOpStats;
+
+const MonitorOpStats* monitor_get_op_stats(Monitor *monitor, MonitorOperation op);
+guint monitor_get_retry_count(Monitor *monitor);     /* Probes sent after a backoff */
+guint monitor_get_cooldown_count(Monitor *monitor);  /* Times the breaker opened */
+guint monitor_get_writes_last_hour(Monitor *monitor);
+
+/* Latency (microseconds) at or below which the given fraction (0-1) of
+ * completed commands fall, or -1 if none completed */
+gint64 monitor_op_stats_percentile(const MonitorOpStats *stats, double fraction);
+
+/* Append a human-readable statistics report for the monitor */
+void monitor_append_stats(Monitor *monitor, GString *report);
 
 /* Lux tracking for hysteresis */
 double monitor_get_stable_lux(Monitor *monitor);
 void monitor_set_stable_lux(Monitor *monitor, double lux);
 
-/* Enhanced functions with auto-refresh capability */
-typedef gboolean (*MonitorRefreshCallback)(void);
-int monitor_get_brightness_with_retry(Monitor *monitor, MonitorRefreshCallback refresh_callback);
-gboolean monitor_set_brightness_with_retry(Monitor *monitor, int brightness, MonitorRefreshCallback refresh_callback);
+/* Lux filter chain for light-sensor mode. The monitor takes ownership of the
+ * filter passed to set (replacing and freeing any previous one; NULL clears). */
+LightSensorFilter* monitor_get_lux_filter(Monitor *monitor);
+void monitor_set_lux_filter(Monitor *monitor, LightSensorFilter *filter);
+
+/* Compiled light-sensor curve; same ownership rules as the lux filter */
+LightSensorCurve* monitor_get_lux_curve(Monitor *monitor);
+void monitor_set_lux_curve(Monitor *monitor, LightSensorCurve *curve);
 
-/* Monitor list functions */
+/* Asynchronous DDC access: commands run on the monitor's bus worker thread and
+ * the callback is invoked on the main loop (never after the monitor is freed).
+ * While the monitor's circuit breaker refuses commands, the callback is invoked
+ * immediately with success = FALSE and nothing is sent.
+ * Brightness writes are latest-value-wins: a write superseded before it reaches
+ * the bus is dropped without invoking its callback. */
+typedef void (*MonitorBrightnessCallback)(Monitor *monitor, int brightness, gboolean success, gpointer user_data);
+void monitor_get_brightness_async(Monitor *monitor, MonitorBrightnessCallback callback, gpointer user_data);
+void monitor_set_brightness_async(Monitor *monitor, int brightness,
+                                  MonitorBrightnessCallback callback, gpointer user_data);
+gboolean monitor_has_pending_commands(Monitor *monitor);
+
+/* Monitor list functions. Backed by an array: count and indexed access are O(1). */
 MonitorList* monitor_list_new(void);
 void monitor_list_free(MonitorList *list);
 
@@ -53,6 +154,26 @@ void monitor_list_add(MonitorList *list, Monitor *monitor);
 Monitor* monitor_list_get_monitor(MonitorList *list, int index);
 int monitor_list_get_count(MonitorList *list);
 void monitor_list_sort(MonitorList *list, GCompareFunc compare_func);
+int monitor_list_index_of(MonitorList *list, Monitor *monitor);
+gboolean monitor_list_remove(MonitorList *list, Monitor *monitor);  /* List's reference passes to the caller */
+
+/* O(1) lookups. Keys are taken when the monitor is added, so set its identity
+ * before adding it. */
+Monitor* monitor_list_find_by_device_path(MonitorList *list, const char *device_path);
+Monitor* monitor_list_find_by_config_key(MonitorList *list, const char *config_key);
+
+/* In-order iteration without allocation; the list must not change meanwhile.
+ *   MonitorListIter iter;
+ *   Monitor *monitor;
+ *   monitor_list_iter_init(&iter, list);
+ *   while (monitor_list_iter_next(&iter, &monitor)) { ... } */
+typedef struct {
+    MonitorList *list;
+    guint index;
+} MonitorListIter;
+
+void monitor_list_iter_init(MonitorListIter *iter, MonitorList *list);
+gboolean monitor_list_iter_next(MonitorListIter *iter, Monitor **monitor);
 
 G_END_DECLS
 
@@ -0,0 +1,2002 @@
+/*
+ * brightness_engine.c - GTK-free automatic brightness control engine
+ *
+ * Everything that decides and sends brightness lives here: monitor detection
+ * and hotplug reconciliation, the persistent brightness cache, per-mode
+ * automatic targets, gradual transitions on the control loop, and the
+ * suspend/resume and screen blank handling. It depends on GLib/GIO only, so
+ * the same engine runs under the GTK frontend and the headless daemon.
+ */
+
+#include "brightness_engine.h"
+#include "control_loop.h"
+#include "dbus_service.h"
+#include "ddc_ci.h"
+#include "edid.h"
+#include "monitor_detect.h"
+#include <glib-unix.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/inotify.h>
+
+#ifdef HAVE_LIBUDEV
+#include <libudev.h>
+#endif
+
+/* Timer and delay constants */
+#define BRIGHTNESS_TRANSITION_DURATION_MS 2000     /* Duration of automatic brightness transitions */
+#define BRIGHTNESS_TRANSITION_MIN_INTERVAL_MS 50   /* Never step faster than this, whatever the link */
+#define BRIGHTNESS_TRANSITION_MAX_STEPS 8          /* Writes a transition may spread its change over */
+#define MONITOR_RETRY_INITIAL_SECONDS 30
+#define VCP_CACHE_TTL_SECONDS (24 * 60 * 60)  /* Cached brightness older than this is not trusted at startup */
+#define BRIGHTNESS_REVALIDATE_SECONDS 300      /* Re-read a confirmed brightness this old (OSD changes) */
+#define UDEV_DEBOUNCE_ADD_SECONDS 5      /* Longer delay for device addition to allow DDC/CI to stabilize */
+#define UDEV_DEBOUNCE_REMOVE_SECONDS 2   /* Shorter delay for device removal */
+#define POST_RESUME_RESTORE_SECONDS 5    /* Give the DP link time to train before restoring */
+#define BRIGHTNESS_STEP_DURATION_MS 200  /* Hotkey steps: quick, but paced like any transition */
+#define LUX_SAMPLE_MAX_AGE_MS 1000       /* An idle sensor is read again for readings older than this */
+#define LUX_ANNOUNCE_INTERVAL_MS 1000    /* New readings are announced at most this often */
+
+/* Registered listener */
+typedef struct {
+    BrightnessEngineListener func;
+    gpointer user_data;
+} EngineListener;
+
+struct _BrightnessEngine {
+    AppConfig *config;
+    BrightnessScheduler *scheduler;
+    LightSensor *light_sensor;
+    LaptopBacklight *laptop_backlight;
+    PowerManager *power_manager;
+    ControlLoop *control_loop;  /* Arms wakeups only when a transition, retry or filter is due */
+    DbusService *dbus_service;  /* Session bus control and state */
+    guint stats_signal_id;      /* SIGUSR1: log DDC statistics */
+    double announced_lux;       /* Sensor reading last announced with STATUS_CHANGED */
+    gint64 lux_announced_at;    /* Monotonic time of that announcement */
+    guint lux_announce_id;      /* Pending announcement of a newer reading */
+    guint lux_watchers;         /* Frontends showing the live light level */
+    gboolean light_sensor_sampling;
+    gboolean running;           /* Automatic control started (this instance owns the monitors) */
+
+    MonitorList *monitors;
+    MonitorList *absent_monitors;  /* Monitors that went away, kept warm in case they return */
+    GList *listeners;           /* EngineListener* */
+
+    /* Laptop backlight inotify monitoring */
+    int laptop_backlight_inotify_fd;
+    int laptop_backlight_watch_fd;
+    GIOChannel *laptop_backlight_io_channel;
+    guint laptop_backlight_watch_id;
+    int last_laptop_brightness;
+
+    /* Monitor detection retry state */
+    guint monitor_retry_timer;
+    guint recheck_timer_id;
+    guint resume_restore_id;    /* Post-resume brightness restore */
+    int monitor_retry_attempt;
+    gboolean monitors_found;
+    guint monitor_load_generation;  /* Bumped per detection; stale probe results are dropped */
+
+    /* Udev monitoring for hardware changes */
+#ifdef HAVE_LIBUDEV
+    struct udev *udev;
+    struct udev_monitor *udev_monitor;
+    GIOChannel *udev_io_channel;
+    guint udev_watch_id;
+#endif
+};
+
+/* Monitor detection request; outlives the asynchronous bus probe */
+typedef struct {
+    BrightnessEngine *engine;
+    guint generation;       /* Matches engine->monitor_load_generation unless superseded */
+    int retry_attempt;      /* engine->monitor_retry_attempt when the load started */
+    gboolean is_retry;      /* Started from the retry timer */
+    GPtrArray *kept;        /* Installed monitors found again without a probe (referenced) */
+} MonitorLoadRequest;
+
+static void monitor_load_request_free(MonitorLoadRequest *request)
+{
+    if (request->kept) {
+        g_ptr_array_free(request->kept, TRUE);
+    }
+    g_free(request);
+}
+
+static void start_monitor_load(BrightnessEngine *engine, gboolean is_retry, int retry_attempt);
+static gboolean load_monitors_with_retry(gpointer data);
+static gboolean recheck_monitors_immediately(gpointer data);
+static gboolean monitor_matches_candidate(Monitor *monitor, Monitor *candidate);
+static void reconcile_detected_monitors(BrightnessEngine *engine, MonitorList *detected, GPtrArray *kept);
+static const LightSensorCurve* get_monitor_lux_curve(BrightnessEngine *engine, Monitor *monitor);
+
+/* Notify every listener */
+static void emit(BrightnessEngine *engine, BrightnessEngineEvent event, Monitor *monitor)
+{
+    GList *iter = engine->listeners;
+    while (iter) {
+        EngineListener *listener = iter->data;
+        iter = iter->next;  /* A listener may remove itself */
+        listener->func(engine, event, monitor, listener->user_data);
+    }
+}
+
+/* Screen blanked or system suspended: automatic control holds all DDC traffic */
+static gboolean auto_brightness_on_hold(BrightnessEngine *engine)
+{
+    return engine->power_manager &&
+           (power_manager_is_screen_blanked(engine->power_manager) ||
+            power_manager_is_system_suspended(engine->power_manager));
+}
+
+/* Ask the control loop to recompute every monitor's automatic target */
+static void request_auto_brightness_evaluation(BrightnessEngine *engine)
+{
+    control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_EVALUATE, 0);
+}
+
+static void on_light_sensor_sample(LightSensor *sensor, double lux, gpointer user_data);
+
+/* Current light level. The sampler's reading is current while it runs; when it
+ * is stopped the last sample may be arbitrarily old, so read the sensor
+ * unless that sample is recent. */
+static double get_current_lux(BrightnessEngine *engine)
+{
+    double lux;
+    gint64 timestamp;
+
+    if (light_sensor_get_sample(engine->light_sensor, &lux, &timestamp) &&
+        (engine->light_sensor_sampling ||
+         g_get_monotonic_time() - timestamp < LUX_SAMPLE_MAX_AGE_MS * 1000)) {
+        return lux;
+    }
+    return light_sensor_sample_now(engine->light_sensor);
+}
+
+/* Whether some installed monitor follows the light sensor */
+static gboolean light_sensor_mode_in_use(BrightnessEngine *engine)
+{
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        if (config_get_monitor_settings(engine->config, monitor_get_config_key(monitor))->mode ==
+            AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Sample the light sensor only while something uses the reading: a monitor in
+ * light-sensor mode or a frontend showing it. Blanking and suspend stop it,
+ * since nothing may be driven then; without buffered capture every sample is
+ * a timer wakeup. */
+static void update_light_sensor_sampling(BrightnessEngine *engine)
+{
+    if (!light_sensor_is_available(engine->light_sensor)) {
+        return;
+    }
+
+    gboolean wanted = engine->running && !auto_brightness_on_hold(engine) &&
+                      (engine->lux_watchers > 0 || light_sensor_mode_in_use(engine));
+    if (wanted == engine->light_sensor_sampling) {
+        return;
+    }
+
+    engine->light_sensor_sampling = wanted;
+    if (wanted) {
+        light_sensor_start(engine->light_sensor, on_light_sensor_sample, engine);
+    } else {
+        light_sensor_stop(engine->light_sensor);
+        g_debug("Light sensor sampling stopped");
+    }
+}
+
+/* The set of installed monitors changed */
+static void announce_monitors_changed(BrightnessEngine *engine)
+{
+    update_light_sensor_sampling(engine);
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_MONITORS_CHANGED, NULL);
+}
+
+/* Laptop backlight brightness plus the monitor's offset, clamped to 0-100 */
+static int laptop_target_for_monitor(BrightnessEngine *engine, Monitor *monitor, int laptop_brightness)
+{
+    const MonitorSettings *settings = config_get_monitor_settings(engine->config,
+                                                                  monitor_get_config_key(monitor));
+    int target_brightness = laptop_brightness + settings->brightness_offset;
+
+    if (target_brightness < 0) target_brightness = 0;
+    if (target_brightness > 100) target_brightness = 100;
+
+    return target_brightness;
+}
+
+/* Persist a monitor's last confirmed brightness. Returns TRUE if the cache
+ * entry was updated. */
+static gboolean store_brightness_cache(BrightnessEngine *engine, Monitor *monitor)
+{
+    const char *identity = monitor_get_identity(monitor);
+    gint64 confirmed_at = monitor_get_brightness_confirmed_at(monitor);
+    int brightness = monitor_get_current_brightness(monitor);
+
+    if (!identity || confirmed_at <= 0 || brightness < 0) {
+        return FALSE;
+    }
+
+    config_set_vcp_cache(engine->config, identity, DDC_VCP_BRIGHTNESS,
+                         brightness, confirmed_at / G_USEC_PER_SEC);
+    return TRUE;
+}
+
+/* A DDC read or write confirmed a new value: cache it right away so it
+ * survives a crash or power loss. The save is debounced, so a transition's
+ * steps end up in one write. */
+static void persist_confirmed_brightness(BrightnessEngine *engine, Monitor *monitor)
+{
+    if (store_brightness_cache(engine, monitor)) {
+        config_schedule_save(engine->config);
+    }
+}
+
+/* Completion for brightness writes. Failures are handled by the monitor's own
+ * circuit breaker, so a flaky link only pauses that monitor. */
+static void on_monitor_brightness_set(Monitor *monitor, int brightness, gboolean success, gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    if (!success) {
+        g_message("Brightness set to %d%% failed on %s (DDC link %s, %u consecutive failures)",
+                  brightness, monitor_get_device_path(monitor),
+                  monitor_health_state_to_string(monitor_get_health_state(monitor)),
+                  monitor_get_failure_count(monitor));
+        /* A transition keeps its target: the loop resends once the link admits commands */
+        if (monitor_get_target_brightness(monitor) >= 0) {
+            control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_TRANSITION, 0);
+        }
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED, monitor);
+        return;
+    }
+
+    /* The transition's final step has landed */
+    if (monitor_get_target_brightness(monitor) == brightness) {
+        monitor_set_target_brightness(monitor, -1);
+    }
+
+    persist_confirmed_brightness(engine, monitor);
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_BRIGHTNESS_CHANGED, monitor);
+}
+
+/* Background brightness read completed */
+static void on_monitor_brightness_read(Monitor *monitor, int brightness, gboolean success, gpointer data)
+{
+    BrightnessEngine *engine = data;
+    (void)brightness;
+
+    if (!success) {
+        g_message("Brightness read failed on %s (DDC link %s)", monitor_get_device_path(monitor),
+                  monitor_health_state_to_string(monitor_get_health_state(monitor)));
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED, monitor);
+        return;
+    }
+
+    persist_confirmed_brightness(engine, monitor);
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_BRIGHTNESS_CHANGED, monitor);
+}
+
+/* Submit a brightness write. A command admitted after a backoff is the
+ * breaker's HALF_OPEN probe; that change is announced right away rather than
+ * when the probe completes. */
+static void write_monitor_brightness(BrightnessEngine *engine, Monitor *monitor, int brightness)
+{
+    MonitorHealthState health = monitor_get_health_state(monitor);
+
+    monitor_set_brightness_async(monitor, brightness, on_monitor_brightness_set, engine);
+    if (monitor_get_health_state(monitor) != health) {
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED, monitor);
+    }
+}
+
+/* Submit a brightness read; see write_monitor_brightness() */
+static void read_monitor_brightness(BrightnessEngine *engine, Monitor *monitor)
+{
+    MonitorHealthState health = monitor_get_health_state(monitor);
+
+    monitor_get_brightness_async(monitor, on_monitor_brightness_read, engine);
+    if (monitor_get_health_state(monitor) != health) {
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED, monitor);
+    }
+}
+
+/* Seed candidates' brightness from the persistent cache. Only EDID-identified
+ * monitors qualify: a bus path may lead to a different monitor next time. */
+static void seed_brightness_from_cache(BrightnessEngine *engine, GPtrArray *candidates)
+{
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+
+    for (guint i = 0; i < candidates->len; i++) {
+        Monitor *monitor = g_ptr_array_index(candidates, i);
+        const char *identity = monitor_get_identity(monitor);
+        int brightness;
+        gint64 timestamp;
+
+        if (!identity ||
+            !config_get_vcp_cache(engine->config, identity, DDC_VCP_BRIGHTNESS, &brightness, &timestamp)) {
+            continue;
+        }
+        if (now - timestamp > VCP_CACHE_TTL_SECONDS || timestamp > now) {
+            g_debug("Cached brightness for %s expired", identity);
+            continue;
+        }
+
+        monitor_seed_brightness(monitor, brightness, timestamp * G_USEC_PER_SEC);
+        g_debug("Seeded brightness %d%% for %s from cache", brightness, identity);
+    }
+}
+
+/* Persist the brightness of every installed monitor (quit, suspend, reload) */
+static void store_all_brightness_cache(BrightnessEngine *engine)
+{
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        store_brightness_cache(engine, monitor);
+    }
+}
+
+/* Re-read brightness in the background where the known value may be stale */
+static void revalidate_monitor_brightness(BrightnessEngine *engine)
+{
+    for (int i = 0; i < monitor_list_get_count(engine->monitors); i++) {
+        brightness_engine_refresh_brightness(engine, monitor_list_get_monitor(engine->monitors, i));
+    }
+}
+
+/* Move settings saved under a monitor's I2C bus path (from before EDID
+ * identities were used as config keys) to its identity. Once moved, lookups
+ * by identity hit directly no matter which bus the monitor lands on.
+ * Identities that now carry a connector suffix take over the settings saved
+ * under the bare identity. */
+static void migrate_monitor_config_keys(BrightnessEngine *engine)
+{
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        const char *identity = monitor_get_identity(monitor);
+        if (!identity) continue;
+
+        const char *device_path = monitor_get_device_path(monitor);
+        if (config_migrate_monitor_key(engine->config, device_path, identity)) {
+            g_message("Migrated settings for %s from %s to %s",
+                      monitor_get_display_name(monitor), device_path, identity);
+        }
+
+        char *bare_identity = edid_identity_strip_connector(identity);
+        if (config_migrate_monitor_key(engine->config, bare_identity, identity)) {
+            g_message("Migrated settings for %s from %s to %s",
+                      monitor_get_display_name(monitor), bare_identity, identity);
+        }
+        g_free(bare_identity);
+    }
+}
+
+/* No controllable monitors found: schedule the next detection attempt */
+static void handle_no_monitors_found(MonitorLoadRequest *request)
+{
+    BrightnessEngine *engine = request->engine;
+
+    engine->monitors_found = FALSE;
+
+    if (!request->is_retry) {
+        /* Start retry timer if this is the initial load (retry_attempt == 0) */
+        if (request->retry_attempt == 0) {
+            engine->monitor_retry_attempt = 1;
+            engine->monitor_retry_timer = g_timeout_add_seconds(MONITOR_RETRY_INITIAL_SECONDS, load_monitors_with_retry, engine);
+            g_message("No controllable monitors found on startup, will retry in %d seconds...", MONITOR_RETRY_INITIAL_SECONDS);
+        }
+    } else if (request->retry_attempt == 1) {
+        /* Second attempt: retry after 90 seconds from startup (60 more seconds) */
+        engine->monitor_retry_attempt = 2;
+        engine->monitor_retry_timer = g_timeout_add_seconds(60, load_monitors_with_retry, engine);
+        g_message("No controllable monitors found on retry 1, will retry in 60 seconds...");
+    } else if (request->retry_attempt == 2) {
+        /* Third attempt: retry after 180 seconds from startup (90 more seconds) */
+        engine->monitor_retry_attempt = 3;
+        engine->monitor_retry_timer = g_timeout_add_seconds(90, load_monitors_with_retry, engine);
+        g_message("No controllable monitors found on retry 2, will retry in 90 seconds...");
+    } else {
+        /* Final attempt failed, stop retrying */
+        engine->monitor_retry_attempt = 0;
+        g_message("All controllable monitor detection attempts failed");
+    }
+
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED, NULL);
+}
+
+/* Bus probe finished: install the controllable monitors */
+static void on_monitors_filtered(MonitorList *controllable, gpointer user_data)
+{
+    MonitorLoadRequest *request = (MonitorLoadRequest*)user_data;
+    BrightnessEngine *engine = request->engine;
+
+    /* A newer detection started while this one was probing */
+    if (request->generation != engine->monitor_load_generation) {
+        g_debug("Discarding results of superseded monitor detection");
+        if (request->is_retry && engine->monitor_retry_attempt == -1) {
+            engine->monitor_retry_attempt = 0;
+        }
+        monitor_list_free(controllable);
+        monitor_load_request_free(request);
+        return;
+    }
+
+    reconcile_detected_monitors(engine, controllable, request->kept);
+
+    if (monitor_list_get_count(engine->monitors) == 0) {
+        g_message("No controllable monitors found");
+        announce_monitors_changed(engine);
+        handle_no_monitors_found(request);
+        monitor_load_request_free(request);
+        return;
+    }
+
+    /* Controllable monitors found! */
+    engine->monitors_found = TRUE;
+
+    if (request->is_retry) {
+        engine->monitor_retry_attempt = 0;
+        g_message("Controllable monitors detected successfully on retry!");
+    } else if (engine->monitor_retry_timer > 0) {
+        /* Cancel any pending retry timer */
+        g_source_remove(engine->monitor_retry_timer);
+        engine->monitor_retry_timer = 0;
+        engine->monitor_retry_attempt = 0;
+        g_message("Controllable monitors detected successfully!");
+    }
+    monitor_load_request_free(request);
+
+    /* Move any settings still keyed by I2C bus path to EDID identities */
+    migrate_monitor_config_keys(engine);
+
+    announce_monitors_changed(engine);
+
+    /* Monitors accepted from the brightness cache are confirmed in the background */
+    revalidate_monitor_brightness(engine);
+
+    /* Apply automatic modes to the new monitors */
+    request_auto_brightness_evaluation(engine);
+}
+
+/* Start detection; results are reconciled with the installed monitors in
+ * on_monitors_filtered() */
+static void start_monitor_load(BrightnessEngine *engine, gboolean is_retry, int retry_attempt)
+{
+    MonitorLoadRequest *request = g_new0(MonitorLoadRequest, 1);
+    request->engine = engine;
+    request->generation = ++engine->monitor_load_generation;
+    request->retry_attempt = retry_attempt;
+    request->is_retry = is_retry;
+    request->kept = g_ptr_array_new_with_free_func((GDestroyNotify)monitor_unref);
+
+    /* Detect and probe all DDC buses concurrently; monitors with a cached
+     * brightness are accepted without waiting for their probe */
+    GPtrArray *candidates = monitor_detect_list_candidates();
+    if (candidates->len == 0) {
+        g_ptr_array_free(candidates, TRUE);
+        monitor_detect_controllable_async(on_monitors_filtered, request);
+        return;
+    }
+
+    /* Installed monitors still on the same connector are known to be
+     * controllable: keep them as they are instead of probing them again */
+    GPtrArray *unknown = g_ptr_array_new();
+    for (guint c = 0; c < candidates->len; c++) {
+        Monitor *candidate = g_ptr_array_index(candidates, c);
+        Monitor *installed = monitor_list_find_by_device_path(engine->monitors,
+                                                              monitor_get_device_path(candidate));
+        if (installed && monitor_matches_candidate(installed, candidate)) {
+            g_ptr_array_add(request->kept, monitor_ref(installed));
+            monitor_unref(candidate);
+        } else {
+            g_ptr_array_add(unknown, candidate);
+        }
+    }
+    g_ptr_array_free(candidates, TRUE);
+
+    seed_brightness_from_cache(engine, unknown);
+    monitor_detect_probe_async(unknown, on_monitors_filtered, request);
+}
+
+/* Retry monitor detection with delayed intervals */
+static gboolean load_monitors_with_retry(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    /* Clear the timer ID since it's about to complete */
+    engine->monitor_retry_timer = 0;
+
+    /* Try to detect monitors again */
+    g_message("Retrying monitor detection (attempt %d)...", engine->monitor_retry_attempt);
+
+    /* Mark retry in progress so loads started meanwhile don't schedule another retry */
+    int saved_attempt = engine->monitor_retry_attempt;
+    engine->monitor_retry_attempt = -1;  /* Special value to indicate retry in progress */
+
+    start_monitor_load(engine, TRUE, saved_attempt);
+
+    return FALSE; /* Stop the timer */
+}
+
+/* Immediately re-check monitor availability (for hardware disconnect events) */
+static gboolean recheck_monitors_immediately(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    /* Clear the timer ID since we're executing now */
+    engine->recheck_timer_id = 0;
+
+    g_message("Re-checking monitor availability");
+
+    /* Cancel any pending retry timer */
+    if (engine->monitor_retry_timer > 0) {
+        g_source_remove(engine->monitor_retry_timer);
+        engine->monitor_retry_timer = 0;
+    }
+
+    /* Set retry attempt to avoid triggering another retry from the load */
+    engine->monitor_retry_attempt = -2;  /* Special value for manual/auto refresh */
+
+    /* Re-run monitor detection - this will properly filter and select monitors */
+    start_monitor_load(engine, FALSE, engine->monitor_retry_attempt);
+
+    /* Reset retry attempt */
+    engine->monitor_retry_attempt = 0;
+
+    return FALSE; /* Single execution */
+}
+
+/* Same monitor on the same bus: EDID identity and device path both match */
+static gboolean monitor_matches_candidate(Monitor *monitor, Monitor *candidate)
+{
+    return g_strcmp0(monitor_get_device_path(monitor), monitor_get_device_path(candidate)) == 0 &&
+           g_strcmp0(monitor_get_identity(monitor), monitor_get_identity(candidate)) == 0;
+}
+
+/* Take a monitor that went away out of the list. The object is kept, marked
+ * absent, so a monitor that comes back resumes with its state intact. */
+static void remove_monitor_entry(BrightnessEngine *engine, Monitor *monitor)
+{
+    if (monitor_list_index_of(engine->monitors, monitor) < 0) {
+        return;
+    }
+
+    g_message("Monitor disconnected: %s", monitor_get_display_name(monitor));
+
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_MONITOR_REMOVED, monitor);
+    store_brightness_cache(engine, monitor);
+    monitor_list_remove(engine->monitors, monitor);
+    monitor_set_available(monitor, FALSE);
+    monitor_set_target_brightness(monitor, -1);
+
+    /* An older absent object for the same monitor is superseded */
+    Monitor *stale = monitor_list_find_by_config_key(engine->absent_monitors, monitor_get_config_key(monitor));
+    if (stale) {
+        monitor_list_remove(engine->absent_monitors, stale);
+        monitor_unref(stale);
+    }
+    monitor_list_add(engine->absent_monitors, monitor);
+}
+
+/* Install a newly detected monitor (takes the reference). A monitor that was
+ * here before gets its absent object back, updated from the detection. */
+static void install_monitor(BrightnessEngine *engine, Monitor *detected)
+{
+    Monitor *monitor = monitor_list_find_by_config_key(engine->absent_monitors,
+                                                       monitor_get_config_key(detected));
+    if (monitor) {
+        monitor_list_remove(engine->absent_monitors, monitor);
+        monitor_update_from(monitor, detected);
+        monitor_unref(detected);
+        g_debug("Reusing state of returning monitor %s", monitor_get_config_key(monitor));
+    } else {
+        monitor = detected;
+    }
+
+    monitor_list_add(engine->monitors, monitor);
+}
+
+/* Reconcile the installed monitors with a full detection result, by config
+ * key. Monitors found again are updated in place and keep their brightness,
+ * transition, lux and link state; ones not found are removed (kept absent);
+ * new ones are installed. kept lists installed monitors the scan matched
+ * without probing them. Takes ownership of detected. */
+static void reconcile_detected_monitors(BrightnessEngine *engine, MonitorList *detected, GPtrArray *kept)
+{
+    GHashTable *present = g_hash_table_new(NULL, NULL);
+    GPtrArray *arrivals = g_ptr_array_new();
+    GPtrArray *moved = g_ptr_array_new();
+
+    if (!engine->monitors) {
+        engine->monitors = monitor_list_new();
+    }
+
+    for (guint i = 0; kept && i < kept->len; i++) {
+        g_hash_table_add(present, g_ptr_array_index(kept, i));
+    }
+
+    while (monitor_list_get_count(detected) > 0) {
+        Monitor *monitor = monitor_list_get_monitor(detected, 0);
+        monitor_list_remove(detected, monitor);
+
+        Monitor *installed = monitor_list_find_by_config_key(engine->monitors, monitor_get_config_key(monitor));
+        if (!installed) {
+            g_ptr_array_add(arrivals, monitor);
+            continue;
+        }
+
+        if (g_strcmp0(monitor_get_device_path(installed), monitor_get_device_path(monitor)) != 0) {
+            /* Re-added below, so the list indexes it under its new bus */
+            g_message("Monitor %s moved from %s to %s", monitor_get_display_name(installed),
+                      monitor_get_device_path(installed), monitor_get_device_path(monitor));
+            monitor_list_remove(engine->monitors, installed);
+            g_ptr_array_add(moved, installed);
+        }
+        monitor_update_from(installed, monitor);
+        monitor_unref(monitor);
+        g_hash_table_add(present, installed);
+    }
+    monitor_list_free(detected);
+
+    for (int i = monitor_list_get_count(engine->monitors) - 1; i >= 0; i--) {
+        Monitor *monitor = monitor_list_get_monitor(engine->monitors, i);
+        if (!g_hash_table_contains(present, monitor)) {
+            remove_monitor_entry(engine, monitor);
+        }
+    }
+
+    for (guint i = 0; i < moved->len; i++) {
+        monitor_list_add(engine->monitors, g_ptr_array_index(moved, i));
+    }
+    for (guint i = 0; i < arrivals->len; i++) {
+        install_monitor(engine, g_ptr_array_index(arrivals, i));
+    }
+
+    g_ptr_array_free(moved, TRUE);
+    g_ptr_array_free(arrivals, TRUE);
+    g_hash_table_destroy(present);
+}
+
+/* Probe of newly connected monitors finished: append the controllable ones */
+static void on_hotplug_monitors_probed(MonitorList *controllable, gpointer user_data)
+{
+    MonitorLoadRequest *request = (MonitorLoadRequest*)user_data;
+    BrightnessEngine *engine = request->engine;
+    guint generation = request->generation;
+
+    monitor_load_request_free(request);
+
+    /* A full detection or a newer hotplug pass took over meanwhile */
+    if (generation != engine->monitor_load_generation || !engine->monitors) {
+        g_debug("Discarding results of superseded hotplug probe");
+        monitor_list_free(controllable);
+        return;
+    }
+
+    while (monitor_list_get_count(controllable) > 0) {
+        Monitor *monitor = monitor_list_get_monitor(controllable, 0);
+        monitor_list_remove(controllable, monitor);
+
+        g_message("Monitor connected: %s", monitor_get_display_name(monitor));
+        install_monitor(engine, monitor);
+    }
+    monitor_list_free(controllable);
+
+    migrate_monitor_config_keys(engine);
+    engine->monitors_found = (monitor_list_get_count(engine->monitors) > 0);
+    announce_monitors_changed(engine);
+    revalidate_monitor_brightness(engine);
+    request_auto_brightness_evaluation(engine);
+}
+
+/* Bring the monitor list in line with the connectors in sysfs after a hotplug
+ * event. Only monitors that appeared or disappeared are touched: the others keep
+ * their bus queue, confirmed brightness, transition and link health, and only
+ * new arrivals are probed over DDC. */
+static gboolean reconcile_monitors(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    engine->recheck_timer_id = 0;
+
+    /* Nothing installed yet (startup detection still retrying, or everything
+     * was unplugged): run full detection */
+    if (!engine->monitors || monitor_list_get_count(engine->monitors) == 0) {
+        return recheck_monitors_immediately(engine);
+    }
+
+    /* No DRM ddc links: either every external monitor is gone or the driver does
+     * not expose them, which only full detection (ddccontrol -p) can tell apart */
+    GPtrArray *candidates = monitor_detect_list_candidates();
+    if (candidates->len == 0) {
+        g_ptr_array_free(candidates, TRUE);
+        return recheck_monitors_immediately(engine);
+    }
+
+    /* Drop monitors whose connector is gone or now carries a different monitor */
+    for (int i = monitor_list_get_count(engine->monitors) - 1; i >= 0; i--) {
+        Monitor *monitor = monitor_list_get_monitor(engine->monitors, i);
+        gboolean present = FALSE;
+
+        for (guint c = 0; c < candidates->len && !present; c++) {
+            present = monitor_matches_candidate(monitor, g_ptr_array_index(candidates, c));
+        }
+        if (!present) {
+            remove_monitor_entry(engine, monitor);
+        }
+    }
+
+    /* Keep only candidates that are not installed yet */
+    GPtrArray *arrivals = g_ptr_array_new();
+    for (guint c = 0; c < candidates->len; c++) {
+        Monitor *candidate = g_ptr_array_index(candidates, c);
+
+        Monitor *installed = monitor_list_find_by_device_path(engine->monitors,
+                                                              monitor_get_device_path(candidate));
+        if (installed && monitor_matches_candidate(installed, candidate)) {
+            monitor_unref(candidate);
+        } else {
+            g_ptr_array_add(arrivals, candidate);
+        }
+    }
+    g_ptr_array_free(candidates, TRUE);
+
+    engine->monitors_found = (monitor_list_get_count(engine->monitors) > 0);
+    announce_monitors_changed(engine);
+
+    if (arrivals->len == 0) {
+        g_ptr_array_free(arrivals, TRUE);
+        return G_SOURCE_REMOVE;
+    }
+
+    /* Supersede any probe still in flight; it would report the same arrivals */
+    seed_brightness_from_cache(engine, arrivals);
+    MonitorLoadRequest *request = g_new0(MonitorLoadRequest, 1);
+    request->engine = engine;
+    request->generation = ++engine->monitor_load_generation;
+    monitor_detect_probe_async(arrivals, on_hotplug_monitors_probed, request);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Advance gradual brightness transitions.
+ *
+ * Transitions are time-based: each monitor has a start value, target, duration and
+ * easing curve, and every step writes the value the curve calls for at that moment.
+ * Steps are spaced by the transition's duration over BRIGHTNESS_TRANSITION_MAX_STEPS,
+ * and no closer than the monitor's measured DDC write latency, so a change takes a
+ * handful of writes (fewer, larger ones on a slow link) and finishes on time. The target is only cleared once a write of it
+ * succeeds. The next step and any backoff retry are registered with the control
+ * loop only while work remains. */
+static void run_brightness_transitions(BrightnessEngine *engine, gint64 now)
+{
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        int current = monitor_get_current_brightness(monitor);
+        int target = monitor_get_target_brightness(monitor);
+
+        /* Skip if no transition needed */
+        if (target < 0) {
+            continue;
+        }
+        if (current == target) {
+            monitor_set_target_brightness(monitor, -1);
+            continue;
+        }
+
+        /* Link is backing off after failures: come back when it admits a probe.
+         * Other monitors keep transitioning meanwhile. */
+        gint64 retry_ms = monitor_get_retry_delay_ms(monitor, now);
+        if (retry_ms > 0) {
+            control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_RETRY, now + retry_ms * 1000);
+            continue;
+        }
+
+        /* Fastest step rate this monitor's link sustains */
+        gint64 link_ms = MAX(monitor_get_write_latency_ms(monitor),
+                             BRIGHTNESS_TRANSITION_MIN_INTERVAL_MS);
+
+        /* Wait for the previous step to land before sending the next one */
+        if (monitor_has_pending_commands(monitor)) {
+            control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_TRANSITION, now + link_ms * 1000);
+            continue;
+        }
+
+        /* Step spacing: the transition's share per write, or the link's rate if slower */
+        gint64 interval_ms = MAX(link_ms,
+                                 monitor_get_transition_duration(monitor) / 1000 / BRIGHTNESS_TRANSITION_MAX_STEPS);
+
+        /* Value the easing curve calls for now (jumps to target if current is unknown) */
+        int next_brightness = monitor_get_transition_brightness(monitor, now);
+        if (current < 0) {
+            next_brightness = target;
+        }
+
+        if (next_brightness != current) {
+            /* Set the brightness (completes on the bus worker) */
+            write_monitor_brightness(engine, monitor, next_brightness);
+        }
+
+        /* Final step submitted: its completion clears the target, or wakes the
+         * loop to resend it if the write fails */
+        if (next_brightness == target) {
+            continue;
+        }
+
+        /* Next wakeup: when the curve moves by another 1% on average over the
+         * remaining time, but no sooner than the next step is due */
+        gint64 remaining_ms = (monitor_get_transition_end_time(monitor) - now) / 1000;
+        int remaining_steps = ABS(target - next_brightness);
+        gint64 step_ms = remaining_ms > 0 ? remaining_ms / remaining_steps : 0;
+        step_ms = MAX(step_ms, interval_ms);
+
+        control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_TRANSITION, now + step_ms * 1000);
+    }
+}
+
+/* Monitor's lux filter chain, built from its config on first use */
+static LightSensorFilter* get_monitor_lux_filter(BrightnessEngine *engine, Monitor *monitor)
+{
+    LightSensorFilter *filter = monitor_get_lux_filter(monitor);
+    if (!filter) {
+        LightSensorFilterSettings settings;
+        config_get_light_sensor_filter(engine->config, monitor_get_config_key(monitor), &settings);
+        filter = light_sensor_filter_new(&settings);
+        monitor_set_lux_filter(monitor, filter);
+    }
+    return filter;
+}
+
+/* Compile a monitor's light sensor curve from config (or the default curve) */
+static void compile_monitor_lux_curve(BrightnessEngine *engine, Monitor *monitor, const char *reason)
+{
+    const char *monitor_key = monitor_get_config_key(monitor);
+    LightSensorCurvePoint *points = NULL;
+    int count = 0;
+    LightSensorCurve *curve = NULL;
+    LightSensorCurveInterpolation interpolation =
+        config_get_light_sensor_curve_interpolation(engine->config, monitor_key);
+
+    if (config_load_light_sensor_curve(engine->config, monitor_key, &points, &count)) {
+        curve = light_sensor_curve_new(points, count, interpolation);
+        g_free(points);
+    }
+
+    if (curve) {
+        g_message("Compiled %d curve points (%s) for monitor %s [%s]", count,
+                  light_sensor_curve_interpolation_to_string(interpolation), monitor_key, reason);
+    } else {
+        g_message("No curve configured for monitor %s, using defaults [%s]", monitor_key, reason);
+        curve = light_sensor_curve_new_default(interpolation);
+    }
+
+    monitor_set_lux_curve(monitor, curve);
+}
+
+/* Monitor's compiled light sensor curve, built from config on first use */
+static const LightSensorCurve* get_monitor_lux_curve(BrightnessEngine *engine, Monitor *monitor)
+{
+    if (!monitor_get_lux_curve(monitor)) {
+        compile_monitor_lux_curve(engine, monitor, "first use");
+    }
+    return monitor_get_lux_curve(monitor);
+}
+
+/* Light-sensor mode: run a new lux sample through the monitor's filter chain,
+ * or with lux < 0 let the held sample progress through smoothing and dwell.
+ * Returns the brightness for a newly committed lux value, or -1 while the
+ * filtered level stays within hysteresis or has not dwelt long enough.
+ * When the filter has a change pending, an evaluation is scheduled for it. */
+static int light_sensor_target_for_monitor(BrightnessEngine *engine, Monitor *monitor, double lux, gint64 now)
+{
+    if (!light_sensor_is_available(engine->light_sensor)) {
+        return -1;
+    }
+
+    LightSensorFilter *filter = get_monitor_lux_filter(engine, monitor);
+    double stable_lux = monitor_get_stable_lux(monitor);
+    double committed_lux;
+    gboolean committed;
+
+    /* A fresh filter (startup, hotplug, unblank) starts from the latest sample */
+    if (lux < 0 && light_sensor_filter_get_committed_lux(filter) < 0) {
+        lux = light_sensor_get_last_lux(engine->light_sensor);
+    }
+
+    if (lux >= 0) {
+        committed = light_sensor_filter_process(filter, lux, now, &committed_lux);
+    } else {
+        committed = light_sensor_filter_tick(filter, now, &committed_lux);
+    }
+
+    gint64 deadline = light_sensor_filter_get_deadline(filter);
+    if (deadline > 0) {
+        control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_EVALUATE, deadline);
+    }
+
+    if (!committed) {
+        return -1;
+    }
+
+    int target_brightness = light_sensor_curve_evaluate(get_monitor_lux_curve(engine, monitor), committed_lux);
+    monitor_set_stable_lux(monitor, committed_lux);
+
+    g_debug("Light sensor on %s: filtered %.1f lux -> %d%% brightness (was %.1f lux)",
+            monitor_get_display_name(monitor), committed_lux, target_brightness, stable_lux);
+    return target_brightness;
+}
+
+/* Start a gradual transition towards an automatically chosen brightness */
+static void start_auto_brightness_transition(BrightnessEngine *engine, Monitor *monitor, int target_brightness)
+{
+    monitor_start_transition(monitor, target_brightness,
+                             BRIGHTNESS_TRANSITION_DURATION_MS, BRIGHTNESS_EASING_EASE_IN_OUT, FALSE);
+    if (monitor_get_target_brightness(monitor) >= 0) {
+        control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_TRANSITION, 0);
+    }
+
+    g_debug("Set target brightness of %s to %d%% (current: %d%%) for gradual transition",
+            monitor_get_display_name(monitor), target_brightness, monitor_get_current_brightness(monitor));
+}
+
+/* Tell listeners about new targets and the current reading */
+static void announce_status(BrightnessEngine *engine)
+{
+    if (engine->lux_announce_id > 0) {
+        g_source_remove(engine->lux_announce_id);
+        engine->lux_announce_id = 0;
+    }
+
+    engine->announced_lux = light_sensor_get_last_lux(engine->light_sensor);
+    engine->lux_announced_at = g_get_monotonic_time();
+    emit(engine, BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED, NULL);
+}
+
+static gboolean on_lux_announce_timeout(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    engine->lux_announce_id = 0;
+    announce_status(engine);
+    return G_SOURCE_REMOVE;
+}
+
+/* Listeners show the reading (Lux on the bus, tray label). Buffered capture
+ * can deliver many samples a second, so announce at most once per
+ * LUX_ANNOUNCE_INTERVAL_MS; the latest reading always follows. */
+static void schedule_lux_announcement(BrightnessEngine *engine)
+{
+    if (engine->lux_announce_id > 0) {
+        return;
+    }
+
+    gint64 wait_ms = (engine->lux_announced_at - g_get_monotonic_time()) / 1000 + LUX_ANNOUNCE_INTERVAL_MS;
+    if (wait_ms <= 0) {
+        announce_status(engine);
+    } else {
+        engine->lux_announce_id = g_timeout_add(wait_ms, on_lux_announce_timeout, engine);
+    }
+}
+
+/* New ambient light sample: feed it to light-sensor monitors right away */
+static void on_light_sensor_sample(LightSensor *sensor, double lux, gpointer user_data)
+{
+    BrightnessEngine *engine = user_data;
+    (void)sensor;
+
+    /* Unblank and resume request a fresh evaluation; stay off DDC until then */
+    if (auto_brightness_on_hold(engine)) {
+        return;
+    }
+
+    gboolean changed = FALSE;
+    gint64 now = g_get_monotonic_time();
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        AutoBrightnessMode mode = config_get_monitor_settings(engine->config,
+                                                              monitor_get_config_key(monitor))->mode;
+        if (mode != AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
+            continue;
+        }
+
+        int target_brightness = light_sensor_target_for_monitor(engine, monitor, lux, now);
+        if (target_brightness >= 0) {
+            start_auto_brightness_transition(engine, monitor, target_brightness);
+            changed = TRUE;
+        }
+    }
+
+    if (changed) {
+        announce_status(engine);
+    } else if (lux != engine->announced_lux) {
+        schedule_lux_announcement(engine);
+    }
+}
+
+/* Scheduled brightness changed: re-evaluate monitors in schedule mode */
+static void on_schedule_changed(BrightnessScheduler *scheduler, int brightness, gpointer user_data)
+{
+    (void)scheduler;
+    (void)brightness;
+
+    request_auto_brightness_evaluation(user_data);
+}
+
+/* Recompute the automatic target of every monitor from its mode's input */
+static void evaluate_auto_brightness(BrightnessEngine *engine, gint64 now)
+{
+    /* Note: engine->monitors only contains controllable monitors (filtered during detection) */
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        AutoBrightnessMode mode = config_get_monitor_settings(engine->config,
+                                                              monitor_get_config_key(monitor))->mode;
+
+        int target_brightness = -1;
+
+        if (mode == AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE) {
+            /* Scheduled brightness, cached by the scheduler at its last deadline */
+            target_brightness = scheduler_get_current_brightness(engine->scheduler);
+        } else if (mode == AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
+            /* Samples are pushed by on_light_sensor_sample(); this advances the held one */
+            target_brightness = light_sensor_target_for_monitor(engine, monitor, -1.0, now);
+        } else if (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY) {
+            /* Apply laptop display-based brightness */
+            if (laptop_backlight_is_available(engine->laptop_backlight)) {
+                int laptop_brightness = laptop_backlight_read_brightness(engine->laptop_backlight);
+                if (laptop_brightness >= 0) {
+                    target_brightness = laptop_target_for_monitor(engine, monitor, laptop_brightness);
+                    g_debug("Laptop display on %s: %d%% -> %d%% brightness",
+                            monitor_get_display_name(monitor), laptop_brightness, target_brightness);
+                }
+            }
+        }
+
+        /* Set target brightness for gradual transition */
+        if (target_brightness >= 0) {
+            start_auto_brightness_transition(engine, monitor, target_brightness);
+        }
+    }
+}
+
+/* Control loop wakeup: something registered a deadline that is now due */
+static void on_control_loop_due(ControlLoop *loop, guint due, gint64 now, gpointer user_data)
+{
+    BrightnessEngine *engine = user_data;
+    (void)loop;
+
+    /* Nothing is re-armed while on hold: unblank and resume request a new
+     * evaluation, which also resumes any interrupted transition */
+    if (!engine->monitors || auto_brightness_on_hold(engine)) {
+        return;
+    }
+
+    if (due & CONTROL_DEADLINE_MASK(CONTROL_DEADLINE_EVALUATE)) {
+        evaluate_auto_brightness(engine, now);
+    }
+
+    run_brightness_transitions(engine, now);
+
+    if (due & CONTROL_DEADLINE_MASK(CONTROL_DEADLINE_EVALUATE)) {
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED, NULL);
+    }
+}
+
+#ifdef HAVE_LIBUDEV
+/* Whether a udev event can change the set of DDC-capable monitors */
+static gboolean is_display_hotplug_event(struct udev_device *device, const char *action, const char *subsystem)
+{
+    const char *sysname = udev_device_get_sysname(device);
+    gboolean add_or_remove = (strcmp(action, "add") == 0 || strcmp(action, "remove") == 0);
+
+    if (!sysname) {
+        return FALSE;
+    }
+
+    if (strcmp(subsystem, "drm") == 0) {
+        /* Render and control nodes never carry displays */
+        if (!g_str_has_prefix(sysname, "card")) {
+            return FALSE;
+        }
+        /* Connector plug/unplug arrives as "change" on the card with HOTPLUG=1;
+         * MST connectors are added and removed as cardN-<connector> devices */
+        if (strcmp(action, "change") == 0) {
+            return g_strcmp0(udev_device_get_property_value(device, "HOTPLUG"), "1") == 0;
+        }
+        return add_or_remove;
+    }
+
+    /* I2C adapters (docks, MST hubs) and their /dev/i2c-N nodes; not client devices */
+    return add_or_remove && g_str_has_prefix(sysname, "i2c-");
+}
+
+/* Handle udev events */
+static gboolean on_udev_event(GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    BrightnessEngine *engine = data;
+    (void)channel;
+
+    if (condition & G_IO_IN) {
+        struct udev_device *device = udev_monitor_receive_device(engine->udev_monitor);
+        if (device) {
+            const char *action = udev_device_get_action(device);
+            const char *subsystem = udev_device_get_subsystem(device);
+
+            if (action && subsystem && is_display_hotplug_event(device, action, subsystem)) {
+                g_message("%s device %s %s, checking connected monitors",
+                          subsystem, udev_device_get_sysname(device), action);
+
+                /* Debounce udev events: one plug produces several drm and i2c events,
+                 * so each new event restarts the timer and a single pass runs */
+                if (engine->recheck_timer_id > 0) {
+                    g_source_remove(engine->recheck_timer_id);
+                }
+
+                if (strcmp(action, "remove") == 0) {
+                    /* Shorter debounce for removals */
+                    engine->recheck_timer_id = g_timeout_add_seconds(UDEV_DEBOUNCE_REMOVE_SECONDS, reconcile_monitors, engine);
+                } else {
+                    /* Longer debounce to allow DDC/CI hardware to fully stabilize */
+                    engine->recheck_timer_id = g_timeout_add_seconds(UDEV_DEBOUNCE_ADD_SECONDS, reconcile_monitors, engine);
+                }
+            }
+
+            udev_device_unref(device);
+        }
+    }
+
+    return TRUE; /* Keep the watch active */
+}
+
+/* Setup udev monitoring for hardware changes */
+static gboolean setup_udev_monitoring(BrightnessEngine *engine)
+{
+    engine->udev = udev_new();
+    if (!engine->udev) {
+        g_warning("Cannot create udev context");
+        return FALSE;
+    }
+
+    engine->udev_monitor = udev_monitor_new_from_netlink(engine->udev, "udev");
+    if (!engine->udev_monitor) {
+        g_warning("Cannot create udev monitor");
+        udev_unref(engine->udev);
+        engine->udev = NULL;
+        return FALSE;
+    }
+
+    /* Display hotplug shows up on drm and i2c; USB-C/Thunderbolt displays do too,
+     * so unrelated USB devices (mice, keyboards) are not watched at all */
+    udev_monitor_filter_add_match_subsystem_devtype(engine->udev_monitor, "drm", NULL);
+    udev_monitor_filter_add_match_subsystem_devtype(engine->udev_monitor, "i2c", NULL);
+    udev_monitor_filter_add_match_subsystem_devtype(engine->udev_monitor, "i2c-dev", NULL);
+
+    if (udev_monitor_enable_receiving(engine->udev_monitor) < 0) {
+        g_warning("Cannot enable udev monitor");
+        udev_monitor_unref(engine->udev_monitor);
+        udev_unref(engine->udev);
+        engine->udev_monitor = NULL;
+        engine->udev = NULL;
+        return FALSE;
+    }
+
+    /* Create GIO channel to monitor udev events */
+    int fd = udev_monitor_get_fd(engine->udev_monitor);
+    engine->udev_io_channel = g_io_channel_unix_new(fd);
+    engine->udev_watch_id = g_io_add_watch(engine->udev_io_channel, G_IO_IN, on_udev_event, engine);
+
+    g_message("Udev monitoring setup successfully");
+    return TRUE;
+}
+
+/* Cleanup udev monitoring */
+static void cleanup_udev_monitoring(BrightnessEngine *engine)
+{
+    if (engine->udev_watch_id > 0) {
+        g_source_remove(engine->udev_watch_id);
+        engine->udev_watch_id = 0;
+    }
+
+    if (engine->udev_io_channel) {
+        g_io_channel_unref(engine->udev_io_channel);
+        engine->udev_io_channel = NULL;
+    }
+
+    if (engine->udev_monitor) {
+        udev_monitor_unref(engine->udev_monitor);
+        engine->udev_monitor = NULL;
+    }
+
+    if (engine->udev) {
+        udev_unref(engine->udev);
+        engine->udev = NULL;
+    }
+}
+#endif /* HAVE_LIBUDEV */
+
+/* Handle laptop backlight change events */
+static gboolean on_laptop_backlight_change(GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    BrightnessEngine *engine = data;
+    (void)channel;
+
+    if (!(condition & G_IO_IN)) {
+        return TRUE;
+    }
+
+    /* Read and discard inotify events */
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len = read(engine->laptop_backlight_inotify_fd, buffer, sizeof(buffer));
+
+    if (len < 0 && errno != EAGAIN) {
+        g_warning("Error reading inotify events: %s", strerror(errno));
+        return TRUE;
+    }
+
+    /* Read the current laptop brightness */
+    int current_brightness = laptop_backlight_read_brightness(engine->laptop_backlight);
+    if (current_brightness < 0) {
+        return TRUE;
+    }
+
+    /* Check if brightness has actually changed */
+    if (current_brightness == engine->last_laptop_brightness) {
+        return TRUE;  /* No change, ignore */
+    }
+
+    engine->last_laptop_brightness = current_brightness;
+    g_message("Laptop brightness changed to %d%%", current_brightness);
+
+    /* Update all monitors that are in laptop display mode */
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        AutoBrightnessMode mode = config_get_monitor_settings(engine->config,
+                                                              monitor_get_config_key(monitor))->mode;
+
+        if (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY) {
+            int target_brightness = laptop_target_for_monitor(engine, monitor, current_brightness);
+
+            /* Use gradual transition instead of direct DDC command.
+             * When laptop brightness oscillates rapidly during idle/dim events,
+             * direct DDC calls per inotify event can overwhelm the DDC/AUX channel.
+             * The transition engine paces writes to the link's measured latency and
+             * restarts from the last confirmed value if the target changes mid-transition. */
+            start_auto_brightness_transition(engine, monitor, target_brightness);
+
+            g_message("Laptop brightness %d%% -> target %d%% on %s (gradual transition)",
+                      current_brightness, target_brightness, monitor_get_display_name(monitor));
+        }
+    }
+
+    return TRUE;  /* Keep the watch active */
+}
+
+/* Setup inotify monitoring for laptop backlight changes */
+static gboolean setup_laptop_backlight_monitoring(BrightnessEngine *engine)
+{
+    /* Only setup monitoring if laptop backlight is available */
+    if (!laptop_backlight_is_available(engine->laptop_backlight)) {
+        return FALSE;
+    }
+
+    /* Get the backlight device path */
+    const char *device_path = laptop_backlight_get_device_path(engine->laptop_backlight);
+    if (!device_path) {
+        g_warning("Cannot get laptop backlight device path");
+        return FALSE;
+    }
+
+    /* Build the path to the brightness file */
+    char brightness_file[512];
+    snprintf(brightness_file, sizeof(brightness_file), "%s/brightness", device_path);
+
+    /* Create inotify instance */
+    engine->laptop_backlight_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (engine->laptop_backlight_inotify_fd < 0) {
+        g_warning("Failed to create inotify instance for laptop backlight: %s", strerror(errno));
+        return FALSE;
+    }
+
+    /* Watch the brightness file for modifications */
+    engine->laptop_backlight_watch_fd = inotify_add_watch(engine->laptop_backlight_inotify_fd,
+                                                          brightness_file,
+                                                          IN_MODIFY);
+    if (engine->laptop_backlight_watch_fd < 0) {
+        g_warning("Failed to watch laptop backlight file %s: %s", brightness_file, strerror(errno));
+        close(engine->laptop_backlight_inotify_fd);
+        engine->laptop_backlight_inotify_fd = -1;
+        return FALSE;
+    }
+
+    /* Create GIO channel for inotify events */
+    engine->laptop_backlight_io_channel = g_io_channel_unix_new(engine->laptop_backlight_inotify_fd);
+    g_io_channel_set_encoding(engine->laptop_backlight_io_channel, NULL, NULL);
+    g_io_channel_set_buffered(engine->laptop_backlight_io_channel, FALSE);
+
+    /* Setup watch for inotify events */
+    engine->laptop_backlight_watch_id = g_io_add_watch(engine->laptop_backlight_io_channel,
+                                                       G_IO_IN,
+                                                       on_laptop_backlight_change,
+                                                       engine);
+
+    /* Initialize last known brightness */
+    engine->last_laptop_brightness = laptop_backlight_read_brightness(engine->laptop_backlight);
+
+    g_message("Laptop backlight monitoring setup successfully (using inotify)");
+    return TRUE;
+}
+
+/* Cleanup laptop backlight monitoring */
+static void cleanup_laptop_backlight_monitoring(BrightnessEngine *engine)
+{
+    if (engine->laptop_backlight_watch_id > 0) {
+        g_source_remove(engine->laptop_backlight_watch_id);
+        engine->laptop_backlight_watch_id = 0;
+    }
+
+    if (engine->laptop_backlight_io_channel) {
+        g_io_channel_unref(engine->laptop_backlight_io_channel);
+        engine->laptop_backlight_io_channel = NULL;
+    }
+
+    if (engine->laptop_backlight_watch_fd >= 0) {
+        inotify_rm_watch(engine->laptop_backlight_inotify_fd, engine->laptop_backlight_watch_fd);
+        engine->laptop_backlight_watch_fd = -1;
+    }
+
+    if (engine->laptop_backlight_inotify_fd >= 0) {
+        close(engine->laptop_backlight_inotify_fd);
+        engine->laptop_backlight_inotify_fd = -1;
+    }
+}
+
+/* Suspend preparation handler */
+static void on_suspend_prepare(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    /* Mark system as suspended */
+    engine->power_manager->system_suspended = TRUE;
+    update_light_sensor_sampling(engine);
+
+    if (!engine->monitors) {
+        return;
+    }
+
+    g_message("Preparing for system suspend...");
+
+    /* Save current brightness state for all monitors */
+    power_manager_save_brightness_state(engine->power_manager, engine->monitors);
+
+    /* Persist confirmed brightness too, in case the system never resumes */
+    store_all_brightness_cache(engine);
+    config_flush(engine->config);
+
+    g_message("Suspend preparation complete");
+}
+
+/* Called a few seconds after resume to restore DDC brightness once monitors are stable */
+static gboolean post_resume_restore_brightness(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    engine->resume_restore_id = 0;
+    if (engine->power_manager->system_suspended) {
+        return G_SOURCE_REMOVE;
+    }
+
+    /* Each write reports BRIGHTNESS_CHANGED from its completion once it lands */
+    int queued = 0;
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        int brightness = power_manager_get_saved_brightness(engine->power_manager,
+                                                            monitor_get_config_key(monitor));
+        if (brightness < 0 || !monitor_is_available(monitor)) {
+            continue;
+        }
+
+        write_monitor_brightness(engine, monitor, brightness);
+        queued++;
+    }
+
+    if (queued > 0) {
+        g_message("Queued post-resume brightness restore for %d monitor(s)", queued);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Resume recovery handler — called from power_manager on PrepareForSleep(false) */
+static void on_resume_complete(gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    g_message("System resume detected, re-detecting monitors...");
+
+    /* The schedule deadline was armed on the monotonic clock, which stood still */
+    scheduler_rearm(engine->scheduler);
+
+    /* system_suspended is already cleared by power_manager before this callback */
+    update_light_sensor_sampling(engine);
+
+    /* Kick off monitor detection immediately; the retry timer handles the case
+     * where the hardware (UCSI / DP link) isn't ready yet. */
+    start_monitor_load(engine, FALSE, engine->monitor_retry_attempt);
+
+    /* Restore DDC brightness asynchronously after a short delay so we don't
+     * block the main loop and give the DP link time to train. */
+    if (engine->resume_restore_id > 0) {
+        g_source_remove(engine->resume_restore_id);
+    }
+    engine->resume_restore_id = g_timeout_add_seconds(POST_RESUME_RESTORE_SECONDS,
+                                                      post_resume_restore_brightness, engine);
+}
+
+/* Screen blank state changed */
+static void on_screen_blank_changed(gboolean blanked, gpointer data)
+{
+    BrightnessEngine *engine = data;
+
+    if (blanked || !engine->monitors) {
+        update_light_sensor_sampling(engine);
+        return;
+    }
+
+    /* Reset stable_lux on all monitors so the light-sensor mode recalculates
+     * and pushes the correct brightness immediately */
+    g_message("Screen unblanked — resetting brightness state for all monitors");
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        monitor_set_stable_lux(monitor, -1.0);
+        light_sensor_filter_reset(monitor_get_lux_filter(monitor));
+    }
+
+    update_light_sensor_sampling(engine);
+    request_auto_brightness_evaluation(engine);
+}
+
+/* A monitor's typed settings changed in the configuration */
+static void on_monitor_settings_changed(AppConfig *config, const char *monitor_key,
+                                        const MonitorSettings *settings, guint changed,
+                                        gpointer user_data)
+{
+    BrightnessEngine *engine = user_data;
+    (void)config;
+
+    Monitor *monitor = monitor_list_find_by_config_key(engine->monitors, monitor_key);
+    if (monitor) {
+        /* Filters are built from the settings on first use; update existing ones */
+        if ((changed & MONITOR_SETTINGS_LIGHT_SENSOR_FILTER) && monitor_get_lux_filter(monitor)) {
+            light_sensor_filter_set_settings(monitor_get_lux_filter(monitor), &settings->light_sensor_filter);
+        }
+
+        if (changed & MONITOR_SETTINGS_MODE) {
+            update_light_sensor_sampling(engine);
+            emit(engine, BRIGHTNESS_ENGINE_EVENT_MODE_CHANGED, monitor);
+        }
+    }
+
+    /* Laptop-display mode follows a new offset without waiting for a backlight change */
+    if (changed & MONITOR_SETTINGS_BRIGHTNESS_OFFSET) {
+        request_auto_brightness_evaluation(engine);
+    }
+}
+
+/* SIGUSR1: dump DDC statistics to the log */
+static gboolean on_stats_signal(gpointer data)
+{
+    char *report = brightness_engine_format_stats(data);
+    g_message("DDC statistics:\n%s", report);
+    g_free(report);
+    return G_SOURCE_CONTINUE;
+}
+
+/* Create the engine */
+BrightnessEngine* brightness_engine_new(void)
+{
+    BrightnessEngine *engine = g_new0(BrightnessEngine, 1);
+    engine->laptop_backlight_inotify_fd = -1;
+    engine->laptop_backlight_watch_fd = -1;
+    engine->last_laptop_brightness = -1;
+    engine->announced_lux = -1;
+    engine->absent_monitors = monitor_list_new();
+
+    engine->config = config_new();
+    if (!config_load(engine->config)) {
+        g_warning("Failed to load configuration, using defaults");
+    }
+
+    int pruned = config_prune_stale_monitors(engine->config);
+    if (pruned > 0) {
+        g_message("Pruned %d stale monitor(s) from configuration", pruned);
+    }
+    config_set_monitor_settings_callback(engine->config, on_monitor_settings_changed, engine);
+
+    /* Every automatic brightness decision runs from this loop */
+    engine->control_loop = control_loop_new(on_control_loop_due, engine);
+
+    engine->scheduler = scheduler_new();
+    if (!scheduler_load_from_config(engine->scheduler, engine->config)) {
+        /* Load default schedule */
+        scheduler_add_time(engine->scheduler, 9, 0, 70);   /* 9:00 AM - 70% */
+        scheduler_add_time(engine->scheduler, 11, 0, 80);  /* 11:00 AM - 80% */
+        scheduler_add_time(engine->scheduler, 13, 0, 90);  /* 1:00 PM - 90% */
+        scheduler_add_time(engine->scheduler, 15, 0, 85);  /* 3:00 PM - 85% */
+        scheduler_add_time(engine->scheduler, 17, 0, 70);  /* 5:00 PM - 70% */
+        scheduler_add_time(engine->scheduler, 19, 0, 50);  /* 7:00 PM - 50% */
+    }
+
+    /* Initialize light sensor */
+    engine->light_sensor = light_sensor_new();
+    if (light_sensor_is_available(engine->light_sensor)) {
+        g_message("Ambient light sensor available for automatic brightness control");
+    }
+
+    /* Initialize laptop backlight */
+    engine->laptop_backlight = laptop_backlight_new();
+    if (laptop_backlight_is_available(engine->laptop_backlight)) {
+        g_message("Laptop backlight available for automatic brightness control");
+    }
+
+    /* Initialize power manager for suspend/resume handling */
+    engine->power_manager = power_manager_new();
+    power_manager_set_callbacks(engine->power_manager, on_suspend_prepare, on_resume_complete, engine);
+    power_manager_set_blank_callback(engine->power_manager, on_screen_blank_changed, engine);
+
+    return engine;
+}
+
+/* Start detection and automatic control */
+static void start_automatic_control(BrightnessEngine *engine)
+{
+    engine->running = TRUE;
+    scheduler_start(engine->scheduler, on_schedule_changed, engine);
+
+    /* The light sensor is sampled on demand; see update_light_sensor_sampling() */
+    update_light_sensor_sampling(engine);
+
+    if (power_manager_setup_monitoring(engine->power_manager)) {
+        g_message("Suspend/resume monitoring enabled");
+    } else {
+        g_message("Suspend/resume monitoring not available");
+    }
+
+    /* Setup udev monitoring for hardware changes */
+#ifdef HAVE_LIBUDEV
+    setup_udev_monitoring(engine);
+#endif
+
+    /* Setup laptop backlight monitoring for real-time brightness changes */
+    setup_laptop_backlight_monitoring(engine);
+
+    /* There is no periodic tick: sensor samples, schedule boundaries, backlight
+     * and power events request evaluations, and transitions arm their own steps */
+    start_monitor_load(engine, FALSE, engine->monitor_retry_attempt);
+}
+
+/* Bus name settled: drive the monitors unless another instance already does */
+static void on_dbus_service_ready(DbusService *service, gboolean sole_instance, gpointer user_data)
+{
+    BrightnessEngine *engine = user_data;
+    (void)service;
+
+    if (!sole_instance) {
+        g_message("Another instance is already controlling the monitors");
+        emit(engine, BRIGHTNESS_ENGINE_EVENT_ALREADY_RUNNING, NULL);
+        return;
+    }
+
+    start_automatic_control(engine);
+}
+
+void brightness_engine_start(BrightnessEngine *engine)
+{
+    g_return_if_fail(engine != NULL);
+
+    engine->stats_signal_id = g_unix_signal_add(SIGUSR1, on_stats_signal, engine);
+
+    /* Let other desktop tools read and set brightness through us. The name
+     * doubles as the single-instance lock, so nothing touches DDC until it
+     * is ours. */
+    engine->dbus_service = dbus_service_new(engine, on_dbus_service_ready, engine);
+    if (!engine->dbus_service) {
+        start_automatic_control(engine);
+    }
+}
+
+void brightness_engine_free(BrightnessEngine *engine)
+{
+    if (!engine) {
+        return;
+    }
+
+    dbus_service_free(engine->dbus_service);
+    control_loop_free(engine->control_loop);
+
+    if (engine->stats_signal_id > 0) {
+        g_source_remove(engine->stats_signal_id);
+    }
+    if (engine->lux_announce_id > 0) {
+        g_source_remove(engine->lux_announce_id);
+    }
+
+    if (engine->monitor_retry_timer > 0) {
+        g_source_remove(engine->monitor_retry_timer);
+    }
+    if (engine->recheck_timer_id > 0) {
+        g_source_remove(engine->recheck_timer_id);
+    }
+    if (engine->resume_restore_id > 0) {
+        g_source_remove(engine->resume_restore_id);
+    }
+
+#ifdef HAVE_LIBUDEV
+    cleanup_udev_monitoring(engine);
+#endif
+    cleanup_laptop_backlight_monitoring(engine);
+
+    if (engine->monitors) {
+        store_all_brightness_cache(engine);
+        monitor_list_free(engine->monitors);
+    }
+    monitor_list_free(engine->absent_monitors);
+
+    scheduler_free(engine->scheduler);
+    light_sensor_free(engine->light_sensor);
+    laptop_backlight_free(engine->laptop_backlight);
+    power_manager_free(engine->power_manager);
+
+    config_flush(engine->config);
+    config_free(engine->config);
+
+    g_list_free_full(engine->listeners, g_free);
+    g_free(engine);
+}
+
+void brightness_engine_add_listener(BrightnessEngine *engine, BrightnessEngineListener listener,
+                                    gpointer user_data)
+{
+    g_return_if_fail(engine != NULL && listener != NULL);
+
+    EngineListener *entry = g_new0(EngineListener, 1);
+    entry->func = listener;
+    entry->user_data = user_data;
+    engine->listeners = g_list_append(engine->listeners, entry);
+}
+
+void brightness_engine_remove_listener(BrightnessEngine *engine, BrightnessEngineListener listener,
+                                       gpointer user_data)
+{
+    g_return_if_fail(engine != NULL);
+
+    for (GList *iter = engine->listeners; iter; iter = iter->next) {
+        EngineListener *entry = iter->data;
+        if (entry->func == listener && entry->user_data == user_data) {
+            engine->listeners = g_list_delete_link(engine->listeners, iter);
+            g_free(entry);
+            return;
+        }
+    }
+}
+
+AppConfig* brightness_engine_get_config(BrightnessEngine *engine)
+{
+    return engine ? engine->config : NULL;
+}
+
+BrightnessScheduler* brightness_engine_get_scheduler(BrightnessEngine *engine)
+{
+    return engine ? engine->scheduler : NULL;
+}
+
+LightSensor* brightness_engine_get_light_sensor(BrightnessEngine *engine)
+{
+    return engine ? engine->light_sensor : NULL;
+}
+
+LaptopBacklight* brightness_engine_get_laptop_backlight(BrightnessEngine *engine)
+{
+    return engine ? engine->laptop_backlight : NULL;
+}
+
+MonitorList* brightness_engine_get_monitors(BrightnessEngine *engine)
+{
+    return engine ? engine->monitors : NULL;
+}
+
+gboolean brightness_engine_has_monitors(BrightnessEngine *engine)
+{
+    return engine && engine->monitors_found && engine->monitors;
+}
+
+/* Manual refresh: cancel any pending retry and detect from scratch */
+void brightness_engine_reload_monitors(BrightnessEngine *engine)
+{
+    g_return_if_fail(engine != NULL);
+
+    if (engine->monitor_retry_timer > 0) {
+        g_source_remove(engine->monitor_retry_timer);
+        engine->monitor_retry_timer = 0;
+    }
+
+    recheck_monitors_immediately(engine);
+}
+
+void brightness_engine_set_brightness(BrightnessEngine *engine, Monitor *monitor, int brightness)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    /* A running transition would overwrite this value with its next step */
+    monitor_set_target_brightness(monitor, -1);
+
+    /* Writes coalesce per monitor while dragging: only the newest value is sent
+     * once the bus is free, and the final position always lands */
+    write_monitor_brightness(engine, monitor, CLAMP(brightness, 0, 100));
+}
+
+int brightness_engine_step_brightness(BrightnessEngine *engine, Monitor *monitor, int delta)
+{
+    g_return_val_if_fail(engine != NULL && monitor != NULL, -1);
+
+    /* Repeated steps accumulate on the target the previous step set. An
+     * automatic target is not what the screen shows, so step from the current
+     * brightness instead and drop it. */
+    int base;
+    if (monitor_is_transition_manual(monitor)) {
+        base = monitor_get_target_brightness(monitor);
+    } else {
+        base = monitor_get_current_brightness(monitor);
+        if (base < 0) {
+            return -1;
+        }
+        monitor_set_target_brightness(monitor, -1);
+    }
+
+    int brightness = CLAMP(base + delta, 0, 100);
+
+    /* Steps arriving faster than the link can follow (key repeat) only move
+     * the target; the transition sends what the link can take and lands on it */
+    monitor_start_transition(monitor, brightness, BRIGHTNESS_STEP_DURATION_MS, BRIGHTNESS_EASING_LINEAR, TRUE);
+    if (monitor_get_target_brightness(monitor) >= 0) {
+        control_loop_schedule(engine->control_loop, CONTROL_DEADLINE_TRANSITION, 0);
+    }
+
+    return brightness;
+}
+
+void brightness_engine_refresh_brightness(BrightnessEngine *engine, Monitor *monitor)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    if (!monitor_has_pending_commands(monitor) &&
+        monitor_brightness_needs_revalidation(monitor, BRIGHTNESS_REVALIDATE_SECONDS)) {
+        read_monitor_brightness(engine, monitor);
+    }
+}
+
+/* Brightness a mode would set now */
+int brightness_engine_get_mode_brightness(BrightnessEngine *engine, Monitor *monitor,
+                                          AutoBrightnessMode mode)
+{
+    g_return_val_if_fail(engine != NULL && monitor != NULL, -1);
+
+    switch (mode) {
+        case AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE:
+            return scheduler_get_current_brightness(engine->scheduler);
+
+        case AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR:
+            if (light_sensor_is_available(engine->light_sensor)) {
+                double lux = get_current_lux(engine);
+                if (lux >= 0) {
+                    return light_sensor_curve_evaluate(get_monitor_lux_curve(engine, monitor), lux);
+                }
+            }
+            return -1;
+
+        case AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY:
+            if (laptop_backlight_is_available(engine->laptop_backlight)) {
+                int laptop_brightness = laptop_backlight_read_brightness(engine->laptop_backlight);
+                if (laptop_brightness >= 0) {
+                    return laptop_target_for_monitor(engine, monitor, laptop_brightness);
+                }
+            }
+            return -1;
+
+        default:
+            return -1;
+    }
+}
+
+void brightness_engine_set_mode(BrightnessEngine *engine, Monitor *monitor, AutoBrightnessMode mode)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    /* In-memory only; saved with the rest of the configuration. MODE_CHANGED
+     * comes from on_monitor_settings_changed() if the mode actually changed. */
+    config_set_monitor_auto_brightness_mode(engine->config, monitor_get_config_key(monitor), mode);
+}
+
+/* Manual mode change: brightness should change instantly; automatic
+ * adjustments afterwards use gradual transitions */
+void brightness_engine_apply_mode(BrightnessEngine *engine, Monitor *monitor)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    AutoBrightnessMode mode = config_get_monitor_auto_brightness_mode(engine->config,
+                                                                      monitor_get_config_key(monitor));
+    int new_brightness = brightness_engine_get_mode_brightness(engine, monitor, mode);
+    if (new_brightness < 0) {
+        return;
+    }
+
+    if (mode == AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
+        /* Restart filtering from the current level when mode is first enabled */
+        double lux = get_current_lux(engine);
+        LightSensorFilter *filter = get_monitor_lux_filter(engine, monitor);
+        light_sensor_filter_reset(filter);
+        light_sensor_filter_process(filter, lux, g_get_monotonic_time(), NULL);
+        monitor_set_stable_lux(monitor, lux);
+        g_message("Light sensor: %.1f lux -> %d%% brightness (mode enabled, applying immediately)",
+                  lux, new_brightness);
+    } else if (mode == AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE) {
+        g_message("Scheduled brightness: setting immediately to %d%%", new_brightness);
+    } else {
+        g_message("Laptop display: setting immediately to %d%% (offset %d%%)", new_brightness,
+                  config_get_monitor_brightness_offset(engine->config, monitor_get_config_key(monitor)));
+    }
+
+    write_monitor_brightness(engine, monitor, new_brightness);
+
+    /* Clear any pending target brightness (no gradual transition needed) */
+    monitor_set_target_brightness(monitor, -1);
+}
+
+void brightness_engine_set_brightness_offset(BrightnessEngine *engine, Monitor *monitor, int offset)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    config_set_monitor_brightness_offset(engine->config, monitor_get_config_key(monitor), offset);
+    config_schedule_save(engine->config);
+}
+
+void brightness_engine_reload_light_sensor_settings(BrightnessEngine *engine, Monitor *monitor)
+{
+    g_return_if_fail(engine != NULL && monitor != NULL);
+
+    if (!light_sensor_is_available(engine->light_sensor)) {
+        return;
+    }
+
+    /* Filter settings reach the monitor through on_monitor_settings_changed() */
+    compile_monitor_lux_curve(engine, monitor, "settings changed");
+}
+
+double brightness_engine_get_lux(BrightnessEngine *engine)
+{
+    g_return_val_if_fail(engine != NULL, -1.0);
+    return get_current_lux(engine);
+}
+
+void brightness_engine_watch_lux(BrightnessEngine *engine)
+{
+    g_return_if_fail(engine != NULL);
+
+    engine->lux_watchers++;
+    update_light_sensor_sampling(engine);
+}
+
+void brightness_engine_unwatch_lux(BrightnessEngine *engine)
+{
+    g_return_if_fail(engine != NULL && engine->lux_watchers > 0);
+
+    engine->lux_watchers--;
+    update_light_sensor_sampling(engine);
+}
+
+char* brightness_engine_format_stats(BrightnessEngine *engine)
+{
+    g_return_val_if_fail(engine != NULL, NULL);
+
+    GString *report = g_string_new(NULL);
+    MonitorListIter iter;
+    Monitor *monitor;
+
+    monitor_list_iter_init(&iter, engine->monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        monitor_append_stats(monitor, report);
+    }
+
+    /* Absent monitors keep their history; a flaky port shows up here too */
+    monitor_list_iter_init(&iter, engine->absent_monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        monitor_append_stats(monitor, report);
+    }
+
+    if (report->len == 0) {
+        g_string_append(report, "No monitors detected\n");
+    }
+
+    /* Every automatic decision runs from the control loop; this stays flat
+     * while nothing changes */
+    g_string_append_printf(report, "Control loop wakeups: %" G_GUINT64_FORMAT "\n",
+                           control_loop_get_wakeups(engine->control_loop));
+    return g_string_free(report, FALSE);
+}
+
+/* Headless run state */
+typedef struct {
+    GMainLoop *loop;
+    int exit_status;
+} HeadlessRun;
+
+/* Another instance owns the bus name: the headless daemon has nothing to do */
+static void on_headless_engine_event(BrightnessEngine *engine, BrightnessEngineEvent event,
+                                     Monitor *monitor, gpointer user_data)
+{
+    HeadlessRun *run = user_data;
+    (void)engine;
+    (void)monitor;
+
+    if (event == BRIGHTNESS_ENGINE_EVENT_ALREADY_RUNNING) {
+        run->exit_status = 1;
+        g_main_loop_quit(run->loop);
+    }
+}
+
+/* SIGINT/SIGTERM while running headless */
+static gboolean on_quit_signal(gpointer data)
+{
+    g_message("Shutting down");
+    g_main_loop_quit((GMainLoop*)data);
+    return G_SOURCE_CONTINUE;
+}
+
+/* Headless main loop */
+int brightness_engine_run_headless(void)
+{
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    BrightnessEngine *engine = brightness_engine_new();
+
+    guint sigint_id = g_unix_signal_add(SIGINT, on_quit_signal, loop);
+    guint sigterm_id = g_unix_signal_add(SIGTERM, on_quit_signal, loop);
+
+    HeadlessRun run = { loop, 0 };
+    brightness_engine_add_listener(engine, on_headless_engine_event, &run);
+    brightness_engine_start(engine);
+    g_main_loop_run(loop);
+
+    g_source_remove(sigint_id);
+    g_source_remove(sigterm_id);
+    brightness_engine_remove_listener(engine, on_headless_engine_event, &run);
+    brightness_engine_free(engine);
+    g_main_loop_unref(loop);
+
+    return run.exit_status;
+}
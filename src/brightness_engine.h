@@ -0,0 +1,124 @@
+/*
+ * brightness_engine.h - GTK-free automatic brightness control engine
+ */
+
+#ifndef BRIGHTNESS_ENGINE_H
+#define BRIGHTNESS_ENGINE_H
+
+#include <glib.h>
+#include "brightness_control.h"
+#include "config.h"
+#include "scheduler.h"
+#include "light_sensor.h"
+#include "laptop_backlight.h"
+#include "power_management.h"
+
+G_BEGIN_DECLS
+
+/* The engine owns the configuration, the detected monitors and every input
+ * that drives them (scheduler, light sensor, laptop backlight, hotplug,
+ * suspend/resume and screen blanking), and runs brightness transitions on
+ * the default main context. Frontends only observe it through listeners and
+ * ask it to act; it never depends on a toolkit. */
+typedef struct _BrightnessEngine BrightnessEngine;
+
+typedef enum {
+    BRIGHTNESS_ENGINE_EVENT_MONITORS_CHANGED = 0,  /* Monitors were detected, added or removed */
+    BRIGHTNESS_ENGINE_EVENT_MONITOR_REMOVED,       /* monitor was removed from the list (take a reference to keep it) */
+    BRIGHTNESS_ENGINE_EVENT_BRIGHTNESS_CHANGED,    /* A write to monitor landed, or its brightness was re-read */
+    BRIGHTNESS_ENGINE_EVENT_MODE_CHANGED,          /* monitor's automatic mode was changed */
+    BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED,        /* Lux, automatic targets or detection state changed */
+    BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED,        /* A DDC command to monitor failed, or its link state changed */
+    BRIGHTNESS_ENGINE_EVENT_ALREADY_RUNNING        /* Another instance drives the monitors; this one never started */
+} BrightnessEngineEvent;
+
+/* Listener, invoked on the main loop. monitor is NULL for list-wide events. */
+typedef void (*BrightnessEngineListener)(BrightnessEngine *engine, BrightnessEngineEvent event,
+                                         Monitor *monitor, gpointer user_data);
+
+/* Load the configuration and open the sensor, backlight and power manager.
+ * Nothing is detected or driven until brightness_engine_start(). */
+BrightnessEngine* brightness_engine_new(void);
+
+/* Store cached brightness, save the configuration and release everything */
+void brightness_engine_free(BrightnessEngine *engine);
+
+/* Claim the session bus name, then start monitor detection, hotplug and
+ * backlight monitoring, and automatic control. If another instance already
+ * owns the name, nothing is started and ALREADY_RUNNING is emitted instead. */
+void brightness_engine_start(BrightnessEngine *engine);
+
+void brightness_engine_add_listener(BrightnessEngine *engine, BrightnessEngineListener listener,
+                                    gpointer user_data);
+void brightness_engine_remove_listener(BrightnessEngine *engine, BrightnessEngineListener listener,
+                                       gpointer user_data);
+
+/* Components, for frontends that show or edit them */
+AppConfig* brightness_engine_get_config(BrightnessEngine *engine);
+BrightnessScheduler* brightness_engine_get_scheduler(BrightnessEngine *engine);
+LightSensor* brightness_engine_get_light_sensor(BrightnessEngine *engine);
+LaptopBacklight* brightness_engine_get_laptop_backlight(BrightnessEngine *engine);
+
+/* Installed controllable monitors (NULL while none are) */
+MonitorList* brightness_engine_get_monitors(BrightnessEngine *engine);
+gboolean brightness_engine_has_monitors(BrightnessEngine *engine);
+
+/* Drop the current monitors and run full detection again */
+void brightness_engine_reload_monitors(BrightnessEngine *engine);
+
+/* Manual brightness write (latest value wins while dragging). Cancels any
+ * running transition but leaves the automatic mode alone; see
+ * brightness_engine_set_mode(). */
+void brightness_engine_set_brightness(BrightnessEngine *engine, Monitor *monitor, int brightness);
+
+/* Manual step, applied as a short transition. Relative to the target of a
+ * step still in progress, so rapid repeats accumulate into one target;
+ * otherwise relative to the current brightness, cancelling any automatic
+ * transition. Returns the new target, or -1 if the current brightness is not
+ * known yet. */
+int brightness_engine_step_brightness(BrightnessEngine *engine, Monitor *monitor, int delta);
+
+/* Re-read a monitor's brightness in the background if the known value may be
+ * stale; a BRIGHTNESS_CHANGED event follows when it completes */
+void brightness_engine_refresh_brightness(BrightnessEngine *engine, Monitor *monitor);
+
+/* Brightness a monitor's automatic mode calls for right now, without applying
+ * it (-1 = unknown or the mode is disabled) */
+int brightness_engine_get_mode_brightness(BrightnessEngine *engine, Monitor *monitor,
+                                          AutoBrightnessMode mode);
+
+/* Store a monitor's automatic mode and notify listeners. The new mode's
+ * brightness is not applied; call brightness_engine_apply_mode() for that. */
+void brightness_engine_set_mode(BrightnessEngine *engine, Monitor *monitor, AutoBrightnessMode mode);
+
+/* Apply a monitor's configured automatic mode immediately (not gradually),
+ * after the user selected it */
+void brightness_engine_apply_mode(BrightnessEngine *engine, Monitor *monitor);
+
+/* Store a monitor's laptop-display brightness offset and follow it */
+void brightness_engine_set_brightness_offset(BrightnessEngine *engine, Monitor *monitor, int offset);
+
+/* Recompile a monitor's curve and reload its filter settings from config */
+void brightness_engine_reload_light_sensor_settings(BrightnessEngine *engine, Monitor *monitor);
+
+/* The light sensor is sampled only while a monitor is in light-sensor mode or
+ * a frontend shows the live reading, and never while the screen is blanked or
+ * the system is suspended. Frontends call watch while the reading is visible
+ * (tray label, curve dialog) and unwatch when it no longer is. */
+void brightness_engine_watch_lux(BrightnessEngine *engine);
+void brightness_engine_unwatch_lux(BrightnessEngine *engine);
+
+/* Current light level (-1 = no sensor or no reading). Reads the sensor if
+ * it is not being sampled and the last reading is stale. */
+double brightness_engine_get_lux(BrightnessEngine *engine);
+
+/* DDC latency and error statistics of installed and absent monitors, as
+ * text (caller frees). The running engine also logs it on SIGUSR1. */
+char* brightness_engine_format_stats(BrightnessEngine *engine);
+
+/* Run the engine without any frontend until SIGINT or SIGTERM */
+int brightness_engine_run_headless(void);
+
+G_END_DECLS
+
+#endif /* BRIGHTNESS_ENGINE_H */
@@ -8,18 +8,46 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <errno.h>
 
+/* Changes arriving within this window are written together */
+#define CONFIG_SAVE_DELAY_MS 1000
+
 /* Configuration structure */
 struct _AppConfig {
     GKeyFile *keyfile;
     char *config_file_path;
     gboolean modified;
+
+    /* Write-behind persistence: a timer coalesces changes, then the key file
+     * is serialized on the main thread and written by the writer thread.
+     * writer_lock guards the writer_* fields below. */
+    guint save_timer_id;
+    GThread *writer_thread;
+    GMutex writer_lock;
+    GCond writer_cond;
+    char *writer_data;       /* Latest serialized config not yet picked up, or NULL */
+    gsize writer_length;
+    gboolean writer_busy;    /* A write is in progress */
+    gboolean writer_failed;  /* Last background write failed; save again on flush */
+    gboolean writer_stop;
+
+    /* monitor key -> MonitorSettings, parsed on first use, never removed */
+    GHashTable *monitor_settings;
+    MonitorSettingsChangedCallback settings_callback;
+    gpointer settings_callback_data;
 };
 
 static const char *CONFIG_GROUP_GENERAL = "General";
 static const char *CONFIG_GROUP_MONITORS = "Monitors";
 static const char *CONFIG_GROUP_SCHEDULE = "Schedule";
+static const char *CONFIG_GROUP_VCP_CACHE = "VcpCache";
+
+static void store_monitor_settings(AppConfig *config, const char *monitor_key,
+                                   const MonitorSettings *settings);
+static void refresh_monitor_settings(AppConfig *config, const char *monitor_key);
+static void refresh_all_monitor_settings(AppConfig *config);
 
 /* Create new configuration */
 AppConfig* config_new(void)
@@ -27,12 +55,16 @@ AppConfig* config_new(void)
     AppConfig *config = g_new0(AppConfig, 1);
     
     config->keyfile = g_key_file_new();
+    config->monitor_settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
     
     /* Determine config file path */
     const char *config_dir = g_get_user_config_dir();
     config->config_file_path = g_build_filename(config_dir, "ddc_automatic_brightness.conf", NULL);
     
     config->modified = FALSE;
+
+    g_mutex_init(&config->writer_lock);
+    g_cond_init(&config->writer_cond);
     
     return config;
 }
@@ -41,11 +73,22 @@ AppConfig* config_new(void)
 void config_free(AppConfig *config)
 {
     if (config) {
-        if (config->modified) {
+        if (config->modified || config->save_timer_id > 0) {
             config_save(config);
         }
+
+        if (config->writer_thread) {
+            g_mutex_lock(&config->writer_lock);
+            config->writer_stop = TRUE;
+            g_cond_broadcast(&config->writer_cond);
+            g_mutex_unlock(&config->writer_lock);
+            g_thread_join(config->writer_thread);
+        }
+        g_mutex_clear(&config->writer_lock);
+        g_cond_clear(&config->writer_cond);
         
         g_key_file_free(config->keyfile);
+        g_hash_table_destroy(config->monitor_settings);
         g_free(config->config_file_path);
         g_free(config);
     }
@@ -78,31 +121,148 @@ gboolean config_load(AppConfig *config)
     }
     
     config->modified = FALSE;
+    refresh_all_monitor_settings(config);
     return TRUE;
 }
 
-/* Save configuration to file */
-gboolean config_save(AppConfig *config)
+/* Write data to path atomically: a temporary file in the same directory is
+ * written and fsync'd, then renamed over the old file, so a crash leaves
+ * either the old or the new config, never a partial one. Thread-safe. */
+static gboolean write_config_file(const char *path, const char *data, gsize length, GError **error)
 {
-    if (!config) {
-        return FALSE;
-    }
-    
-    /* Create config directory if it doesn't exist */
-    char *config_dir = g_path_get_dirname(config->config_file_path);
+    char *config_dir = g_path_get_dirname(path);
     if (g_mkdir_with_parents(config_dir, 0755) != 0) {
-        g_warning("Failed to create config directory: %s", config_dir);
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to create config directory %s: %s", config_dir, g_strerror(saved_errno));
         g_free(config_dir);
         return FALSE;
     }
+
+    char *tmp_path = g_strdup_printf("%s.XXXXXX", path);
+    int fd = g_mkstemp_full(tmp_path, O_WRONLY, 0644);
+    gboolean result = fd >= 0;
+
+    const char *p = data;
+    gsize remaining = length;
+    while (result && remaining > 0) {
+        ssize_t written = write(fd, p, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            result = FALSE;
+        } else {
+            p += written;
+            remaining -= (gsize)written;
+        }
+    }
+
+    if (result && fsync(fd) != 0) result = FALSE;
+    int saved_errno = errno;
+    if (fd >= 0 && close(fd) != 0 && result) {
+        result = FALSE;
+        saved_errno = errno;
+    }
+    if (result && rename(tmp_path, path) != 0) {
+        result = FALSE;
+        saved_errno = errno;
+    }
+
+    if (result) {
+        /* Make the rename itself durable */
+        int dir_fd = open(config_dir, O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    } else {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to write %s: %s", path, g_strerror(saved_errno));
+        if (fd >= 0) {
+            unlink(tmp_path);
+        }
+    }
+
+    g_free(tmp_path);
     g_free(config_dir);
-    
-    /* Save keyfile */
+    return result;
+}
+
+/* Writer thread: write the latest serialized config until told to stop */
+static gpointer config_writer_thread(gpointer data)
+{
+    AppConfig *config = data;
+
+    g_mutex_lock(&config->writer_lock);
+    for (;;) {
+        while (!config->writer_data && !config->writer_stop) {
+            g_cond_wait(&config->writer_cond, &config->writer_lock);
+        }
+        if (!config->writer_data) {
+            break;
+        }
+
+        char *contents = config->writer_data;
+        gsize length = config->writer_length;
+        config->writer_data = NULL;
+        config->writer_busy = TRUE;
+        g_mutex_unlock(&config->writer_lock);
+
+        GError *error = NULL;
+        gboolean result = write_config_file(config->config_file_path, contents, length, &error);
+        if (!result) {
+            g_warning("Failed to save config file: %s", error->message);
+            g_error_free(error);
+        }
+        g_free(contents);
+
+        g_mutex_lock(&config->writer_lock);
+        config->writer_busy = FALSE;
+        config->writer_failed = !result;
+        g_cond_broadcast(&config->writer_cond);
+    }
+    g_mutex_unlock(&config->writer_lock);
+
+    return NULL;
+}
+
+/* Wait until the writer thread has nothing queued or in progress.
+ * Returns TRUE if its last write failed. Call with writer_lock held. */
+static gboolean wait_for_writer_locked(AppConfig *config)
+{
+    while (config->writer_data || config->writer_busy) {
+        g_cond_wait(&config->writer_cond, &config->writer_lock);
+    }
+    return config->writer_failed;
+}
+
+/* Save configuration to file now, waiting for any background write first */
+gboolean config_save(AppConfig *config)
+{
+    if (!config) {
+        return FALSE;
+    }
+
+    if (config->save_timer_id > 0) {
+        g_source_remove(config->save_timer_id);
+        config->save_timer_id = 0;
+    }
+
+    /* An older snapshot must not land after this one */
+    g_mutex_lock(&config->writer_lock);
+    wait_for_writer_locked(config);
+    g_mutex_unlock(&config->writer_lock);
+
+    gsize length = 0;
+    char *contents = g_key_file_to_data(config->keyfile, &length, NULL);
+
     GError *error = NULL;
-    gboolean result = g_key_file_save_to_file(config->keyfile, 
-                                             config->config_file_path,
-                                             &error);
-    
+    gboolean result = write_config_file(config->config_file_path, contents, length, &error);
+    g_free(contents);
+
+    g_mutex_lock(&config->writer_lock);
+    config->writer_failed = !result;
+    g_mutex_unlock(&config->writer_lock);
+
     if (!result) {
         g_warning("Failed to save config file: %s", error->message);
         g_error_free(error);
@@ -113,6 +273,61 @@ gboolean config_save(AppConfig *config)
     return TRUE;
 }
 
+/* Save timer: snapshot the key file and hand it to the writer thread */
+static gboolean save_timer_callback(gpointer data)
+{
+    AppConfig *config = data;
+    config->save_timer_id = 0;
+
+    gsize length = 0;
+    char *contents = g_key_file_to_data(config->keyfile, &length, NULL);
+    config->modified = FALSE;
+
+    if (!config->writer_thread) {
+        config->writer_thread = g_thread_new("config-writer", config_writer_thread, config);
+    }
+
+    /* A snapshot the writer has not picked up yet is superseded by this one */
+    g_mutex_lock(&config->writer_lock);
+    g_free(config->writer_data);
+    config->writer_data = contents;
+    config->writer_length = length;
+    g_cond_signal(&config->writer_cond);
+    g_mutex_unlock(&config->writer_lock);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Save configuration after a short delay, off the main thread */
+void config_schedule_save(AppConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    config->modified = TRUE;
+    if (config->save_timer_id == 0) {
+        config->save_timer_id = g_timeout_add(CONFIG_SAVE_DELAY_MS, save_timer_callback, config);
+    }
+}
+
+/* Write pending changes now (quit, suspend) */
+gboolean config_flush(AppConfig *config)
+{
+    if (!config) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&config->writer_lock);
+    gboolean failed = wait_for_writer_locked(config);
+    g_mutex_unlock(&config->writer_lock);
+
+    if (config->modified || config->save_timer_id > 0 || failed) {
+        return config_save(config);
+    }
+    return TRUE;
+}
+
 /* Get default monitor device path */
 char* config_get_default_monitor(AppConfig *config)
 {
@@ -337,13 +552,9 @@ void config_set_monitor_auto_brightness(AppConfig *config, const char *device_pa
     config->modified = TRUE;
 }
 
-/* Get per-monitor auto brightness mode */
-AutoBrightnessMode config_get_monitor_auto_brightness_mode(AppConfig *config, const char *device_path)
+/* Read per-monitor auto brightness mode from the key file */
+static AutoBrightnessMode read_monitor_auto_brightness_mode(AppConfig *config, const char *device_path)
 {
-    if (!config || !device_path) {
-        return AUTO_BRIGHTNESS_MODE_DISABLED;
-    }
-
     char *key = g_strdup_printf("%s_auto_brightness_mode", device_path);
 
     GError *error = NULL;
@@ -373,6 +584,16 @@ AutoBrightnessMode config_get_monitor_auto_brightness_mode(AppConfig *config, co
     return (AutoBrightnessMode)value;
 }
 
+/* Get per-monitor auto brightness mode */
+AutoBrightnessMode config_get_monitor_auto_brightness_mode(AppConfig *config, const char *device_path)
+{
+    if (!config || !device_path) {
+        return AUTO_BRIGHTNESS_MODE_DISABLED;
+    }
+
+    return config_get_monitor_settings(config, device_path)->mode;
+}
+
 /* Set per-monitor auto brightness mode */
 void config_set_monitor_auto_brightness_mode(AppConfig *config, const char *device_path, AutoBrightnessMode mode)
 {
@@ -380,6 +601,9 @@ void config_set_monitor_auto_brightness_mode(AppConfig *config, const char *devi
         return;
     }
 
+    MonitorSettings settings = *config_get_monitor_settings(config, device_path);
+    settings.mode = mode;
+
     char *key = g_strdup_printf("%s_auto_brightness_mode", device_path);
 
     g_key_file_set_integer(config->keyfile,
@@ -393,15 +617,12 @@ void config_set_monitor_auto_brightness_mode(AppConfig *config, const char *devi
     config_set_monitor_auto_brightness(config, device_path, mode != AUTO_BRIGHTNESS_MODE_DISABLED);
 
     config->modified = TRUE;
+    store_monitor_settings(config, device_path, &settings);
 }
 
-/* Get per-monitor brightness offset */
-int config_get_monitor_brightness_offset(AppConfig *config, const char *device_path)
+/* Read per-monitor brightness offset from the key file */
+static int read_monitor_brightness_offset(AppConfig *config, const char *device_path)
 {
-    if (!config || !device_path) {
-        return 0; /* Default to no offset */
-    }
-
     char *key = g_strdup_printf("%s_brightness_offset", device_path);
 
     GError *error = NULL;
@@ -424,6 +645,16 @@ int config_get_monitor_brightness_offset(AppConfig *config, const char *device_p
     return value;
 }
 
+/* Get per-monitor brightness offset */
+int config_get_monitor_brightness_offset(AppConfig *config, const char *device_path)
+{
+    if (!config || !device_path) {
+        return 0; /* Default to no offset */
+    }
+
+    return config_get_monitor_settings(config, device_path)->brightness_offset;
+}
+
 /* Set per-monitor brightness offset */
 void config_set_monitor_brightness_offset(AppConfig *config, const char *device_path, int offset)
 {
@@ -435,6 +666,9 @@ void config_set_monitor_brightness_offset(AppConfig *config, const char *device_
     if (offset < -20) offset = -20;
     if (offset > 20) offset = 20;
 
+    MonitorSettings settings = *config_get_monitor_settings(config, device_path);
+    settings.brightness_offset = offset;
+
     char *key = g_strdup_printf("%s_brightness_offset", device_path);
 
     g_key_file_set_integer(config->keyfile,
@@ -444,40 +678,130 @@ void config_set_monitor_brightness_offset(AppConfig *config, const char *device_
 
     g_free(key);
     config->modified = TRUE;
+    store_monitor_settings(config, device_path, &settings);
 }
 
-/* Get the stored model name for a monitor bus path.
- * Stored inside the LightSensorCurve_ group so it persists even when [Monitors]
- * keys for that bus are pruned (e.g. when the monitor is absent at startup).
- * Caller must g_free the returned string. */
-char* config_get_monitor_model_name(AppConfig *config, const char *device_path)
+/* Get a cached VCP value for a monitor */
+gboolean config_get_vcp_cache(AppConfig *config, const char *monitor_key, guint8 vcp_code,
+                              int *value, gint64 *timestamp)
 {
-    if (!config || !device_path) return NULL;
+    if (!config || !monitor_key) {
+        return FALSE;
+    }
 
-    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
+    char *value_key = g_strdup_printf("%s_vcp_%02x", monitor_key, vcp_code);
+    char *time_key = g_strdup_printf("%s_vcp_%02x_time", monitor_key, vcp_code);
     GError *error = NULL;
-    char *value = g_key_file_get_string(config->keyfile, group, "model_name", &error);
-    g_free(group);
+
+    int cached_value = g_key_file_get_integer(config->keyfile, CONFIG_GROUP_VCP_CACHE, value_key, &error);
+    gint64 cached_time = 0;
+    if (!error) {
+        cached_time = g_key_file_get_int64(config->keyfile, CONFIG_GROUP_VCP_CACHE, time_key, &error);
+    }
+
+    g_free(value_key);
+    g_free(time_key);
 
     if (error) {
         g_error_free(error);
-        return NULL;
+        return FALSE;
     }
-    return value;
+
+    if (value) *value = cached_value;
+    if (timestamp) *timestamp = cached_time;
+    return TRUE;
 }
 
-/* Store the model name for a monitor bus path inside the LightSensorCurve_ group
- * so the association survives across reconnects and pruning cycles. */
-void config_set_monitor_model_name(AppConfig *config, const char *device_path, const char *model_name)
+/* Store a cached VCP value for a monitor */
+void config_set_vcp_cache(AppConfig *config, const char *monitor_key, guint8 vcp_code,
+                          int value, gint64 timestamp)
 {
-    if (!config || !device_path || !model_name) return;
+    if (!config || !monitor_key) {
+        return;
+    }
 
-    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
-    g_key_file_set_string(config->keyfile, group, "model_name", model_name);
-    g_free(group);
+    char *value_key = g_strdup_printf("%s_vcp_%02x", monitor_key, vcp_code);
+    char *time_key = g_strdup_printf("%s_vcp_%02x_time", monitor_key, vcp_code);
+
+    g_key_file_set_integer(config->keyfile, CONFIG_GROUP_VCP_CACHE, value_key, value);
+    g_key_file_set_int64(config->keyfile, CONFIG_GROUP_VCP_CACHE, time_key, timestamp);
+
+    g_free(value_key);
+    g_free(time_key);
     config->modified = TRUE;
 }
 
+/* Move a monitor's settings from its old key to its new key */
+gboolean config_migrate_monitor_key(AppConfig *config, const char *old_key, const char *new_key)
+{
+    if (!config || !old_key || !new_key || strcmp(old_key, new_key) == 0) {
+        return FALSE;
+    }
+
+    gboolean moved = FALSE;
+
+    /* [Monitors] entries are "<key>_<setting>" */
+    char *prefix = g_strdup_printf("%s_", old_key);
+    gsize n_keys = 0;
+    char **keys = g_key_file_get_keys(config->keyfile, CONFIG_GROUP_MONITORS, &n_keys, NULL);
+    for (gsize i = 0; keys && i < n_keys; i++) {
+        if (!g_str_has_prefix(keys[i], prefix)) continue;
+
+        char *new_name = g_strdup_printf("%s_%s", new_key, keys[i] + strlen(prefix));
+        if (!g_key_file_has_key(config->keyfile, CONFIG_GROUP_MONITORS, new_name, NULL)) {
+            char *value = g_key_file_get_value(config->keyfile, CONFIG_GROUP_MONITORS, keys[i], NULL);
+            if (value) {
+                g_key_file_set_value(config->keyfile, CONFIG_GROUP_MONITORS, new_name, value);
+                g_free(value);
+            }
+        }
+        g_key_file_remove_key(config->keyfile, CONFIG_GROUP_MONITORS, keys[i], NULL);
+        g_free(new_name);
+        moved = TRUE;
+    }
+    g_strfreev(keys);
+    g_free(prefix);
+
+    /* Light sensor curve group */
+    char *old_group = g_strdup_printf("LightSensorCurve_%s", old_key);
+    char *new_group = g_strdup_printf("LightSensorCurve_%s", new_key);
+    if (g_key_file_has_group(config->keyfile, old_group)) {
+        if (!g_key_file_has_group(config->keyfile, new_group)) {
+            keys = g_key_file_get_keys(config->keyfile, old_group, &n_keys, NULL);
+            for (gsize i = 0; keys && i < n_keys; i++) {
+                /* model_name only served the old bus-path migration */
+                if (strcmp(keys[i], "model_name") == 0) continue;
+
+                char *value = g_key_file_get_value(config->keyfile, old_group, keys[i], NULL);
+                if (value) {
+                    g_key_file_set_value(config->keyfile, new_group, keys[i], value);
+                    g_free(value);
+                }
+            }
+            g_strfreev(keys);
+        }
+        g_key_file_remove_group(config->keyfile, old_group, NULL);
+        moved = TRUE;
+    }
+    g_free(old_group);
+    g_free(new_group);
+
+    /* Default monitor selection */
+    char *default_monitor = config_get_default_monitor(config);
+    if (default_monitor && strcmp(default_monitor, old_key) == 0) {
+        config_set_default_monitor(config, new_key);
+        moved = TRUE;
+    }
+    g_free(default_monitor);
+
+    if (moved) {
+        config->modified = TRUE;
+        refresh_monitor_settings(config, old_key);
+        refresh_monitor_settings(config, new_key);
+    }
+    return moved;
+}
+
 /* Load light sensor curve for a specific monitor */
 gboolean config_load_light_sensor_curve(AppConfig *config, const char *device_path,
                                         LightSensorCurvePoint **points, int *count)
@@ -579,13 +903,49 @@ void config_save_light_sensor_curve(AppConfig *config, const char *device_path,
     config->modified = TRUE;
 }
 
-/* Get light sensor hysteresis for a monitor (default: 5.0 lux) */
-double config_get_light_sensor_hysteresis(AppConfig *config, const char *device_path)
+/* Get curve interpolation for a monitor */
+LightSensorCurveInterpolation config_get_light_sensor_curve_interpolation(AppConfig *config, const char *device_path)
 {
     if (!config || !device_path) {
-        return 5.0;  /* Default hysteresis */
+        return LIGHT_SENSOR_CURVE_MONOTONE_CUBIC;
+    }
+
+    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
+    char *name = g_key_file_get_string(config->keyfile, group, "interpolation", NULL);
+    LightSensorCurveInterpolation interpolation = light_sensor_curve_interpolation_from_string(name);
+
+    g_free(name);
+    g_free(group);
+    return interpolation;
+}
+
+/* Set curve interpolation for a monitor */
+void config_set_light_sensor_curve_interpolation(AppConfig *config, const char *device_path,
+                                                 LightSensorCurveInterpolation interpolation)
+{
+    if (!config || !device_path) {
+        return;
     }
 
+    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
+    g_key_file_set_string(config->keyfile, group, "interpolation",
+                          light_sensor_curve_interpolation_to_string(interpolation));
+
+    g_free(group);
+    config->modified = TRUE;
+}
+
+/* Clamp light sensor hysteresis to its valid range (0-100 lux) */
+static double clamp_light_sensor_hysteresis(double hysteresis)
+{
+    if (hysteresis < 0.0) hysteresis = 0.0;
+    if (hysteresis > 100.0) hysteresis = 100.0;
+    return hysteresis;
+}
+
+/* Read light sensor hysteresis for a monitor from the key file (default: 5.0 lux) */
+static double read_light_sensor_hysteresis(AppConfig *config, const char *device_path)
+{
     /* Build group name for this monitor's light sensor settings */
     char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
 
@@ -598,12 +958,18 @@ double config_get_light_sensor_hysteresis(AppConfig *config, const char *device_
         hysteresis = 5.0;
     }
 
-    /* Clamp to valid range (0-100 lux) */
-    if (hysteresis < 0.0) hysteresis = 0.0;
-    if (hysteresis > 100.0) hysteresis = 100.0;
-
     g_free(group);
-    return hysteresis;
+    return clamp_light_sensor_hysteresis(hysteresis);
+}
+
+/* Get light sensor hysteresis for a monitor (default: 5.0 lux) */
+double config_get_light_sensor_hysteresis(AppConfig *config, const char *device_path)
+{
+    if (!config || !device_path) {
+        return 5.0;  /* Default hysteresis */
+    }
+
+    return config_get_monitor_settings(config, device_path)->light_sensor_filter.hysteresis_lux;
 }
 
 /* Set light sensor hysteresis for a monitor */
@@ -613,17 +979,189 @@ void config_set_light_sensor_hysteresis(AppConfig *config, const char *device_pa
         return;
     }
 
-    /* Clamp to valid range (0-100 lux) */
-    if (hysteresis < 0.0) hysteresis = 0.0;
-    if (hysteresis > 100.0) hysteresis = 100.0;
+    MonitorSettings settings = *config_get_monitor_settings(config, device_path);
+    settings.light_sensor_filter.hysteresis_lux = clamp_light_sensor_hysteresis(hysteresis);
 
     /* Build group name for this monitor's light sensor settings */
     char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
 
-    g_key_file_set_double(config->keyfile, group, "hysteresis", hysteresis);
+    g_key_file_set_double(config->keyfile, group, "hysteresis", settings.light_sensor_filter.hysteresis_lux);
+
+    g_free(group);
+    config->modified = TRUE;
+    store_monitor_settings(config, device_path, &settings);
+}
+
+/* Read an optional double from a group, keeping the current value if unset */
+static void get_optional_double(GKeyFile *keyfile, const char *group, const char *key, double *value)
+{
+    GError *error = NULL;
+    double parsed = g_key_file_get_double(keyfile, group, key, &error);
+
+    if (error) {
+        g_error_free(error);
+        return;
+    }
+    *value = parsed;
+}
+
+/* Read light sensor filter settings for a monitor from the key file
+ * (defaults for unset keys) */
+static void read_light_sensor_filter(AppConfig *config, const char *device_path,
+                                     LightSensorFilterSettings *settings)
+{
+    light_sensor_filter_settings_init(settings);
+    settings->hysteresis_lux = read_light_sensor_hysteresis(config, device_path);
+
+    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
+
+    GError *error = NULL;
+    int window = g_key_file_get_integer(config->keyfile, group, "median_window", &error);
+    if (error) {
+        g_error_free(error);
+    } else {
+        settings->median_window = window;
+    }
+
+    get_optional_double(config->keyfile, group, "smoothing_seconds", &settings->smoothing_seconds);
+    get_optional_double(config->keyfile, group, "hysteresis_percent", &settings->hysteresis_percent);
+    get_optional_double(config->keyfile, group, "dwell_seconds", &settings->dwell_seconds);
+
+    g_free(group);
+}
+
+/* Get light sensor filter settings for a monitor (defaults for unset keys).
+ * hysteresis_lux is the existing "hysteresis" setting. */
+void config_get_light_sensor_filter(AppConfig *config, const char *device_path,
+                                    LightSensorFilterSettings *settings)
+{
+    if (!config || !device_path) {
+        light_sensor_filter_settings_init(settings);
+        settings->hysteresis_lux = 5.0;
+        return;
+    }
+
+    *settings = config_get_monitor_settings(config, device_path)->light_sensor_filter;
+}
+
+/* Set light sensor filter settings for a monitor */
+void config_set_light_sensor_filter(AppConfig *config, const char *device_path,
+                                    const LightSensorFilterSettings *settings)
+{
+    if (!config || !device_path || !settings) {
+        return;
+    }
+
+    MonitorSettings updated = *config_get_monitor_settings(config, device_path);
+    updated.light_sensor_filter = *settings;
+    updated.light_sensor_filter.hysteresis_lux = clamp_light_sensor_hysteresis(settings->hysteresis_lux);
+
+    char *group = g_strdup_printf("LightSensorCurve_%s", device_path);
+
+    g_key_file_set_double(config->keyfile, group, "hysteresis", updated.light_sensor_filter.hysteresis_lux);
+    g_key_file_set_integer(config->keyfile, group, "median_window", settings->median_window);
+    g_key_file_set_double(config->keyfile, group, "smoothing_seconds", settings->smoothing_seconds);
+    g_key_file_set_double(config->keyfile, group, "hysteresis_percent", settings->hysteresis_percent);
+    g_key_file_set_double(config->keyfile, group, "dwell_seconds", settings->dwell_seconds);
 
     g_free(group);
     config->modified = TRUE;
+    store_monitor_settings(config, device_path, &updated);
+}
+
+/* Parse a monitor's settings from the key file */
+static void read_monitor_settings(AppConfig *config, const char *monitor_key, MonitorSettings *settings)
+{
+    settings->mode = read_monitor_auto_brightness_mode(config, monitor_key);
+    settings->brightness_offset = read_monitor_brightness_offset(config, monitor_key);
+    read_light_sensor_filter(config, monitor_key, &settings->light_sensor_filter);
+}
+
+/* Get a monitor's typed settings, parsing them on first use */
+const MonitorSettings* config_get_monitor_settings(AppConfig *config, const char *monitor_key)
+{
+    if (!config || !monitor_key) {
+        return NULL;
+    }
+
+    MonitorSettings *settings = g_hash_table_lookup(config->monitor_settings, monitor_key);
+    if (!settings) {
+        settings = g_new0(MonitorSettings, 1);
+        read_monitor_settings(config, monitor_key, settings);
+        g_hash_table_insert(config->monitor_settings, g_strdup(monitor_key), settings);
+    }
+
+    return settings;
+}
+
+/* Register the settings change callback (one per config, replaces any previous) */
+void config_set_monitor_settings_callback(AppConfig *config, MonitorSettingsChangedCallback callback,
+                                          gpointer user_data)
+{
+    if (!config) {
+        return;
+    }
+
+    config->settings_callback = callback;
+    config->settings_callback_data = user_data;
+}
+
+/* Compare filter settings field by field (the struct has padding) */
+static gboolean light_sensor_filter_settings_equal(const LightSensorFilterSettings *a,
+                                                   const LightSensorFilterSettings *b)
+{
+    return a->median_window == b->median_window &&
+           a->smoothing_seconds == b->smoothing_seconds &&
+           a->hysteresis_percent == b->hysteresis_percent &&
+           a->hysteresis_lux == b->hysteresis_lux &&
+           a->dwell_seconds == b->dwell_seconds;
+}
+
+/* Replace a monitor's cached settings and notify about the fields that changed */
+static void store_monitor_settings(AppConfig *config, const char *monitor_key,
+                                   const MonitorSettings *settings)
+{
+    MonitorSettings *cached = (MonitorSettings*)config_get_monitor_settings(config, monitor_key);
+    guint changed = 0;
+
+    if (cached->mode != settings->mode) {
+        changed |= MONITOR_SETTINGS_MODE;
+    }
+    if (cached->brightness_offset != settings->brightness_offset) {
+        changed |= MONITOR_SETTINGS_BRIGHTNESS_OFFSET;
+    }
+    if (!light_sensor_filter_settings_equal(&cached->light_sensor_filter, &settings->light_sensor_filter)) {
+        changed |= MONITOR_SETTINGS_LIGHT_SENSOR_FILTER;
+    }
+
+    *cached = *settings;
+
+    if (changed && config->settings_callback) {
+        config->settings_callback(config, monitor_key, cached, changed, config->settings_callback_data);
+    }
+}
+
+/* Re-parse a monitor's settings after the key file changed underneath them.
+ * Monitors nobody has asked about yet are parsed on first use instead. */
+static void refresh_monitor_settings(AppConfig *config, const char *monitor_key)
+{
+    if (!g_hash_table_contains(config->monitor_settings, monitor_key)) {
+        return;
+    }
+
+    MonitorSettings settings;
+    read_monitor_settings(config, monitor_key, &settings);
+    store_monitor_settings(config, monitor_key, &settings);
+}
+
+static void refresh_all_monitor_settings(AppConfig *config)
+{
+    /* Callbacks may add entries, so walk a snapshot; entries are never removed */
+    GList *keys = g_hash_table_get_keys(config->monitor_settings);
+    for (GList *l = keys; l; l = l->next) {
+        refresh_monitor_settings(config, l->data);
+    }
+    g_list_free(keys);
 }
 
 /* Get keyfile for direct access (for schedule configuration) */
@@ -657,6 +1195,7 @@ static char* extract_device_path_from_key(const char *key)
 
 /* Remove config entries for every monitor device path that no longer exists in /dev/.
  * Called at startup so stale entries from old hub port assignments are cleaned automatically.
+ * Only bus-path keys (monitors without EDID, or not yet migrated) are considered.
  * Returns the number of stale monitor device paths removed. */
 int config_prune_stale_monitors(AppConfig *config)
 {
@@ -712,17 +1251,18 @@ int config_prune_stale_monitors(AppConfig *config)
         removed++;
     }
 
-    /* If default_monitor points to a stale device, clear it */
+    /* If default_monitor points to a stale device, clear it (EDID identities are never stale) */
     if (removed > 0) {
         char *default_monitor = config_get_default_monitor(config);
         if (default_monitor) {
-            if (access(default_monitor, F_OK) != 0) {
+            if (g_str_has_prefix(default_monitor, "/dev/") && access(default_monitor, F_OK) != 0) {
                 g_key_file_remove_key(config->keyfile, CONFIG_GROUP_GENERAL, "default_monitor", NULL);
                 g_message("Cleared stale default_monitor: %s", default_monitor);
             }
             g_free(default_monitor);
         }
         config->modified = TRUE;
+        refresh_all_monitor_settings(config);
     }
 
     g_list_free(stale);
@@ -18,8 +18,19 @@ AppConfig* config_new(void);
 void config_free(AppConfig *config);
 
 gboolean config_load(AppConfig *config);
+
+/* Write the configuration now. The file is replaced atomically (temporary
+ * file, fsync, rename), so a crash never leaves a partial config. */
 gboolean config_save(AppConfig *config);
 
+/* Mark the configuration dirty and save it after a short delay. Changes made
+ * meanwhile are coalesced into one write, done on a worker thread. */
+void config_schedule_save(AppConfig *config);
+
+/* Write any pending changes synchronously (quit, suspend). Waits for an
+ * in-progress background write first. */
+gboolean config_flush(AppConfig *config);
+
 /* General settings */
 char* config_get_default_monitor(AppConfig *config);  /* Caller must free returned string */
 void config_set_default_monitor(AppConfig *config, const char *device_path);
@@ -36,7 +47,36 @@ void config_set_show_brightness_in_tray(AppConfig *config, gboolean show);
 gboolean config_get_show_light_level_in_tray(AppConfig *config);
 void config_set_show_light_level_in_tray(AppConfig *config, gboolean show);
 
-/* Per-monitor settings */
+/* Typed per-monitor settings, keyed by monitor_get_config_key(). Parsed from
+ * the key file on first use and kept in memory; the setters below update them
+ * and write through to the key file, which is only read again on load. */
+typedef struct {
+    AutoBrightnessMode mode;
+    int brightness_offset;                         /* -20 to +20 */
+    LightSensorFilterSettings light_sensor_filter; /* hysteresis_lux is "hysteresis" */
+} MonitorSettings;
+
+/* Fields reported as changed to the settings callback */
+typedef enum {
+    MONITOR_SETTINGS_MODE = 1 << 0,
+    MONITOR_SETTINGS_BRIGHTNESS_OFFSET = 1 << 1,
+    MONITOR_SETTINGS_LIGHT_SENSOR_FILTER = 1 << 2
+} MonitorSettingsField;
+
+/* The returned settings stay valid (and current) until config_free(). Lookups
+ * after the first one do not allocate, so the control loop may call this
+ * for every monitor on every tick. */
+const MonitorSettings* config_get_monitor_settings(AppConfig *config, const char *monitor_key);
+
+/* Called after a monitor's settings actually change (a setter, a reload or a
+ * key migration), with a MonitorSettingsField mask of what changed */
+typedef void (*MonitorSettingsChangedCallback)(AppConfig *config, const char *monitor_key,
+                                               const MonitorSettings *settings, guint changed,
+                                               gpointer user_data);
+void config_set_monitor_settings_callback(AppConfig *config, MonitorSettingsChangedCallback callback,
+                                          gpointer user_data);
+
+/* Per-monitor settings, keyed by monitor_get_config_key() */
 gboolean config_get_monitor_auto_brightness(AppConfig *config, const char *device_path);
 void config_set_monitor_auto_brightness(AppConfig *config, const char *device_path, gboolean enabled);
 
@@ -46,25 +86,39 @@ void config_set_monitor_auto_brightness_mode(AppConfig *config, const char *devi
 int config_get_monitor_brightness_offset(AppConfig *config, const char *device_path);
 void config_set_monitor_brightness_offset(AppConfig *config, const char *device_path, int offset);
 
-/* Per-monitor model name (used for curve migration when I2C bus numbers change) */
-char* config_get_monitor_model_name(AppConfig *config, const char *device_path);  /* Caller must free */
-void config_set_monitor_model_name(AppConfig *config, const char *device_path, const char *model_name);
+/* Persistent VCP value cache: last value confirmed on the monitor and when
+ * (Unix time, seconds). Returns FALSE if nothing is cached. */
+gboolean config_get_vcp_cache(AppConfig *config, const char *monitor_key, guint8 vcp_code,
+                              int *value, gint64 *timestamp);
+void config_set_vcp_cache(AppConfig *config, const char *monitor_key, guint8 vcp_code,
+                          int value, gint64 timestamp);
 
-/* Light sensor curve settings - per monitor */
-typedef struct {
-    double lux;
-    int brightness;  /* 0-100 */
-} LightSensorCurvePoint;
+/* Move settings stored under a monitor's old key (its /dev/i2c-N path, before
+ * EDID identities) to its new key. Settings already under new_key are kept.
+ * Returns TRUE if anything was moved. */
+gboolean config_migrate_monitor_key(AppConfig *config, const char *old_key, const char *new_key);
 
+/* Light sensor curve settings - per monitor (LightSensorCurvePoint is in light_sensor.h) */
 gboolean config_load_light_sensor_curve(AppConfig *config, const char *device_path,
                                         LightSensorCurvePoint **points, int *count);
 void config_save_light_sensor_curve(AppConfig *config, const char *device_path,
                                    const LightSensorCurvePoint *points, int count);
 
+/* Light sensor curve interpolation - per monitor (default: monotone cubic) */
+LightSensorCurveInterpolation config_get_light_sensor_curve_interpolation(AppConfig *config, const char *device_path);
+void config_set_light_sensor_curve_interpolation(AppConfig *config, const char *device_path,
+                                                 LightSensorCurveInterpolation interpolation);
+
 /* Light sensor hysteresis setting - per monitor */
 double config_get_light_sensor_hysteresis(AppConfig *config, const char *device_path);
 void config_set_light_sensor_hysteresis(AppConfig *config, const char *device_path, double hysteresis);
 
+/* Light sensor filter chain settings - per monitor, stored next to the curve */
+void config_get_light_sensor_filter(AppConfig *config, const char *device_path,
+                                    LightSensorFilterSettings *settings);
+void config_set_light_sensor_filter(AppConfig *config, const char *device_path,
+                                    const LightSensorFilterSettings *settings);
+
 /* Maintenance */
 int config_prune_stale_monitors(AppConfig *config);
 
@@ -0,0 +1,124 @@
+/*
+ * control_loop.c - Tickless deadline engine for automatic brightness control
+ *
+ * Everything that can make brightness change - sensor samples, schedule
+ * boundaries, transition steps, DDC retry backoff - either reacts to an event
+ * or registers a deadline here. The loop is a single GSource whose ready time
+ * is the earliest pending deadline, so nothing wakes the process while the
+ * system is idle.
+ */
+
+#include "control_loop.h"
+
+struct _ControlLoop {
+    GSource *source;
+    gint64 deadlines[CONTROL_DEADLINE_COUNT];  /* Monotonic us, -1 = none */
+    ControlLoopFunc func;
+    gpointer user_data;
+    guint64 wakeups;
+};
+
+/* GSource wrapper pointing back at its loop */
+typedef struct {
+    GSource source;
+    ControlLoop *loop;
+} ControlLoopSource;
+
+/* Arm the source for the earliest pending deadline */
+static void control_loop_update_ready_time(ControlLoop *loop)
+{
+    gint64 earliest = -1;
+
+    for (int i = 0; i < CONTROL_DEADLINE_COUNT; i++) {
+        if (loop->deadlines[i] >= 0 && (earliest < 0 || loop->deadlines[i] < earliest)) {
+            earliest = loop->deadlines[i];
+        }
+    }
+
+    g_source_set_ready_time(loop->source, earliest);
+}
+
+static gboolean control_loop_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    ControlLoop *loop = ((ControlLoopSource*)source)->loop;
+    gint64 now = g_get_monotonic_time();
+    guint due = 0;
+
+    (void)callback;
+    (void)user_data;
+
+    for (int i = 0; i < CONTROL_DEADLINE_COUNT; i++) {
+        if (loop->deadlines[i] >= 0 && loop->deadlines[i] <= now) {
+            loop->deadlines[i] = -1;
+            due |= CONTROL_DEADLINE_MASK(i);
+        }
+    }
+    control_loop_update_ready_time(loop);
+
+    if (due) {
+        loop->wakeups++;
+        loop->func(loop, due, now, loop->user_data);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs control_loop_source_funcs = {
+    NULL,                   /* prepare: ready time only */
+    NULL,                   /* check */
+    control_loop_dispatch,
+    NULL,                   /* finalize */
+    NULL,
+    NULL
+};
+
+/* Create the loop and attach it to the default main context */
+ControlLoop* control_loop_new(ControlLoopFunc func, gpointer user_data)
+{
+    g_return_val_if_fail(func != NULL, NULL);
+
+    ControlLoop *loop = g_new0(ControlLoop, 1);
+    loop->func = func;
+    loop->user_data = user_data;
+    for (int i = 0; i < CONTROL_DEADLINE_COUNT; i++) {
+        loop->deadlines[i] = -1;
+    }
+
+    loop->source = g_source_new(&control_loop_source_funcs, sizeof(ControlLoopSource));
+    ((ControlLoopSource*)loop->source)->loop = loop;
+    g_source_set_name(loop->source, "brightness control loop");
+    g_source_set_ready_time(loop->source, -1);
+    g_source_attach(loop->source, NULL);
+
+    return loop;
+}
+
+void control_loop_free(ControlLoop *loop)
+{
+    if (loop) {
+        g_source_destroy(loop->source);
+        g_source_unref(loop->source);
+        g_free(loop);
+    }
+}
+
+/* Request a wakeup; the earlier of two requests for the same kind wins */
+void control_loop_schedule(ControlLoop *loop, ControlDeadline kind, gint64 deadline)
+{
+    g_return_if_fail(loop != NULL && kind < CONTROL_DEADLINE_COUNT);
+
+    if (deadline < 0) {
+        deadline = 0;
+    }
+    if (loop->deadlines[kind] >= 0 && loop->deadlines[kind] <= deadline) {
+        return;
+    }
+
+    loop->deadlines[kind] = deadline;
+    control_loop_update_ready_time(loop);
+}
+
+guint64 control_loop_get_wakeups(ControlLoop *loop)
+{
+    return loop ? loop->wakeups : 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * control_loop.h - Tickless deadline engine for automatic brightness control
+ */
+
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Reasons the control loop can be due. Each kind holds at most one pending
+ * deadline; the loop arms a single main-loop source for the earliest one and
+ * has nothing armed when no deadline is pending. */
+typedef enum {
+    CONTROL_DEADLINE_EVALUATE = 0,  /* Re-evaluate automatic targets (events, filter dwell) */
+    CONTROL_DEADLINE_TRANSITION,    /* Next step of a running brightness transition */
+    CONTROL_DEADLINE_RETRY,         /* A backing-off DDC link admits another command */
+    CONTROL_DEADLINE_COUNT
+} ControlDeadline;
+
+#define CONTROL_DEADLINE_MASK(kind) (1u << (kind))
+
+typedef struct _ControlLoop ControlLoop;
+
+/* Called on the main loop with the kinds that came due (a mask of
+ * CONTROL_DEADLINE_MASK bits; they are cleared before the call) and the
+ * monotonic time. The callback schedules whatever follow-up it needs. */
+typedef void (*ControlLoopFunc)(ControlLoop *loop, guint due, gint64 now, gpointer user_data);
+
+ControlLoop* control_loop_new(ControlLoopFunc func, gpointer user_data);
+void control_loop_free(ControlLoop *loop);
+
+/* Request a wakeup at a monotonic time (g_get_monotonic_time()). If the kind
+ * already has an earlier deadline, that one is kept. */
+void control_loop_schedule(ControlLoop *loop, ControlDeadline kind, gint64 deadline);
+
+/* Number of times the loop has woken up */
+guint64 control_loop_get_wakeups(ControlLoop *loop);
+
+G_END_DECLS
+
+#endif /* CONTROL_LOOP_H */
@@ -0,0 +1,40 @@
+/*
+ * DDC Automatic Brightness - headless daemon
+ * Runs the brightness engine on a plain GLib main loop, without GTK
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "brightness_engine.h"
+#include "dbus_service.h"
+
+/* Main entry point */
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            /* Client mode: the running instance applies the step */
+            return dbus_service_run_step_client(argv[i + 1]);
+        } else if (strncmp(argv[i], "--step=", 7) == 0) {
+            return dbus_service_run_step_client(argv[i] + 7);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            return dbus_service_run_stats_client();
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printf("DDC Automatic Brightness (headless daemon)\n");
+            printf("Usage: %s [options]\n", argv[0]);
+            printf("Settings are shared with ddc-automatic-brightness-gtk.\n");
+            printf("Options:\n");
+            printf("  --step +N, --step -N Step the running instance's brightness by N%% and exit\n");
+            printf("  --stats              Print the running instance's DDC statistics and exit\n");
+            printf("  --help, -h           Show this help\n");
+            return 0;
+        }
+
+        fprintf(stderr, "Unknown option: %s\n", argv[i]);
+        return 1;
+    }
+
+    return brightness_engine_run_headless();
+}
@@ -0,0 +1,727 @@
+/*
+ * dbus_service.c - Session bus control and state service
+ *
+ * Exposes the engine's monitors on the session bus so hotkey daemons, status
+ * bars and scripts can read and set brightness without running ddccontrol
+ * next to us. Every DDC access still goes through the engine's per-bus
+ * queues; property reads are answered from memory.
+ */
+
+#include "dbus_service.h"
+#include <gio/gio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#define DBUS_CLIENT_TIMEOUT_MS 1000  /* The service replies before touching DDC */
+
+static const char introspection_xml[] =
+    "<node>"
+    "  <interface name='" DBUS_SERVICE_INTERFACE "'>"
+    "    <method name='SetBrightness'>"
+    "      <arg type='i' name='brightness' direction='in'/>"
+    "    </method>"
+    "    <method name='StepBrightness'>"
+    "      <arg type='i' name='delta' direction='in'/>"
+    "    </method>"
+    "    <method name='GetStatistics'>"
+    "      <arg type='s' name='report' direction='out'/>"
+    "    </method>"
+    "    <property type='ao' name='Monitors' access='read'/>"
+    "    <property type='d' name='Lux' access='read'/>"
+    "    <property type='b' name='LightSensorAvailable' access='read'/>"
+    "  </interface>"
+    "  <interface name='" DBUS_SERVICE_MONITOR_INTERFACE "'>"
+    "    <method name='SetBrightness'>"
+    "      <arg type='i' name='brightness' direction='in'/>"
+    "    </method>"
+    "    <method name='StepBrightness'>"
+    "      <arg type='i' name='delta' direction='in'/>"
+    "      <arg type='i' name='brightness' direction='out'/>"
+    "    </method>"
+    "    <method name='SetMode'>"
+    "      <arg type='s' name='mode' direction='in'/>"
+    "    </method>"
+    "    <property type='s' name='Name' access='read'/>"
+    "    <property type='s' name='Identity' access='read'/>"
+    "    <property type='s' name='DevicePath' access='read'/>"
+    "    <property type='i' name='Brightness' access='read'/>"
+    "    <property type='i' name='TargetBrightness' access='read'/>"
+    "    <property type='s' name='Mode' access='read'/>"
+    "    <property type='s' name='Health' access='read'/>"
+    "    <property type='b' name='Available' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+/* One exported monitor */
+typedef struct {
+    DbusService *service;
+    Monitor *monitor;          /* Referenced while exported */
+    char *object_path;
+    guint registration_id;
+
+    /* Values last announced with PropertiesChanged */
+    int brightness;
+    int target_brightness;
+    AutoBrightnessMode mode;
+    MonitorHealthState health;
+    gboolean available;
+} MonitorObject;
+
+struct _DbusService {
+    BrightnessEngine *engine;
+    DbusServiceReadyFunc ready;
+    gpointer ready_data;
+    gboolean resolved;            /* ready has been called */
+    GDBusNodeInfo *introspection;
+    guint owner_id;
+    GDBusConnection *connection;  /* Set while the name is ours */
+    guint root_registration_id;
+
+    GList *objects;               /* MonitorObject* */
+    guint next_object_serial;     /* Paths are never reused within a run */
+    double lux;                   /* Last announced */
+};
+
+const char* dbus_service_mode_to_string(AutoBrightnessMode mode)
+{
+    switch (mode) {
+        case AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE:
+            return "schedule";
+        case AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR:
+            return "light-sensor";
+        case AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY:
+            return "laptop-display";
+        default:
+            return "disabled";
+    }
+}
+
+gboolean dbus_service_mode_from_string(const char *name, AutoBrightnessMode *mode)
+{
+    static const AutoBrightnessMode modes[] = {
+        AUTO_BRIGHTNESS_MODE_DISABLED,
+        AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE,
+        AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR,
+        AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS(modes); i++) {
+        if (g_strcmp0(name, dbus_service_mode_to_string(modes[i])) == 0) {
+            *mode = modes[i];
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static AutoBrightnessMode monitor_object_get_mode(MonitorObject *object)
+{
+    AppConfig *config = brightness_engine_get_config(object->service->engine);
+    return config_get_monitor_auto_brightness_mode(config, monitor_get_config_key(object->monitor));
+}
+
+static MonitorObject* find_object(DbusService *service, Monitor *monitor)
+{
+    for (GList *iter = service->objects; iter; iter = iter->next) {
+        MonitorObject *object = iter->data;
+        if (object->monitor == monitor) {
+            return object;
+        }
+    }
+    return NULL;
+}
+
+/* Emit org.freedesktop.DBus.Properties.PropertiesChanged; consumes changed */
+static void emit_properties_changed(DbusService *service, const char *object_path,
+                                    const char *interface, GVariantBuilder *changed)
+{
+    GError *error = NULL;
+
+    if (!g_dbus_connection_emit_signal(service->connection, NULL, object_path,
+                                       "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                                       g_variant_new("(sa{sv}as)", interface, changed, NULL),
+                                       &error)) {
+        g_warning("Failed to emit PropertiesChanged on %s: %s", object_path, error->message);
+        g_error_free(error);
+    }
+}
+
+/* Announce the monitor properties that changed since the last announcement */
+static void update_monitor_object(MonitorObject *object)
+{
+    Monitor *monitor = object->monitor;
+    int brightness = monitor_get_current_brightness(monitor);
+    int target_brightness = monitor_get_target_brightness(monitor);
+    AutoBrightnessMode mode = monitor_object_get_mode(object);
+    MonitorHealthState health = monitor_get_health_state(monitor);
+    gboolean available = monitor_is_available(monitor);
+    GVariantBuilder changed;
+    gboolean any = FALSE;
+
+    g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+
+    if (brightness != object->brightness) {
+        object->brightness = brightness;
+        g_variant_builder_add(&changed, "{sv}", "Brightness", g_variant_new_int32(brightness));
+        any = TRUE;
+    }
+    if (target_brightness != object->target_brightness) {
+        object->target_brightness = target_brightness;
+        g_variant_builder_add(&changed, "{sv}", "TargetBrightness", g_variant_new_int32(target_brightness));
+        any = TRUE;
+    }
+    if (mode != object->mode) {
+        object->mode = mode;
+        g_variant_builder_add(&changed, "{sv}", "Mode", g_variant_new_string(dbus_service_mode_to_string(mode)));
+        any = TRUE;
+    }
+    if (health != object->health) {
+        object->health = health;
+        g_variant_builder_add(&changed, "{sv}", "Health",
+                              g_variant_new_string(monitor_health_state_to_string(health)));
+        any = TRUE;
+    }
+    if (available != object->available) {
+        object->available = available;
+        g_variant_builder_add(&changed, "{sv}", "Available", g_variant_new_boolean(available));
+        any = TRUE;
+    }
+
+    if (!any || !object->registration_id) {
+        g_variant_builder_clear(&changed);
+        return;
+    }
+
+    emit_properties_changed(object->service, object->object_path, DBUS_SERVICE_MONITOR_INTERFACE, &changed);
+}
+
+/* Object paths of the exported monitors, in the engine's order */
+static GVariant* build_monitor_paths(DbusService *service)
+{
+    MonitorList *monitors = brightness_engine_get_monitors(service->engine);
+    GVariantBuilder paths;
+
+    g_variant_builder_init(&paths, G_VARIANT_TYPE("ao"));
+    for (int i = 0; i < monitor_list_get_count(monitors); i++) {
+        MonitorObject *object = find_object(service, monitor_list_get_monitor(monitors, i));
+        if (object) {
+            g_variant_builder_add(&paths, "o", object->object_path);
+        }
+    }
+    return g_variant_builder_end(&paths);
+}
+
+/* Disable the monitor's automatic mode and write brightness */
+static void set_manual_brightness(BrightnessEngine *engine, Monitor *monitor, int brightness)
+{
+    brightness_engine_set_mode(engine, monitor, AUTO_BRIGHTNESS_MODE_DISABLED);
+    brightness_engine_set_brightness(engine, monitor, brightness);
+}
+
+/* Step brightness; automatic mode is disabled only if the step was applied */
+static int step_manual_brightness(BrightnessEngine *engine, Monitor *monitor, int delta)
+{
+    int brightness = brightness_engine_step_brightness(engine, monitor, delta);
+    if (brightness >= 0) {
+        brightness_engine_set_mode(engine, monitor, AUTO_BRIGHTNESS_MODE_DISABLED);
+    }
+    return brightness;
+}
+
+/* Methods on the root object apply to every monitor */
+static void on_root_method_call(GDBusConnection *connection, const char *sender,
+                                const char *object_path, const char *interface_name,
+                                const char *method_name, GVariant *parameters,
+                                GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    DbusService *service = user_data;
+    MonitorList *monitors = brightness_engine_get_monitors(service->engine);
+    int count = monitor_list_get_count(monitors);
+    gint32 value;
+    (void)connection; (void)sender; (void)object_path; (void)interface_name;
+
+    if (strcmp(method_name, "GetStatistics") == 0) {
+        char *report = brightness_engine_format_stats(service->engine);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(s)", report));
+        g_free(report);
+        return;
+    }
+
+    if (count == 0) {
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                                              "No controllable monitors");
+        return;
+    }
+
+    g_variant_get(parameters, "(i)", &value);
+
+    if (strcmp(method_name, "SetBrightness") == 0) {
+        if (value < 0 || value > 100) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Brightness %d is outside 0-100", value);
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            set_manual_brightness(service->engine, monitor_list_get_monitor(monitors, i), value);
+        }
+    } else if (strcmp(method_name, "StepBrightness") == 0) {
+        int stepped = 0;
+        for (int i = 0; i < count; i++) {
+            if (step_manual_brightness(service->engine, monitor_list_get_monitor(monitors, i), value) >= 0) {
+                stepped++;
+            }
+        }
+        if (stepped == 0) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                                                  "Brightness of the monitors is not known yet");
+            return;
+        }
+    }
+
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+static void on_monitor_method_call(GDBusConnection *connection, const char *sender,
+                                   const char *object_path, const char *interface_name,
+                                   const char *method_name, GVariant *parameters,
+                                   GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    MonitorObject *object = user_data;
+    BrightnessEngine *engine = object->service->engine;
+    (void)connection; (void)sender; (void)object_path; (void)interface_name;
+
+    if (strcmp(method_name, "SetBrightness") == 0) {
+        gint32 brightness;
+        g_variant_get(parameters, "(i)", &brightness);
+        if (brightness < 0 || brightness > 100) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Brightness %d is outside 0-100", brightness);
+            return;
+        }
+        set_manual_brightness(engine, object->monitor, brightness);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (strcmp(method_name, "StepBrightness") == 0) {
+        gint32 delta;
+        g_variant_get(parameters, "(i)", &delta);
+        int brightness = step_manual_brightness(engine, object->monitor, delta);
+        if (brightness < 0) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                                                  "Brightness of %s is not known yet",
+                                                  monitor_get_display_name(object->monitor));
+            return;
+        }
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(i)", brightness));
+    } else if (strcmp(method_name, "SetMode") == 0) {
+        const char *name;
+        AutoBrightnessMode mode;
+        g_variant_get(parameters, "(&s)", &name);
+
+        if (!dbus_service_mode_from_string(name, &mode)) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Unknown mode '%s'", name);
+            return;
+        }
+        if ((mode == AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR &&
+             !light_sensor_is_available(brightness_engine_get_light_sensor(engine))) ||
+            (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY &&
+             !laptop_backlight_is_available(brightness_engine_get_laptop_backlight(engine)))) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                                                  "Mode '%s' is not available on this system", name);
+            return;
+        }
+
+        brightness_engine_set_mode(engine, object->monitor, mode);
+        brightness_engine_apply_mode(engine, object->monitor);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    }
+}
+
+static GVariant* on_root_get_property(GDBusConnection *connection, const char *sender,
+                                      const char *object_path, const char *interface_name,
+                                      const char *property_name, GError **error, gpointer user_data)
+{
+    DbusService *service = user_data;
+    LightSensor *sensor = brightness_engine_get_light_sensor(service->engine);
+    (void)connection; (void)sender; (void)object_path; (void)interface_name; (void)error;
+
+    if (strcmp(property_name, "Monitors") == 0) {
+        return build_monitor_paths(service);
+    } else if (strcmp(property_name, "Lux") == 0) {
+        /* The sensor is idle unless a monitor or frontend uses it; read it
+         * now rather than answer with an old sample */
+        return g_variant_new_double(brightness_engine_get_lux(service->engine));
+    } else if (strcmp(property_name, "LightSensorAvailable") == 0) {
+        return g_variant_new_boolean(light_sensor_is_available(sensor));
+    }
+    return NULL;
+}
+
+static GVariant* on_monitor_get_property(GDBusConnection *connection, const char *sender,
+                                         const char *object_path, const char *interface_name,
+                                         const char *property_name, GError **error, gpointer user_data)
+{
+    MonitorObject *object = user_data;
+    Monitor *monitor = object->monitor;
+    (void)connection; (void)sender; (void)object_path; (void)interface_name; (void)error;
+
+    if (strcmp(property_name, "Name") == 0) {
+        return g_variant_new_string(monitor_get_display_name(monitor));
+    } else if (strcmp(property_name, "Identity") == 0) {
+        const char *identity = monitor_get_identity(monitor);
+        return g_variant_new_string(identity ? identity : "");
+    } else if (strcmp(property_name, "DevicePath") == 0) {
+        return g_variant_new_string(monitor_get_device_path(monitor));
+    } else if (strcmp(property_name, "Brightness") == 0) {
+        return g_variant_new_int32(monitor_get_current_brightness(monitor));
+    } else if (strcmp(property_name, "TargetBrightness") == 0) {
+        return g_variant_new_int32(monitor_get_target_brightness(monitor));
+    } else if (strcmp(property_name, "Mode") == 0) {
+        return g_variant_new_string(dbus_service_mode_to_string(monitor_object_get_mode(object)));
+    } else if (strcmp(property_name, "Health") == 0) {
+        return g_variant_new_string(monitor_health_state_to_string(monitor_get_health_state(monitor)));
+    } else if (strcmp(property_name, "Available") == 0) {
+        return g_variant_new_boolean(monitor_is_available(monitor));
+    }
+    return NULL;
+}
+
+static const GDBusInterfaceVTable root_vtable = {
+    on_root_method_call,
+    on_root_get_property,
+    NULL,
+    { 0 }
+};
+
+static const GDBusInterfaceVTable monitor_vtable = {
+    on_monitor_method_call,
+    on_monitor_get_property,
+    NULL,
+    { 0 }
+};
+
+static void register_monitor_object(MonitorObject *object)
+{
+    DbusService *service = object->service;
+    GError *error = NULL;
+
+    if (!service->connection || object->registration_id) {
+        return;
+    }
+
+    object->registration_id = g_dbus_connection_register_object(
+        service->connection, object->object_path,
+        g_dbus_node_info_lookup_interface(service->introspection, DBUS_SERVICE_MONITOR_INTERFACE),
+        &monitor_vtable, object, NULL, &error);
+    if (!object->registration_id) {
+        g_warning("Failed to export %s: %s", object->object_path, error->message);
+        g_error_free(error);
+    }
+}
+
+static void unregister_monitor_object(MonitorObject *object)
+{
+    if (object->registration_id) {
+        g_dbus_connection_unregister_object(object->service->connection, object->registration_id);
+        object->registration_id = 0;
+    }
+}
+
+static void monitor_object_free(MonitorObject *object)
+{
+    unregister_monitor_object(object);
+    monitor_unref(object->monitor);
+    g_free(object->object_path);
+    g_free(object);
+}
+
+/* Export new monitors and drop objects of monitors that are gone */
+static void sync_monitor_objects(DbusService *service)
+{
+    MonitorList *monitors = brightness_engine_get_monitors(service->engine);
+
+    GList *iter = service->objects;
+    while (iter) {
+        GList *next = iter->next;
+        MonitorObject *object = iter->data;
+        if (monitor_list_index_of(monitors, object->monitor) < 0) {
+            monitor_object_free(object);
+            service->objects = g_list_delete_link(service->objects, iter);
+        }
+        iter = next;
+    }
+
+    for (int i = 0; i < monitor_list_get_count(monitors); i++) {
+        Monitor *monitor = monitor_list_get_monitor(monitors, i);
+        if (find_object(service, monitor)) {
+            continue;
+        }
+
+        MonitorObject *object = g_new0(MonitorObject, 1);
+        object->service = service;
+        object->monitor = monitor_ref(monitor);
+        object->object_path = g_strdup_printf(DBUS_SERVICE_PATH "/Monitor/%u", service->next_object_serial++);
+        object->brightness = monitor_get_current_brightness(monitor);
+        object->target_brightness = monitor_get_target_brightness(monitor);
+        object->mode = monitor_object_get_mode(object);
+        object->health = monitor_get_health_state(monitor);
+        object->available = monitor_is_available(monitor);
+        service->objects = g_list_append(service->objects, object);
+
+        register_monitor_object(object);
+    }
+}
+
+static void announce_monitors(DbusService *service)
+{
+    GVariantBuilder changed;
+
+    if (!service->root_registration_id) {
+        return;
+    }
+
+    g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+    g_variant_builder_add(&changed, "{sv}", "Monitors", build_monitor_paths(service));
+    emit_properties_changed(service, DBUS_SERVICE_PATH, DBUS_SERVICE_INTERFACE, &changed);
+}
+
+static void announce_lux(DbusService *service)
+{
+    double lux = light_sensor_get_last_lux(brightness_engine_get_light_sensor(service->engine));
+    GVariantBuilder changed;
+
+    if (lux == service->lux || !service->root_registration_id) {
+        return;
+    }
+    service->lux = lux;
+
+    g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+    g_variant_builder_add(&changed, "{sv}", "Lux", g_variant_new_double(lux));
+    emit_properties_changed(service, DBUS_SERVICE_PATH, DBUS_SERVICE_INTERFACE, &changed);
+}
+
+/* Engine state changed: update exported objects and signal what changed */
+static void on_engine_event(BrightnessEngine *engine, BrightnessEngineEvent event,
+                            Monitor *monitor, gpointer user_data)
+{
+    DbusService *service = user_data;
+    MonitorObject *object;
+    (void)engine;
+
+    switch (event) {
+        case BRIGHTNESS_ENGINE_EVENT_MONITORS_CHANGED:
+            sync_monitor_objects(service);
+            announce_monitors(service);
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_MONITOR_REMOVED:
+            object = find_object(service, monitor);
+            if (object) {
+                service->objects = g_list_remove(service->objects, object);
+                monitor_object_free(object);
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_BRIGHTNESS_CHANGED:
+        case BRIGHTNESS_ENGINE_EVENT_MODE_CHANGED:
+        case BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED:
+            object = find_object(service, monitor);
+            if (object) {
+                update_monitor_object(object);
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED:
+            /* Sent for every new sensor reading and whenever targets move */
+            announce_lux(service);
+            for (GList *iter = service->objects; iter; iter = iter->next) {
+                update_monitor_object(iter->data);
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_ALREADY_RUNNING:
+            /* Emitted after the name was lost; nothing is exported */
+            break;
+    }
+}
+
+/* Drop every registration, e.g. when the name was lost */
+static void unregister_all(DbusService *service)
+{
+    for (GList *iter = service->objects; iter; iter = iter->next) {
+        unregister_monitor_object(iter->data);
+    }
+
+    if (service->root_registration_id) {
+        g_dbus_connection_unregister_object(service->connection, service->root_registration_id);
+        service->root_registration_id = 0;
+    }
+
+    g_clear_object(&service->connection);
+}
+
+static void on_bus_acquired(GDBusConnection *connection, const char *name, gpointer user_data)
+{
+    DbusService *service = user_data;
+    GError *error = NULL;
+    (void)name;
+
+    service->connection = g_object_ref(connection);
+    service->root_registration_id = g_dbus_connection_register_object(
+        connection, DBUS_SERVICE_PATH,
+        g_dbus_node_info_lookup_interface(service->introspection, DBUS_SERVICE_INTERFACE),
+        &root_vtable, service, NULL, &error);
+    if (!service->root_registration_id) {
+        g_warning("Failed to export %s: %s", DBUS_SERVICE_PATH, error->message);
+        g_error_free(error);
+    }
+
+    for (GList *iter = service->objects; iter; iter = iter->next) {
+        register_monitor_object(iter->data);
+    }
+}
+
+/* Tell the owner, once, whether this instance may drive the monitors */
+static void resolve(DbusService *service, gboolean sole_instance)
+{
+    if (!service->resolved) {
+        service->resolved = TRUE;
+        service->ready(service, sole_instance, service->ready_data);
+    }
+}
+
+static void on_name_acquired(GDBusConnection *connection, const char *name, gpointer user_data)
+{
+    (void)connection;
+    g_message("Brightness control available on the session bus as %s", name);
+    resolve(user_data, TRUE);
+}
+
+static void on_name_lost(GDBusConnection *connection, const char *name, gpointer user_data)
+{
+    DbusService *service = user_data;
+
+    unregister_all(service);
+
+    if (!connection) {
+        /* No bus, or it went away later: keep running without remote control */
+        g_message("Session bus not available, D-Bus control disabled");
+        resolve(service, TRUE);
+    } else {
+        /* The request is not queued, so this only happens at startup */
+        g_message("%s is owned by another instance", name);
+        resolve(service, FALSE);
+    }
+}
+
+DbusService* dbus_service_new(BrightnessEngine *engine, DbusServiceReadyFunc ready, gpointer user_data)
+{
+    GError *error = NULL;
+
+    g_return_val_if_fail(engine != NULL && ready != NULL, NULL);
+
+    DbusService *service = g_new0(DbusService, 1);
+    service->engine = engine;
+    service->ready = ready;
+    service->ready_data = user_data;
+    service->lux = -1.0;
+
+    service->introspection = g_dbus_node_info_new_for_xml(introspection_xml, &error);
+    if (!service->introspection) {
+        g_warning("Invalid D-Bus introspection data: %s", error->message);
+        g_error_free(error);
+        g_free(service);
+        return NULL;
+    }
+
+    brightness_engine_add_listener(engine, on_engine_event, service);
+    sync_monitor_objects(service);
+
+    service->owner_id = g_bus_own_name(G_BUS_TYPE_SESSION, DBUS_SERVICE_NAME,
+                                       G_BUS_NAME_OWNER_FLAGS_DO_NOT_QUEUE,
+                                       on_bus_acquired, on_name_acquired, on_name_lost,
+                                       service, NULL);
+    return service;
+}
+
+void dbus_service_free(DbusService *service)
+{
+    if (!service) {
+        return;
+    }
+
+    brightness_engine_remove_listener(service->engine, on_engine_event, service);
+    g_bus_unown_name(service->owner_id);
+
+    unregister_all(service);
+    g_list_free_full(service->objects, (GDestroyNotify)monitor_object_free);
+    g_dbus_node_info_unref(service->introspection);
+    g_free(service);
+}
+
+/* Call a root method on the running instance. No auto-start: with nothing
+ * running there is nobody to answer. Prints errors; returns the reply or NULL. */
+static GVariant* call_running_instance(const char *method_name, GVariant *parameters,
+                                       const char *failure)
+{
+    GError *error = NULL;
+
+    GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+    if (!connection) {
+        fprintf(stderr, "Cannot connect to the session bus: %s\n", error->message);
+        g_error_free(error);
+        if (parameters) {
+            g_variant_unref(g_variant_ref_sink(parameters));
+        }
+        return NULL;
+    }
+
+    GVariant *reply = g_dbus_connection_call_sync(connection, DBUS_SERVICE_NAME, DBUS_SERVICE_PATH,
+                                                  DBUS_SERVICE_INTERFACE, method_name, parameters, NULL,
+                                                  G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                                  DBUS_CLIENT_TIMEOUT_MS, NULL, &error);
+    g_object_unref(connection);
+
+    if (!reply) {
+        fprintf(stderr, "%s (is ddc-automatic-brightness running?): %s\n", failure, error->message);
+        g_error_free(error);
+    }
+    return reply;
+}
+
+int dbus_service_run_step_client(const char *delta_text)
+{
+    char *end = NULL;
+
+    errno = 0;
+    long delta = delta_text ? strtol(delta_text, &end, 10) : 0;
+    if (!delta_text || end == delta_text || *end != '\0' || errno != 0 || delta < -100 || delta > 100) {
+        fprintf(stderr, "Invalid step '%s': expected a percentage between -100 and +100\n",
+                delta_text ? delta_text : "");
+        return 1;
+    }
+
+    GVariant *reply = call_running_instance("StepBrightness", g_variant_new("(i)", (gint32)delta),
+                                            "Brightness step failed");
+    if (!reply) {
+        return 1;
+    }
+
+    g_variant_unref(reply);
+    return 0;
+}
+
+int dbus_service_run_stats_client(void)
+{
+    GVariant *reply = call_running_instance("GetStatistics", NULL, "Reading statistics failed");
+    if (!reply) {
+        return 1;
+    }
+
+    const char *report = NULL;
+    g_variant_get(reply, "(&s)", &report);
+    fputs(report, stdout);
+    g_variant_unref(reply);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * dbus_service.h - Session bus control and state service
+ */
+
+#ifndef DBUS_SERVICE_H
+#define DBUS_SERVICE_H
+
+#include <glib.h>
+#include "brightness_engine.h"
+
+G_BEGIN_DECLS
+
+/* Well-known name and root object. The root object implements
+ * DBUS_SERVICE_INTERFACE (all monitors); each controllable monitor is
+ * exported below DBUS_SERVICE_PATH "/Monitor/N" with
+ * DBUS_SERVICE_MONITOR_INTERFACE. Properties are served from the engine's
+ * in-memory state (no DDC traffic) and change with PropertiesChanged. */
+#define DBUS_SERVICE_NAME "com.github.ddcbrightness.DDCAutomaticBrightness"
+#define DBUS_SERVICE_PATH "/com/github/ddcbrightness/DDCAutomaticBrightness"
+#define DBUS_SERVICE_INTERFACE DBUS_SERVICE_NAME
+#define DBUS_SERVICE_MONITOR_INTERFACE DBUS_SERVICE_NAME ".Monitor"
+
+typedef struct _DbusService DbusService;
+
+/* Called once, from the main loop, when the name request is settled.
+ * sole_instance is TRUE if the name is ours or there is no session bus (the
+ * engine then runs without remote control), FALSE if another instance owns
+ * it and is already driving the monitors. */
+typedef void (*DbusServiceReadyFunc)(DbusService *service, gboolean sole_instance, gpointer user_data);
+
+/* Own DBUS_SERVICE_NAME on the session bus and export the engine's state.
+ * The request is not queued: only one instance serves the name at a time. */
+DbusService* dbus_service_new(BrightnessEngine *engine, DbusServiceReadyFunc ready, gpointer user_data);
+void dbus_service_free(DbusService *service);
+
+/* Automatic mode names used on the bus ("disabled", "schedule",
+ * "light-sensor", "laptop-display") */
+const char* dbus_service_mode_to_string(AutoBrightnessMode mode);
+gboolean dbus_service_mode_from_string(const char *name, AutoBrightnessMode *mode);
+
+/* Client side: ask the running instance to step every monitor by delta
+ * percent (e.g. "+5", "-10") and return without waiting for the monitors.
+ * Prints errors and returns the process exit status. */
+int dbus_service_run_step_client(const char *delta_text);
+
+/* Client side: print the running instance's DDC statistics. Returns the
+ * process exit status. */
+int dbus_service_run_stats_client(void);
+
+G_END_DECLS
+
+#endif /* DBUS_SERVICE_H */
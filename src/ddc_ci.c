@@ -0,0 +1,365 @@
+/*
+ * ddc_ci.c - Native DDC/CI (VCP) access over /dev/i2c-N
+ *
+ * Talks the VESA DDC/CI protocol directly through the kernel i2c-dev
+ * interface, so a brightness read or write costs one I2C transaction
+ * instead of a shell, a ddccontrol process and a full ddccontrol init.
+ * ddccontrol is still used when the bus cannot be driven natively.
+ */
+
+#include "ddc_ci.h"
+#include "subprocess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <regex.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+/* Protocol constants (VESA DDC/CI 1.1) */
+#define DDC_CI_I2C_ADDRESS      0x37  /* 7-bit slave address (0x6E/0x6F on the wire) */
+#define DDC_CI_DEST_ADDRESS     0x6E  /* Display write address, seeds request checksums */
+#define DDC_CI_HOST_ADDRESS     0x51  /* Host source address */
+#define DDC_CI_REPLY_XOR        0x50  /* Virtual host address, seeds reply checksums */
+
+#define DDC_CI_OP_GET_VCP       0x01
+#define DDC_CI_OP_GET_VCP_REPLY 0x02
+#define DDC_CI_OP_SET_VCP       0x03
+
+#define DDC_CI_GET_VCP_REPLY_LEN 11   /* src, len, op, result, code, type, max(2), cur(2), chk */
+
+/* Timing: the display needs 40ms to prepare a reply and 50ms between commands */
+#define DDC_CI_REPLY_DELAY_MS   40
+#define DDC_CI_COMMAND_GAP_MS   50
+#define DDC_CI_NATIVE_ATTEMPTS  3
+
+/* A ddccontrol child still running after this long is stuck on the bus and killed */
+#define DDC_CI_DDCCONTROL_TIMEOUT_MS 4000
+
+/* DDC/CI device handle */
+struct _DdcDevice {
+    char *device_path;
+    int fd;                     /* i2c-dev file descriptor, -1 when not native */
+    gboolean native_verified;   /* A native transaction has succeeded on this bus */
+    gboolean use_ddccontrol;    /* Native access unusable, always run ddccontrol */
+    gint64 last_command_time;   /* Monotonic time of the last bus transaction (us) */
+    GMutex lock;                /* Serializes transactions from worker and main thread */
+};
+
+/* Open a DDC/CI device handle */
+DdcDevice* ddc_device_open(const char *device_path)
+{
+    DdcDevice *device = g_new0(DdcDevice, 1);
+    device->device_path = g_strdup(device_path);
+    device->fd = -1;
+    device->native_verified = FALSE;
+    device->use_ddccontrol = FALSE;
+    device->last_command_time = 0;
+    g_mutex_init(&device->lock);
+
+    if (!device_path) {
+        device->use_ddccontrol = TRUE;
+        return device;
+    }
+
+    int fd = open(device_path, O_RDWR);
+    if (fd < 0) {
+        g_message("Cannot open %s for native DDC/CI (%s), falling back to ddccontrol",
+                  device_path, strerror(errno));
+        device->use_ddccontrol = TRUE;
+        return device;
+    }
+
+    if (ioctl(fd, I2C_SLAVE, DDC_CI_I2C_ADDRESS) < 0) {
+        g_message("Cannot address DDC/CI slave on %s (%s), falling back to ddccontrol",
+                  device_path, strerror(errno));
+        close(fd);
+        device->use_ddccontrol = TRUE;
+        return device;
+    }
+
+    device->fd = fd;
+    g_debug("Opened %s for native DDC/CI", device_path);
+    return device;
+}
+
+/* Close a DDC/CI device handle */
+void ddc_device_close(DdcDevice *device)
+{
+    if (device) {
+        if (device->fd >= 0) {
+            close(device->fd);
+        }
+        g_mutex_clear(&device->lock);
+        g_free(device->device_path);
+        g_free(device);
+    }
+}
+
+/* Sleep until the minimum inter-command gap has elapsed */
+static void wait_for_command_gap(DdcDevice *device)
+{
+    if (device->last_command_time == 0) {
+        return;
+    }
+
+    gint64 elapsed = g_get_monotonic_time() - device->last_command_time;
+    gint64 gap = (gint64)DDC_CI_COMMAND_GAP_MS * 1000;
+    if (elapsed < gap) {
+        g_usleep((gulong)(gap - elapsed));
+    }
+}
+
+/* Frame and write a DDC/CI request: host address, length, payload, checksum */
+static gboolean write_request(DdcDevice *device, const guint8 *payload, int payload_len)
+{
+    guint8 packet[16];
+    int len = 0;
+
+    packet[len++] = DDC_CI_HOST_ADDRESS;
+    packet[len++] = 0x80 | (guint8)payload_len;
+    memcpy(packet + len, payload, payload_len);
+    len += payload_len;
+
+    guint8 checksum = DDC_CI_DEST_ADDRESS;
+    for (int i = 0; i < len; i++) {
+        checksum ^= packet[i];
+    }
+    packet[len++] = checksum;
+
+    wait_for_command_gap(device);
+    ssize_t written = write(device->fd, packet, len);
+    device->last_command_time = g_get_monotonic_time();
+
+    if (written != len) {
+        g_debug("DDC/CI write to %s failed: %s", device->device_path,
+                written < 0 ? strerror(errno) : "short write");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Native VCP read: Get VCP Feature request followed by its reply */
+static gboolean native_get_vcp(DdcDevice *device, guint8 vcp_code, int *current_value, int *max_value)
+{
+    guint8 request[] = { DDC_CI_OP_GET_VCP, vcp_code };
+
+    if (!write_request(device, request, sizeof(request))) {
+        return FALSE;
+    }
+
+    g_usleep(DDC_CI_REPLY_DELAY_MS * 1000);
+
+    guint8 reply[DDC_CI_GET_VCP_REPLY_LEN];
+    ssize_t got = read(device->fd, reply, sizeof(reply));
+    device->last_command_time = g_get_monotonic_time();
+
+    if (got != (ssize_t)sizeof(reply)) {
+        g_debug("DDC/CI read from %s failed: %s", device->device_path,
+                got < 0 ? strerror(errno) : "short read");
+        return FALSE;
+    }
+
+    /* A zero-length "null message" means the display is busy; caller retries */
+    int length = reply[1] & 0x7F;
+    if (!(reply[1] & 0x80) || length == 0) {
+        g_debug("DDC/CI null reply from %s", device->device_path);
+        return FALSE;
+    }
+
+    guint8 checksum = DDC_CI_REPLY_XOR;
+    for (int i = 0; i < DDC_CI_GET_VCP_REPLY_LEN - 1; i++) {
+        checksum ^= reply[i];
+    }
+    if (checksum != reply[DDC_CI_GET_VCP_REPLY_LEN - 1]) {
+        g_debug("DDC/CI reply checksum mismatch on %s", device->device_path);
+        return FALSE;
+    }
+
+    if (length != 8 || reply[2] != DDC_CI_OP_GET_VCP_REPLY || reply[4] != vcp_code) {
+        g_debug("Unexpected DDC/CI reply on %s (len=%d op=0x%02x code=0x%02x)",
+                device->device_path, length, reply[2], reply[4]);
+        return FALSE;
+    }
+
+    if (reply[3] != 0x00) {
+        g_debug("Display on %s reports VCP 0x%02x unsupported", device->device_path, vcp_code);
+        return FALSE;
+    }
+
+    if (max_value) *max_value = (reply[6] << 8) | reply[7];
+    if (current_value) *current_value = (reply[8] << 8) | reply[9];
+    return TRUE;
+}
+
+/* Native VCP write: Set VCP Feature (no reply is defined by the protocol) */
+static gboolean native_set_vcp(DdcDevice *device, guint8 vcp_code, int value)
+{
+    guint8 request[] = {
+        DDC_CI_OP_SET_VCP,
+        vcp_code,
+        (guint8)((value >> 8) & 0xFF),
+        (guint8)(value & 0xFF)
+    };
+
+    return write_request(device, request, sizeof(request));
+}
+
+/* Parser state for "ddccontrol -r" output */
+typedef struct {
+    regex_t regex;
+    int current_value;
+    int max_value;
+    gboolean found;
+} DdccontrolReadParse;
+
+/* Look for "Control 0x10: +/current/max [...]" */
+static void on_ddccontrol_read_line(const char *line, gpointer user_data)
+{
+    DdccontrolReadParse *parse = (DdccontrolReadParse*)user_data;
+    regmatch_t matches[3];
+
+    if (!parse->found && regexec(&parse->regex, line, 3, matches, 0) == 0) {
+        parse->current_value = atoi(line + matches[1].rm_so);
+        parse->max_value = atoi(line + matches[2].rm_so);
+        parse->found = TRUE;
+    }
+}
+
+/* Fallback VCP read through ddccontrol */
+static gboolean ddccontrol_get_vcp(const char *device_path, guint8 vcp_code, int *current_value, int *max_value)
+{
+    char vcp_arg[8];
+    char *device_arg = g_strdup_printf("dev:%s", device_path);
+    snprintf(vcp_arg, sizeof(vcp_arg), "0x%02x", vcp_code);
+    const char *argv[] = { "ddccontrol", "-r", vcp_arg, device_arg, NULL };
+
+    DdccontrolReadParse parse;
+    parse.found = FALSE;
+
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "Control 0x%02x: \\+/([0-9]+)/([0-9]+)", vcp_code);
+    if (regcomp(&parse.regex, pattern, REG_EXTENDED | REG_ICASE) != 0) {
+        g_warning("Failed to compile regex for VCP parsing");
+        g_free(device_arg);
+        return FALSE;
+    }
+
+    /* ddccontrol's exit status is unreliable for reads; the parsed value decides */
+    subprocess_run_sync(argv, DDC_CI_DDCCONTROL_TIMEOUT_MS, on_ddccontrol_read_line, &parse);
+
+    regfree(&parse.regex);
+    g_free(device_arg);
+
+    if (parse.found) {
+        if (current_value) *current_value = parse.current_value;
+        if (max_value) *max_value = parse.max_value;
+    }
+    return parse.found;
+}
+
+/* Fallback VCP write through ddccontrol */
+static gboolean ddccontrol_set_vcp(const char *device_path, guint8 vcp_code, int value)
+{
+    char vcp_arg[8];
+    char value_arg[16];
+    char *device_arg = g_strdup_printf("dev:%s", device_path);
+    snprintf(vcp_arg, sizeof(vcp_arg), "0x%02x", vcp_code);
+    snprintf(value_arg, sizeof(value_arg), "%d", value);
+    const char *argv[] = { "ddccontrol", "-r", vcp_arg, "-w", value_arg, device_arg, NULL };
+
+    gboolean success = subprocess_run_sync(argv, DDC_CI_DDCCONTROL_TIMEOUT_MS, NULL, NULL);
+
+    g_free(device_arg);
+    return success;
+}
+
+/* Read a VCP feature with the device lock held */
+static gboolean get_vcp_locked(DdcDevice *device, guint8 vcp_code, int *current_value, int *max_value)
+{
+    if (!device->use_ddccontrol && device->fd >= 0) {
+        for (int attempt = 0; attempt < DDC_CI_NATIVE_ATTEMPTS; attempt++) {
+            if (native_get_vcp(device, vcp_code, current_value, max_value)) {
+                device->native_verified = TRUE;
+                return TRUE;
+            }
+        }
+
+        /* Once native access has worked on this bus, a failure is a real
+         * failure; don't add a ddccontrol run on top of a struggling link. */
+        if (device->native_verified) {
+            return FALSE;
+        }
+
+        /* Never worked natively: some displays need ddccontrol's quirk handling */
+        if (!ddccontrol_get_vcp(device->device_path, vcp_code, current_value, max_value)) {
+            return FALSE;
+        }
+
+        g_message("Native DDC/CI unusable on %s, using ddccontrol for this bus",
+                  device->device_path);
+        device->use_ddccontrol = TRUE;
+        return TRUE;
+    }
+
+    return ddccontrol_get_vcp(device->device_path, vcp_code, current_value, max_value);
+}
+
+/* Write a VCP feature with the device lock held */
+static gboolean set_vcp_locked(DdcDevice *device, guint8 vcp_code, int value)
+{
+    if (!device->use_ddccontrol && device->fd >= 0) {
+        for (int attempt = 0; attempt < DDC_CI_NATIVE_ATTEMPTS; attempt++) {
+            if (native_set_vcp(device, vcp_code, value)) {
+                return TRUE;
+            }
+        }
+
+        if (device->native_verified) {
+            return FALSE;
+        }
+
+        if (!ddccontrol_set_vcp(device->device_path, vcp_code, value)) {
+            return FALSE;
+        }
+
+        g_message("Native DDC/CI unusable on %s, using ddccontrol for this bus",
+                  device->device_path);
+        device->use_ddccontrol = TRUE;
+        return TRUE;
+    }
+
+    return ddccontrol_set_vcp(device->device_path, vcp_code, value);
+}
+
+/* Read a VCP feature (current and maximum value) */
+gboolean ddc_device_get_vcp(DdcDevice *device, guint8 vcp_code, int *current_value, int *max_value)
+{
+    if (!device || !device->device_path) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&device->lock);
+    gboolean success = get_vcp_locked(device, vcp_code, current_value, max_value);
+    g_mutex_unlock(&device->lock);
+
+    return success;
+}
+
+/* Write a VCP feature */
+gboolean ddc_device_set_vcp(DdcDevice *device, guint8 vcp_code, int value)
+{
+    if (!device || !device->device_path || value < 0 || value > 0xFFFF) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&device->lock);
+    gboolean success = set_vcp_locked(device, vcp_code, value);
+    g_mutex_unlock(&device->lock);
+
+    return success;
+}
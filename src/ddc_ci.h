@@ -0,0 +1,31 @@
+/*
+ * ddc_ci.h - Native DDC/CI (VCP) access over /dev/i2c-N
+ */
+
+#ifndef DDC_CI_H
+#define DDC_CI_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* VCP feature codes */
+#define DDC_VCP_BRIGHTNESS 0x10
+
+/* DDC/CI device handle (one per I2C bus) */
+typedef struct _DdcDevice DdcDevice;
+
+/* Open a device handle. Never returns NULL: if the bus cannot be opened
+ * natively (missing i2c-dev permissions, busy adapter) the handle falls
+ * back to running ddccontrol for every command. */
+DdcDevice* ddc_device_open(const char *device_path);
+void ddc_device_close(DdcDevice *device);
+
+/* VCP Get/Set. Blocking (a Get takes ~40-50ms natively) and thread-safe;
+ * transactions on one device are serialized. */
+gboolean ddc_device_get_vcp(DdcDevice *device, guint8 vcp_code, int *current_value, int *max_value);
+gboolean ddc_device_set_vcp(DdcDevice *device, guint8 vcp_code, int value);
+
+G_END_DECLS
+
+#endif /* DDC_CI_H */
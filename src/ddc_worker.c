@@ -0,0 +1,297 @@
+/*
+ * ddc_worker.c - Per-bus DDC/CI worker threads and per-monitor command queues
+ *
+ * Each I2C bus gets one worker thread that executes DDC/CI commands in
+ * submission order, so a slow or stuck bus only delays its own monitor and
+ * monitors on different buses are driven concurrently. The GTK main loop
+ * never waits on I2C: results are marshalled back with g_idle_add().
+ *
+ * Writes submitted with ddc_queue_set_vcp_latest() share a single pending
+ * slot per queue: while a slot write is still waiting for the bus, newer
+ * values overwrite it, and the worker reads the value only when it starts
+ * the transaction. A burst of writes therefore costs at most one queued
+ * command, and the last value always lands.
+ *
+ * Threading rules: queues, bus workers and the registry are created,
+ * referenced and freed on the main thread only. Worker threads touch a
+ * queue's device, its detached flag and (under slot_lock) its slot.
+ */
+
+#include "ddc_worker.h"
+#include <string.h>
+
+/* Bus worker: one thread per I2C device path */
+typedef struct {
+    char *device_path;
+    GThread *thread;
+    GAsyncQueue *jobs;
+    int ref_count;          /* Number of DdcQueues bound to this bus */
+} DdcBusWorker;
+
+/* Monitor command queue */
+struct _DdcQueue {
+    DdcDevice *device;
+    DdcBusWorker *worker;
+    int ref_count;          /* Owner + one per submitted job */
+    guint pending;          /* Jobs whose completion has not been delivered */
+    gint detached;          /* Set by the owner on teardown, read by the worker */
+    GMutex slot_lock;       /* Guards slot_job and the value of the job it points to */
+    struct _DdcJob *slot_job;  /* Latest-value-wins write not yet started, or NULL */
+    gint64 write_latency;   /* EWMA of successful write transaction time (us), 0 = unmeasured */
+    gint64 last_elapsed;    /* Transaction time of the job being delivered (us) */
+};
+
+/* A single DDC command */
+typedef struct _DdcJob {
+    DdcQueue *queue;
+    gboolean is_set;
+    guint8 vcp_code;
+    int value;
+    int max_value;
+    gboolean success;
+    gint64 elapsed;         /* Bus transaction time measured by the worker (us) */
+    DdcCompletionFunc func;
+    gpointer user_data;
+    GDestroyNotify destroy;
+} DdcJob;
+
+/* Weight of the newest sample in the write latency average */
+#define DDC_LATENCY_EWMA_WEIGHT 0.25
+
+/* Sentinel pushed to a bus worker to make its thread exit */
+static DdcJob bus_stop_job;
+
+/* Registry of running bus workers (device_path -> DdcBusWorker*) */
+static GHashTable *bus_workers = NULL;
+
+/* Drop one queue reference; frees the queue and releases its bus when unused */
+static void ddc_queue_unref(DdcQueue *queue)
+{
+    if (--queue->ref_count > 0) {
+        return;
+    }
+
+    DdcBusWorker *worker = queue->worker;
+
+    ddc_device_close(queue->device);
+    g_mutex_clear(&queue->slot_lock);
+    g_free(queue);
+
+    if (--worker->ref_count == 0) {
+        g_hash_table_remove(bus_workers, worker->device_path);
+        g_async_queue_push(worker->jobs, &bus_stop_job);
+        g_thread_unref(worker->thread);
+    }
+}
+
+/* Deliver a finished job on the main loop */
+static gboolean job_complete_idle(gpointer data)
+{
+    DdcJob *job = (DdcJob*)data;
+    DdcQueue *queue = job->queue;
+
+    queue->pending--;
+
+    if (job->is_set && job->success) {
+        if (queue->write_latency == 0) {
+            queue->write_latency = job->elapsed;
+        } else {
+            queue->write_latency += (gint64)(DDC_LATENCY_EWMA_WEIGHT *
+                                             (double)(job->elapsed - queue->write_latency));
+        }
+    }
+
+    queue->last_elapsed = job->elapsed;
+    if (!g_atomic_int_get(&queue->detached) && job->func) {
+        job->func(job->success, job->value, job->max_value, job->user_data);
+    }
+
+    if (job->destroy) {
+        job->destroy(job->user_data);
+    }
+
+    g_free(job);
+    ddc_queue_unref(queue);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Worker thread: execute jobs for one bus in order */
+static gpointer bus_worker_thread(gpointer data)
+{
+    DdcBusWorker *worker = (DdcBusWorker*)data;
+
+    for (;;) {
+        DdcJob *job = (DdcJob*)g_async_queue_pop(worker->jobs);
+        if (job == &bus_stop_job) {
+            break;
+        }
+
+        /* A slot write leaves the slot once started; its value is final from here on */
+        g_mutex_lock(&job->queue->slot_lock);
+        if (job->queue->slot_job == job) {
+            job->queue->slot_job = NULL;
+        }
+        g_mutex_unlock(&job->queue->slot_lock);
+
+        /* Skip commands for monitors that went away while queued */
+        if (!g_atomic_int_get(&job->queue->detached)) {
+            gint64 started = g_get_monotonic_time();
+            if (job->is_set) {
+                job->success = ddc_device_set_vcp(job->queue->device, job->vcp_code, job->value);
+            } else {
+                job->success = ddc_device_get_vcp(job->queue->device, job->vcp_code,
+                                                  &job->value, &job->max_value);
+            }
+            job->elapsed = g_get_monotonic_time() - started;
+        }
+
+        g_idle_add(job_complete_idle, job);
+    }
+
+    g_async_queue_unref(worker->jobs);
+    g_free(worker->device_path);
+    g_free(worker);
+    return NULL;
+}
+
+/* Find or start the worker for a bus */
+static DdcBusWorker* bus_worker_acquire(const char *device_path)
+{
+    if (!bus_workers) {
+        bus_workers = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    DdcBusWorker *worker = g_hash_table_lookup(bus_workers, device_path);
+    if (worker) {
+        worker->ref_count++;
+        return worker;
+    }
+
+    worker = g_new0(DdcBusWorker, 1);
+    worker->device_path = g_strdup(device_path);
+    worker->jobs = g_async_queue_new();
+    worker->ref_count = 1;
+
+    char *thread_name = g_strdup_printf("ddc:%s", device_path);
+    worker->thread = g_thread_new(thread_name, bus_worker_thread, worker);
+    g_free(thread_name);
+
+    g_hash_table_insert(bus_workers, worker->device_path, worker);
+    g_debug("Started DDC worker thread for %s", device_path);
+    return worker;
+}
+
+/* Create a queue for a device path */
+DdcQueue* ddc_queue_new(const char *device_path)
+{
+    g_return_val_if_fail(device_path != NULL, NULL);
+
+    DdcQueue *queue = g_new0(DdcQueue, 1);
+    queue->device = ddc_device_open(device_path);
+    queue->worker = bus_worker_acquire(device_path);
+    queue->ref_count = 1;
+    queue->pending = 0;
+    queue->detached = FALSE;
+    g_mutex_init(&queue->slot_lock);
+    queue->slot_job = NULL;
+    queue->write_latency = 0;
+
+    return queue;
+}
+
+/* Detach a queue from its owner */
+void ddc_queue_detach(DdcQueue *queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    g_atomic_int_set(&queue->detached, TRUE);
+    ddc_queue_unref(queue);
+}
+
+/* Number of commands in flight */
+guint ddc_queue_get_pending(DdcQueue *queue)
+{
+    return queue ? queue->pending : 0;
+}
+
+/* Average time a brightness write occupies the bus */
+gint64 ddc_queue_get_write_latency(DdcQueue *queue)
+{
+    return queue ? queue->write_latency : 0;
+}
+
+/* Transaction time of the command whose completion is being delivered */
+gint64 ddc_queue_get_last_elapsed(DdcQueue *queue)
+{
+    return queue ? queue->last_elapsed : 0;
+}
+
+/* Queue a job on the bus worker */
+static void submit_job(DdcQueue *queue, DdcJob *job)
+{
+    job->queue = queue;
+    queue->ref_count++;
+    queue->pending++;
+    g_async_queue_push(queue->worker->jobs, job);
+}
+
+/* Submit a VCP read */
+void ddc_queue_get_vcp(DdcQueue *queue, guint8 vcp_code,
+                       DdcCompletionFunc func, gpointer user_data, GDestroyNotify destroy)
+{
+    g_return_if_fail(queue != NULL);
+
+    DdcJob *job = g_new0(DdcJob, 1);
+    job->is_set = FALSE;
+    job->vcp_code = vcp_code;
+    job->value = -1;
+    job->max_value = -1;
+    job->func = func;
+    job->user_data = user_data;
+    job->destroy = destroy;
+
+    submit_job(queue, job);
+}
+
+/* Submit a VCP write that replaces any slot write still waiting for the bus */
+void ddc_queue_set_vcp_latest(DdcQueue *queue, guint8 vcp_code, int value,
+                              DdcCompletionFunc func, gpointer user_data, GDestroyNotify destroy)
+{
+    g_return_if_fail(queue != NULL);
+
+    g_mutex_lock(&queue->slot_lock);
+    DdcJob *job = queue->slot_job;
+    if (job && job->vcp_code == vcp_code) {
+        /* Coalesce: the superseded request is released without a callback */
+        GDestroyNotify old_destroy = job->destroy;
+        gpointer old_user_data = job->user_data;
+
+        job->value = value;
+        job->func = func;
+        job->user_data = user_data;
+        job->destroy = destroy;
+        g_mutex_unlock(&queue->slot_lock);
+
+        if (old_destroy) {
+            old_destroy(old_user_data);
+        }
+        return;
+    }
+
+    job = g_new0(DdcJob, 1);
+    job->is_set = TRUE;
+    job->vcp_code = vcp_code;
+    job->value = value;
+    job->max_value = -1;
+    job->func = func;
+    job->user_data = user_data;
+    job->destroy = destroy;
+
+    queue->slot_job = job;
+    g_mutex_unlock(&queue->slot_lock);
+
+    submit_job(queue, job);
+}
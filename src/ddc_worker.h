@@ -0,0 +1,53 @@
+/*
+ * ddc_worker.h - Per-bus DDC/CI worker threads and per-monitor command queues
+ */
+
+#ifndef DDC_WORKER_H
+#define DDC_WORKER_H
+
+#include <glib.h>
+#include "ddc_ci.h"
+
+G_BEGIN_DECLS
+
+/* Command queue for one monitor. Commands run in order on the worker thread
+ * that owns the monitor's I2C bus; completions are delivered on the main loop. */
+typedef struct _DdcQueue DdcQueue;
+
+/* Completion callback, always invoked on the main loop.
+ * For a Get, value/max_value hold the VCP reading; for a Set, value is the written value. */
+typedef void (*DdcCompletionFunc)(gboolean success, int value, int max_value, gpointer user_data);
+
+/* Create a queue for a device path; opens the bus and attaches it to the bus worker.
+ * Must be called from the main thread. */
+DdcQueue* ddc_queue_new(const char *device_path);
+
+/* Detach a queue from its owner: commands not yet started are dropped and
+ * completion callbacks are no longer invoked (destroy notifies still run).
+ * The device is closed once in-flight commands have drained. */
+void ddc_queue_detach(DdcQueue *queue);
+
+/* Number of submitted commands whose completion has not been delivered yet */
+guint ddc_queue_get_pending(DdcQueue *queue);
+
+/* Moving average of how long a successful write keeps the bus busy, including
+ * the inter-command gap (microseconds; 0 until the first write completes) */
+gint64 ddc_queue_get_write_latency(DdcQueue *queue);
+
+/* Bus transaction time of the command whose completion callback is running
+ * (microseconds; only meaningful inside a completion callback) */
+gint64 ddc_queue_get_last_elapsed(DdcQueue *queue);
+
+/* Submit commands (main thread only) */
+void ddc_queue_get_vcp(DdcQueue *queue, guint8 vcp_code,
+                       DdcCompletionFunc func, gpointer user_data, GDestroyNotify destroy);
+
+/* Latest-value-wins write: if an earlier slot write for the same VCP code has
+ * not reached the bus yet, its value is replaced and its callback is dropped
+ * (destroy still runs). The value is read when the transaction starts. */
+void ddc_queue_set_vcp_latest(DdcQueue *queue, guint8 vcp_code, int value,
+                              DdcCompletionFunc func, gpointer user_data, GDestroyNotify destroy);
+
+G_END_DECLS
+
+#endif /* DDC_WORKER_H */
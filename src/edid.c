@@ -0,0 +1,153 @@
+/*
+ * edid.c - EDID parsing for stable monitor identification
+ *
+ * The kernel exposes each connector's EDID in /sys/class/drm/<connector>/edid,
+ * cached from the hotplug read, so identifying a monitor costs no I2C traffic.
+ */
+
+#include "edid.h"
+#include <stdio.h>
+#include <string.h>
+
+#define EDID_BLOCK_SIZE 128
+#define EDID_DESCRIPTOR_OFFSET 54
+#define EDID_DESCRIPTOR_SIZE 18
+#define EDID_DESCRIPTOR_COUNT 4
+
+#define EDID_DESCRIPTOR_SERIAL 0xFF
+#define EDID_DESCRIPTOR_NAME 0xFC
+
+static const guint8 edid_header[8] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+/* Copy a 13-byte descriptor text field, stopping at the 0x0A terminator */
+static void copy_descriptor_text(const guint8 *text, char *out)
+{
+    int len = 0;
+    while (len < 13 && text[len] != 0x0A && text[len] != 0x00) {
+        out[len] = g_ascii_isprint(text[len]) ? (char)text[len] : '?';
+        len++;
+    }
+    out[len] = '\0';
+
+    /* Strip padding */
+    while (len > 0 && out[len - 1] == ' ') {
+        out[--len] = '\0';
+    }
+}
+
+/* Parse an EDID base block */
+gboolean edid_parse(const guint8 *data, gsize length, EdidInfo *info)
+{
+    if (!data || !info || length < EDID_BLOCK_SIZE) {
+        return FALSE;
+    }
+
+    if (memcmp(data, edid_header, sizeof(edid_header)) != 0) {
+        return FALSE;
+    }
+
+    guint8 checksum = 0;
+    for (int i = 0; i < EDID_BLOCK_SIZE; i++) {
+        checksum += data[i];
+    }
+    if (checksum != 0) {
+        g_debug("EDID checksum mismatch");
+        return FALSE;
+    }
+
+    memset(info, 0, sizeof(*info));
+
+    /* Manufacturer: three 5-bit letters, big-endian, 'A' = 1 */
+    guint16 mfg = (guint16)((data[8] << 8) | data[9]);
+    info->manufacturer[0] = (char)('A' - 1 + ((mfg >> 10) & 0x1F));
+    info->manufacturer[1] = (char)('A' - 1 + ((mfg >> 5) & 0x1F));
+    info->manufacturer[2] = (char)('A' - 1 + (mfg & 0x1F));
+    info->manufacturer[3] = '\0';
+
+    /* Product code and serial are little-endian */
+    info->product_code = (guint16)(data[10] | (data[11] << 8));
+    info->serial_number = (guint32)data[12] | ((guint32)data[13] << 8) |
+                          ((guint32)data[14] << 16) | ((guint32)data[15] << 24);
+
+    /* Display descriptors start with a zero pixel clock */
+    for (int i = 0; i < EDID_DESCRIPTOR_COUNT; i++) {
+        const guint8 *desc = data + EDID_DESCRIPTOR_OFFSET + i * EDID_DESCRIPTOR_SIZE;
+        if (desc[0] != 0 || desc[1] != 0) {
+            continue;
+        }
+
+        if (desc[3] == EDID_DESCRIPTOR_SERIAL) {
+            copy_descriptor_text(desc + 5, info->serial_string);
+        } else if (desc[3] == EDID_DESCRIPTOR_NAME) {
+            copy_descriptor_text(desc + 5, info->name);
+        }
+    }
+
+    return TRUE;
+}
+
+/* Read and parse a sysfs edid file */
+gboolean edid_read_file(const char *path, EdidInfo *info)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return FALSE;
+    }
+
+    guint8 data[EDID_BLOCK_SIZE];
+    size_t n = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    return edid_parse(data, n, info);
+}
+
+/* Build the identity key */
+char* edid_build_identity(const EdidInfo *info)
+{
+    g_return_val_if_fail(info != NULL, NULL);
+
+    GString *identity = g_string_new(NULL);
+    g_string_append_printf(identity, "%s-%04X-", info->manufacturer, info->product_code);
+
+    /* Prefer the serial string; keep only characters safe in config keys */
+    gboolean has_serial = FALSE;
+    for (const char *p = info->serial_string; *p; p++) {
+        if (g_ascii_isalnum(*p)) {
+            g_string_append_c(identity, *p);
+            has_serial = TRUE;
+        }
+    }
+    if (!has_serial) {
+        g_string_append_printf(identity, "%08X", info->serial_number);
+    }
+
+    return g_string_free(identity, FALSE);
+}
+
+/* Whether the EDID carries a serial number (descriptor string or numeric field) */
+gboolean edid_has_serial(const EdidInfo *info)
+{
+    g_return_val_if_fail(info != NULL, FALSE);
+
+    for (const char *p = info->serial_string; *p; p++) {
+        if (g_ascii_isalnum(*p)) {
+            return TRUE;
+        }
+    }
+    return info->serial_number != 0;
+}
+
+/* "MFG-PRODUCT-SERIAL" has exactly two dashes; anything after a third is the
+ * connector appended to identities that do not tell monitors apart */
+char* edid_identity_strip_connector(const char *identity)
+{
+    g_return_val_if_fail(identity != NULL, NULL);
+
+    const char *p = identity;
+    for (int dashes = 0; *p; p++) {
+        if (*p == '-' && ++dashes == 3) {
+            break;
+        }
+    }
+    return g_strndup(identity, p - identity);
+}
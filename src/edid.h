@@ -0,0 +1,41 @@
+/*
+ * edid.h - EDID parsing for stable monitor identification
+ */
+
+#ifndef EDID_H
+#define EDID_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Fields of the EDID base block that identify a physical monitor */
+typedef struct {
+    char manufacturer[4];      /* PNP ID, e.g. "DEL" */
+    guint16 product_code;
+    guint32 serial_number;     /* 0 if not provided */
+    char serial_string[14];    /* Display serial number descriptor (0xFF), "" if absent */
+    char name[14];             /* Display product name descriptor (0xFC), "" if absent */
+} EdidInfo;
+
+/* Parse an EDID base block (at least 128 bytes) */
+gboolean edid_parse(const guint8 *data, gsize length, EdidInfo *info);
+
+/* Read and parse a DRM connector's sysfs edid file.
+ * Returns FALSE if the file is missing, empty (nothing connected) or invalid. */
+gboolean edid_read_file(const char *path, EdidInfo *info);
+
+/* Stable identity key "MFG-PRODUCT-SERIAL" (e.g. "DEL-A0C4-3J7QK43").
+ * Safe for use in GKeyFile group and key names. Caller must g_free. */
+char* edid_build_identity(const EdidInfo *info);
+
+/* Whether the EDID carries a serial number (descriptor string or numeric field) */
+gboolean edid_has_serial(const EdidInfo *info);
+
+/* Identity with any "-<connector>" suffix removed (see monitor detection).
+ * Caller must g_free. */
+char* edid_identity_strip_connector(const char *identity);
+
+G_END_DECLS
+
+#endif /* EDID_H */
@@ -2,62 +2,63 @@
  * light_sensor.c - Ambient light sensor implementation
  */
 
+/* pread() */
+#define _XOPEN_SOURCE 700
+
 #include "light_sensor.h"
+#include <glib-unix.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <math.h>
 
+/* Sysfs polling interval when buffered capture is unavailable */
+#define LIGHT_SENSOR_POLL_INTERVAL_MS 500
+
+/* Samples the kernel may queue in the IIO buffer between reads */
+#define LIGHT_SENSOR_BUFFER_LENGTH "16"
+
+/* Largest scan record we decode (all enabled channels plus timestamp) */
+#define LIGHT_SENSOR_MAX_SCAN_SIZE 64
+
+/* Location of the illuminance channel inside a buffered scan record */
+typedef struct {
+    gsize scan_size;        /* Bytes per record, all enabled channels */
+    gsize offset;           /* Byte offset of the illuminance value */
+    guint bytes;            /* Storage size of the value */
+    guint bits;             /* Significant bits */
+    guint shift;            /* Right shift applied before masking */
+    gboolean is_signed;
+    gboolean big_endian;
+    double scale;           /* lux = (raw + offset) * scale */
+    double value_offset;
+} LightSensorScanLayout;
+
 /* Light sensor structure */
 struct _LightSensor {
     char *device_path;
     gboolean available;
 
-    /* Calibration curve points (lux -> brightness %) */
-    struct {
-        double lux;
-        int brightness;
-    } *curve_points;
-    int num_curve_points;
+    /* Sampling */
+    LightSensorSampleFunc sample_func;
+    gpointer sample_data;
+    guint source_id;        /* Buffer fd watch or poll timer */
+    int buffer_fd;          /* /dev/iio:deviceN while buffered capture is active, else -1 */
+    LightSensorScanLayout layout;
+    gboolean restore_channel;   /* We enabled in_illuminance_en for capture */
+    gboolean restore_trigger;   /* We selected the buffer trigger */
+    char restore_length[32];    /* buffer/length before capture changed it ("" = untouched) */
+    double last_lux;        /* Latest sample (-1.0 = none yet) */
+    gint64 last_sample_time;  /* Monotonic time of the latest reading (us), 0 = none */
+
+    /* Sysfs attributes, kept open and re-read with pread() */
+    int raw_fd;
+    int scale_fd;           /* -1 if the driver has no scale attribute */
 };
 
-/* Default brightness curve mapping lux to brightness percentage */
-static void set_default_curve(LightSensor *sensor)
-{
-    /* Conservative default curve with 5 points */
-    sensor->num_curve_points = 5;
-
-    /* Anonymous struct type for curve points */
-    typedef struct {
-        double lux;
-        int brightness;
-    } CurvePoint;
-
-    sensor->curve_points = g_new(CurvePoint, sensor->num_curve_points);
-
-    /* Point 0: Dark (0 lux) -> 20% (conservative, not too dark) */
-    sensor->curve_points[0].lux = 0.0;
-    sensor->curve_points[0].brightness = 20;
-
-    /* Point 1: Dim (50 lux) -> 40% */
-    sensor->curve_points[1].lux = 50.0;
-    sensor->curve_points[1].brightness = 40;
-
-    /* Point 2: Normal indoor (200 lux) -> 70% */
-    sensor->curve_points[2].lux = 200.0;
-    sensor->curve_points[2].brightness = 70;
-
-    /* Point 3: Bright (500 lux) -> 90% */
-    sensor->curve_points[3].lux = 500.0;
-    sensor->curve_points[3].brightness = 90;
-
-    /* Point 4: Very bright (1000 lux) -> 100% */
-    sensor->curve_points[4].lux = 1000.0;
-    sensor->curve_points[4].brightness = 100;
-}
-
 /* Detect and open light sensor device */
 static gboolean detect_light_sensor(LightSensor *sensor)
 {
@@ -111,19 +112,52 @@ static gboolean detect_light_sensor(LightSensor *sensor)
     return FALSE;
 }
 
+/* Open the illuminance attributes once; reads then cost a single pread() each */
+static void open_channel_files(LightSensor *sensor)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/in_illuminance_raw", sensor->device_path);
+    sensor->raw_fd = open(path, O_RDONLY);
+    if (sensor->raw_fd < 0) {
+        g_warning("Failed to open raw file: %s", path);
+    }
+
+    snprintf(path, sizeof(path), "%s/in_illuminance_scale", sensor->device_path);
+    sensor->scale_fd = open(path, O_RDONLY);
+    if (sensor->scale_fd < 0) {
+        /* Scale might not exist, default to 1.0 */
+        g_debug("Scale file not found, using default 1.0: %s", path);
+    }
+}
+
+/* Re-read an open sysfs attribute from the start */
+static gboolean pread_attribute(int fd, char *buf, gsize size)
+{
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n <= 0) {
+        return FALSE;
+    }
+
+    buf[n] = '\0';
+    return TRUE;
+}
+
 /* Create new light sensor */
 LightSensor* light_sensor_new(void)
 {
     LightSensor *sensor = g_new0(LightSensor, 1);
-
-    /* Set default calibration curve */
-    set_default_curve(sensor);
+    sensor->buffer_fd = -1;
+    sensor->last_lux = -1.0;
+    sensor->raw_fd = -1;
+    sensor->scale_fd = -1;
 
     /* Try to detect light sensor */
     sensor->available = detect_light_sensor(sensor);
 
     if (sensor->available) {
         g_message("Light sensor detected at: %s", sensor->device_path);
+        open_channel_files(sensor);
     } else {
         g_message("No ambient light sensor detected");
     }
@@ -135,8 +169,14 @@ LightSensor* light_sensor_new(void)
 void light_sensor_free(LightSensor *sensor)
 {
     if (sensor) {
+        light_sensor_stop(sensor);
+        if (sensor->raw_fd >= 0) {
+            close(sensor->raw_fd);
+        }
+        if (sensor->scale_fd >= 0) {
+            close(sensor->scale_fd);
+        }
         g_free(sensor->device_path);
-        g_free(sensor->curve_points);
         g_free(sensor);
     }
 }
@@ -156,65 +196,41 @@ const char* light_sensor_get_device_path(LightSensor *sensor)
 /* Read raw sensor value and scale */
 gboolean light_sensor_read_raw(LightSensor *sensor, int *raw_value, double *scale)
 {
-    if (!sensor || !sensor->available || !sensor->device_path) {
+    if (!sensor || !sensor->available || sensor->raw_fd < 0) {
         return FALSE;
     }
 
     /* Read raw value */
-    char raw_path[512];
-    snprintf(raw_path, sizeof(raw_path), "%s/in_illuminance_raw", sensor->device_path);
-
-    FILE *raw_file = fopen(raw_path, "r");
-    if (!raw_file) {
-        g_warning("Failed to open raw file: %s", raw_path);
+    char raw_str[64];
+    char *endptr;
+    if (!pread_attribute(sensor->raw_fd, raw_str, sizeof(raw_str))) {
+        g_warning("Failed to read raw value from %s/in_illuminance_raw", sensor->device_path);
         return FALSE;
     }
 
-    int raw;
-    if (fscanf(raw_file, "%d", &raw) != 1) {
-        g_warning("Failed to read raw value from: %s", raw_path);
-        fclose(raw_file);
+    long raw = strtol(raw_str, &endptr, 10);
+    if (endptr == raw_str) {
+        g_warning("Failed to parse raw value '%s' from %s/in_illuminance_raw", raw_str, sensor->device_path);
         return FALSE;
     }
-    fclose(raw_file);
-
-    /* Read scale */
-    char scale_path[512];
-    snprintf(scale_path, sizeof(scale_path), "%s/in_illuminance_scale", sensor->device_path);
 
-    FILE *scale_file = fopen(scale_path, "r");
-    if (!scale_file) {
-        /* Scale might not exist, default to 1.0 */
-        g_debug("Scale file not found, using default 1.0: %s", scale_path);
-        if (raw_value) *raw_value = raw;
-        if (scale) *scale = 1.0;
-        return TRUE;
-    }
-
-    /* Read scale as string to avoid locale issues with fscanf */
+    /* Read scale as string and parse with g_ascii_strtod, which is locale-independent */
+    double scale_val = 1.0;
     char scale_str[64];
-    if (!fgets(scale_str, sizeof(scale_str), scale_file)) {
-        g_warning("Failed to read scale value from %s, using 1.0", scale_path);
-        fclose(scale_file);
-        if (raw_value) *raw_value = raw;
-        if (scale) *scale = 1.0;
-        return TRUE;
-    }
-    fclose(scale_file);
-
-    /* Use strtod which is locale-independent for parsing */
-    char *endptr;
-    double scale_val = g_ascii_strtod(scale_str, &endptr);
-
-    if (endptr == scale_str || scale_val == 0.0) {
-        /* Failed to parse, default to 1.0 */
-        g_warning("Failed to parse scale value '%s' from %s, using 1.0", scale_str, scale_path);
-        if (raw_value) *raw_value = raw;
-        if (scale) *scale = 1.0;
-        return TRUE;
+    if (sensor->scale_fd >= 0) {
+        if (!pread_attribute(sensor->scale_fd, scale_str, sizeof(scale_str))) {
+            g_warning("Failed to read scale value from %s, using 1.0", sensor->device_path);
+        } else {
+            scale_val = g_ascii_strtod(scale_str, &endptr);
+            if (endptr == scale_str || scale_val == 0.0) {
+                /* Failed to parse, default to 1.0 */
+                g_warning("Failed to parse scale value '%s' from %s, using 1.0", scale_str, sensor->device_path);
+                scale_val = 1.0;
+            }
+        }
     }
 
-    if (raw_value) *raw_value = raw;
+    if (raw_value) *raw_value = (int)raw;
     if (scale) *scale = scale_val;
 
     return TRUE;
@@ -235,117 +251,910 @@ double light_sensor_read_lux(LightSensor *sensor)
     return lux;
 }
 
-/* Linear interpolation helper */
-static int interpolate(double x, double x1, double x2, int y1, int y2)
+/* Compiled calibration curve: brightness sampled at evenly spaced log-lux
+ * positions between the first and last point. Perceived brightness follows
+ * log-lux, so the table spends its resolution where the eye does. */
+struct _LightSensorCurve {
+    double lux_min;             /* First point; below it brightness is constant */
+    double lux_max;             /* Last point; above it brightness is constant */
+    double log_min;             /* log10(lux_min + 1) */
+    double log_step;            /* log-lux distance between table entries */
+    double table[LIGHT_SENSOR_CURVE_TABLE_SIZE + 1];
+};
+
+/* Map lux to the curve's log domain; +1 keeps 0 lux finite */
+static double curve_log_lux(double lux)
+{
+    return log10(lux + 1.0);
+}
+
+/* Order curve points by lux */
+static int compare_curve_points(const void *a, const void *b)
+{
+    const LightSensorCurvePoint *pa = (const LightSensorCurvePoint *)a;
+    const LightSensorCurvePoint *pb = (const LightSensorCurvePoint *)b;
+
+    if (pa->lux < pb->lux) return -1;
+    if (pa->lux > pb->lux) return 1;
+    return 0;
+}
+
+/* Fritsch-Carlson tangents: a cubic Hermite spline through the knots that
+ * never overshoots, so a monotone curve stays monotone */
+static void monotone_tangents(const double *x, const double *y, int n, double *m)
+{
+    double *delta = g_new(double, n - 1);
+
+    for (int k = 0; k < n - 1; k++) {
+        delta[k] = (y[k + 1] - y[k]) / (x[k + 1] - x[k]);
+    }
+
+    m[0] = delta[0];
+    m[n - 1] = delta[n - 2];
+    for (int k = 1; k < n - 1; k++) {
+        m[k] = (delta[k - 1] * delta[k] <= 0.0) ? 0.0 : (delta[k - 1] + delta[k]) / 2.0;
+    }
+
+    for (int k = 0; k < n - 1; k++) {
+        if (delta[k] == 0.0) {
+            m[k] = 0.0;
+            m[k + 1] = 0.0;
+            continue;
+        }
+
+        double alpha = m[k] / delta[k];
+        double beta = m[k + 1] / delta[k];
+        double magnitude = alpha * alpha + beta * beta;
+        if (magnitude > 9.0) {
+            double tau = 3.0 / sqrt(magnitude);
+            m[k] = tau * alpha * delta[k];
+            m[k + 1] = tau * beta * delta[k];
+        }
+    }
+
+    g_free(delta);
+}
+
+/* Compile a curve from user points */
+LightSensorCurve* light_sensor_curve_new(const LightSensorCurvePoint *points, int count,
+                                         LightSensorCurveInterpolation interpolation)
 {
-    if (x <= x1) return y1;
-    if (x >= x2) return y2;
+    if (!points || count < 2) {
+        return NULL;
+    }
+
+    LightSensorCurvePoint *sorted = g_new(LightSensorCurvePoint, count);
+    memcpy(sorted, points, sizeof(LightSensorCurvePoint) * count);
+    qsort(sorted, count, sizeof(LightSensorCurvePoint), compare_curve_points);
+
+    /* Knots in log-lux; of several points at the same lux the last one wins */
+    double *x = g_new(double, count);
+    double *y = g_new(double, count);
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        double log_lux = curve_log_lux(MAX(sorted[i].lux, 0.0));
+        if (n > 0 && log_lux - x[n - 1] < 1e-9) {
+            n--;
+        }
+        x[n] = log_lux;
+        y[n] = CLAMP(sorted[i].brightness, 0, 100);
+        n++;
+    }
+
+    LightSensorCurve *curve = NULL;
+    if (n >= 2) {
+        curve = g_new0(LightSensorCurve, 1);
+        curve->lux_min = pow(10.0, x[0]) - 1.0;
+        curve->lux_max = pow(10.0, x[n - 1]) - 1.0;
+        curve->log_min = x[0];
+        curve->log_step = (x[n - 1] - x[0]) / LIGHT_SENSOR_CURVE_TABLE_SIZE;
+
+        double *m = g_new(double, n);
+        if (interpolation == LIGHT_SENSOR_CURVE_MONOTONE_CUBIC) {
+            monotone_tangents(x, y, n, m);
+        }
+
+        int k = 0;
+        for (int i = 0; i <= LIGHT_SENSOR_CURVE_TABLE_SIZE; i++) {
+            double position = (i == LIGHT_SENSOR_CURVE_TABLE_SIZE) ? x[n - 1] : x[0] + i * curve->log_step;
+            while (k < n - 2 && position > x[k + 1]) {
+                k++;
+            }
+
+            double h = x[k + 1] - x[k];
+            double t = CLAMP((position - x[k]) / h, 0.0, 1.0);
+            double value;
+            if (interpolation == LIGHT_SENSOR_CURVE_MONOTONE_CUBIC) {
+                double t2 = t * t;
+                double t3 = t2 * t;
+                value = (2 * t3 - 3 * t2 + 1) * y[k] + (t3 - 2 * t2 + t) * h * m[k] +
+                        (-2 * t3 + 3 * t2) * y[k + 1] + (t3 - t2) * h * m[k + 1];
+            } else {
+                value = y[k] + t * (y[k + 1] - y[k]);
+            }
+            curve->table[i] = CLAMP(value, 0.0, 100.0);
+        }
+        g_free(m);
+    }
+
+    g_free(x);
+    g_free(y);
+    g_free(sorted);
+    return curve;
+}
+
+/* Default brightness curve mapping lux to brightness percentage */
+LightSensorCurve* light_sensor_curve_new_default(LightSensorCurveInterpolation interpolation)
+{
+    /* Conservative default curve with 5 points */
+    static const LightSensorCurvePoint default_points[] = {
+        { 0.0, 20 },     /* Dark -> 20% (conservative, not too dark) */
+        { 50.0, 40 },    /* Dim -> 40% */
+        { 200.0, 70 },   /* Normal indoor -> 70% */
+        { 500.0, 90 },   /* Bright -> 90% */
+        { 1000.0, 100 }  /* Very bright -> 100% */
+    };
+
+    return light_sensor_curve_new(default_points, G_N_ELEMENTS(default_points), interpolation);
+}
+
+void light_sensor_curve_free(LightSensorCurve *curve)
+{
+    g_free(curve);
+}
+
+/* Brightness for a lux value: one table lookup and one lerp */
+double light_sensor_curve_lookup(const LightSensorCurve *curve, double lux)
+{
+    if (!curve || lux < 0) {
+        return -1.0;
+    }
+
+    if (lux <= curve->lux_min) {
+        return curve->table[0];
+    }
+    if (lux >= curve->lux_max) {
+        return curve->table[LIGHT_SENSOR_CURVE_TABLE_SIZE];
+    }
+
+    double position = (curve_log_lux(lux) - curve->log_min) / curve->log_step;
+    int index = CLAMP((int)position, 0, LIGHT_SENSOR_CURVE_TABLE_SIZE - 1);
+    double fraction = position - index;
+
+    return curve->table[index] + fraction * (curve->table[index + 1] - curve->table[index]);
+}
+
+/* Calculate brightness percentage from lux value using a compiled curve */
+int light_sensor_curve_evaluate(const LightSensorCurve *curve, double lux)
+{
+    double brightness = light_sensor_curve_lookup(curve, lux);
 
-    double ratio = (x - x1) / (x2 - x1);
     /* Round to nearest integer instead of truncating */
-    return (int)(y1 + ratio * (y2 - y1) + 0.5);
+    return brightness < 0 ? -1 : (int)(brightness + 0.5);
+}
+
+/* Interpolation name used in the config file */
+const char* light_sensor_curve_interpolation_to_string(LightSensorCurveInterpolation interpolation)
+{
+    return interpolation == LIGHT_SENSOR_CURVE_LINEAR ? "linear" : "monotone-cubic";
+}
+
+LightSensorCurveInterpolation light_sensor_curve_interpolation_from_string(const char *name)
+{
+    return (name && strcmp(name, "linear") == 0) ? LIGHT_SENSOR_CURVE_LINEAR : LIGHT_SENSOR_CURVE_MONOTONE_CUBIC;
+}
+
+/* Read a short sysfs attribute of the sensor device */
+static gboolean read_device_attribute(const char *path, char *buf, gsize size)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return FALSE;
+    }
+
+    gboolean ok = (fgets(buf, size, fp) != NULL);
+    fclose(fp);
+
+    if (ok) {
+        buf[strcspn(buf, "\n")] = '\0';
+    }
+    return ok;
+}
+
+/* Write a sysfs attribute of the sensor device */
+static gboolean write_device_attribute(const char *path, const char *value)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return FALSE;
+    }
+
+    gboolean ok = (fputs(value, fp) >= 0);
+    if (fclose(fp) != 0) {
+        ok = FALSE;
+    }
+    return ok;
+}
+
+/* Read a floating-point attribute, locale-independently */
+static double read_device_double(const char *device_path, const char *attribute, double fallback)
+{
+    char path[512];
+    char value[64];
+
+    snprintf(path, sizeof(path), "%s/%s", device_path, attribute);
+    if (!read_device_attribute(path, value, sizeof(value))) {
+        return fallback;
+    }
+
+    char *endptr;
+    double parsed = g_ascii_strtod(value, &endptr);
+    return endptr == value ? fallback : parsed;
+}
+
+/* Parse a scan element type such as "le:u32/32>>0" or "be:s12/16>>4" */
+static gboolean parse_scan_type(const char *type, guint *bytes, guint *bits, guint *shift,
+                                gboolean *is_signed, gboolean *big_endian)
+{
+    char endian, sign;
+    unsigned int real_bits, storage_bits, right_shift;
+
+    if (strchr(type, 'X')) {
+        return FALSE;  /* Repeated channels are not used by light sensors */
+    }
+    if (sscanf(type, "%ce:%c%u/%u>>%u", &endian, &sign, &real_bits, &storage_bits, &right_shift) != 5) {
+        return FALSE;
+    }
+    if (storage_bits != 8 && storage_bits != 16 && storage_bits != 32 && storage_bits != 64) {
+        return FALSE;
+    }
+
+    *bytes = storage_bits / 8;
+    *bits = real_bits;
+    *shift = right_shift;
+    *is_signed = (sign == 's');
+    *big_endian = (endian == 'b');
+    return TRUE;
+}
+
+/* Work out where the illuminance value sits in each scan record. Enabled
+ * channels are laid out in index order, each aligned to its own size, and the
+ * record is padded to the largest channel. */
+static gboolean compute_scan_layout(const char *device_path, LightSensorScanLayout *layout)
+{
+    char scan_dir[512];
+    snprintf(scan_dir, sizeof(scan_dir), "%s/scan_elements", device_path);
+
+    DIR *dir = opendir(scan_dir);
+    if (!dir) {
+        return FALSE;
+    }
+
+    /* Enabled channels, indexed by scan index */
+    guint channel_bytes[LIGHT_SENSOR_MAX_SCAN_SIZE] = { 0 };
+    int lux_index = -1;
+    gboolean ok = TRUE;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL && ok) {
+        gsize len = strlen(entry->d_name);
+        if (len <= 3 || strcmp(entry->d_name + len - 3, "_en") != 0) {
+            continue;
+        }
+
+        char path[768];
+        char value[64];
+        snprintf(path, sizeof(path), "%s/%s", scan_dir, entry->d_name);
+        if (!read_device_attribute(path, value, sizeof(value)) || strcmp(value, "1") != 0) {
+            continue;
+        }
+
+        char *prefix = g_strndup(entry->d_name, len - 3);
+        guint bytes, bits, shift;
+        gboolean is_signed, big_endian;
+        int index = -1;
+
+        snprintf(path, sizeof(path), "%s/%s_index", scan_dir, prefix);
+        if (read_device_attribute(path, value, sizeof(value))) {
+            index = atoi(value);
+        }
+        snprintf(path, sizeof(path), "%s/%s_type", scan_dir, prefix);
+        if (index < 0 || index >= LIGHT_SENSOR_MAX_SCAN_SIZE ||
+            !read_device_attribute(path, value, sizeof(value)) ||
+            !parse_scan_type(value, &bytes, &bits, &shift, &is_signed, &big_endian)) {
+            ok = FALSE;
+        } else {
+            channel_bytes[index] = bytes;
+            if (strcmp(prefix, "in_illuminance") == 0) {
+                lux_index = index;
+                layout->bytes = bytes;
+                layout->bits = bits;
+                layout->shift = shift;
+                layout->is_signed = is_signed;
+                layout->big_endian = big_endian;
+            }
+        }
+        g_free(prefix);
+    }
+    closedir(dir);
+
+    if (!ok || lux_index < 0) {
+        return FALSE;
+    }
+
+    gsize offset = 0;
+    guint largest = 1;
+    for (int i = 0; i < LIGHT_SENSOR_MAX_SCAN_SIZE; i++) {
+        guint bytes = channel_bytes[i];
+        if (bytes == 0) {
+            continue;
+        }
+        offset = (offset + bytes - 1) / bytes * bytes;
+        if (i == lux_index) {
+            layout->offset = offset;
+        }
+        offset += bytes;
+        largest = MAX(largest, bytes);
+    }
+    layout->scan_size = (offset + largest - 1) / largest * largest;
+
+    return layout->scan_size > 0 && layout->scan_size <= LIGHT_SENSOR_MAX_SCAN_SIZE;
+}
+
+/* Decode the illuminance value of one scan record */
+static double decode_scan_lux(const LightSensorScanLayout *layout, const guint8 *record)
+{
+    guint64 raw = 0;
+    for (guint i = 0; i < layout->bytes; i++) {
+        guint byte_index = layout->big_endian ? i : layout->bytes - 1 - i;
+        raw = (raw << 8) | record[layout->offset + byte_index];
+    }
+
+    raw >>= layout->shift;
+    if (layout->bits < 64) {
+        raw &= (G_GUINT64_CONSTANT(1) << layout->bits) - 1;
+    }
+
+    double value;
+    if (layout->is_signed && layout->bits < 64 && (raw & (G_GUINT64_CONSTANT(1) << (layout->bits - 1)))) {
+        value = (double)(gint64)(raw | ~((G_GUINT64_CONSTANT(1) << layout->bits) - 1));
+    } else {
+        value = (double)raw;
+    }
+
+    return (value + layout->value_offset) * layout->scale;
 }
 
-/* Calculate brightness percentage from lux value using calibration curve */
-int light_sensor_calculate_brightness(LightSensor *sensor, double lux)
+/* Record a reading; the consumer is told only if the value changed */
+static void deliver_sample(LightSensor *sensor, double lux)
 {
-    if (!sensor || lux < 0 || !sensor->curve_points || sensor->num_curve_points < 2) {
-        return -1;
+    if (lux < 0) {
+        return;
     }
 
-    /* If below the first point, return first point's brightness */
-    if (lux <= sensor->curve_points[0].lux) {
-        return sensor->curve_points[0].brightness;
+    sensor->last_sample_time = g_get_monotonic_time();
+    if (lux == sensor->last_lux) {
+        return;
+    }
+
+    sensor->last_lux = lux;
+    if (sensor->sample_func) {
+        sensor->sample_func(sensor, lux, sensor->sample_data);
     }
+}
+
+static void stop_buffered_capture(LightSensor *sensor);
+static gboolean on_poll_timer(gpointer data);
 
-    /* If beyond the last point, return last point's brightness */
-    if (lux >= sensor->curve_points[sensor->num_curve_points - 1].lux) {
-        return sensor->curve_points[sensor->num_curve_points - 1].brightness;
+/* IIO buffer has data: only the newest complete record matters */
+static gboolean on_buffer_readable(gint fd, GIOCondition condition, gpointer data)
+{
+    LightSensor *sensor = (LightSensor*)data;
+    guint8 records[LIGHT_SENSOR_MAX_SCAN_SIZE * 16];
+    gsize scan_size = sensor->layout.scan_size;
+    double lux = -1.0;
+
+    if (condition & (G_IO_ERR | G_IO_HUP)) {
+        g_warning("Light sensor buffer closed, falling back to polling");
+        stop_buffered_capture(sensor);
+        sensor->source_id = g_timeout_add(LIGHT_SENSOR_POLL_INTERVAL_MS, on_poll_timer, sensor);
+        return G_SOURCE_REMOVE;
     }
 
-    /* Find the appropriate segment in the curve */
-    for (int i = 0; i < sensor->num_curve_points - 1; i++) {
-        if (lux <= sensor->curve_points[i + 1].lux) {
-            /* Interpolate between point i and i+1 */
-            return interpolate(lux,
-                             sensor->curve_points[i].lux,
-                             sensor->curve_points[i + 1].lux,
-                             sensor->curve_points[i].brightness,
-                             sensor->curve_points[i + 1].brightness);
+    for (;;) {
+        ssize_t n = read(fd, records, sizeof(records) / scan_size * scan_size);
+        if (n < (ssize_t)scan_size) {
+            break;
         }
+        lux = decode_scan_lux(&sensor->layout, records + ((gsize)n / scan_size - 1) * scan_size);
     }
 
-    /* Fallback: return last point's brightness */
-    return sensor->curve_points[sensor->num_curve_points - 1].brightness;
+    deliver_sample(sensor, lux);
+    return G_SOURCE_CONTINUE;
 }
 
-/* Set custom calibration curve (legacy function kept for backward compatibility) */
-void light_sensor_set_curve_points(LightSensor *sensor,
-                                   double dark_lux, int dark_brightness,
-                                   double dim_lux, int dim_brightness,
-                                   double normal_lux, int normal_brightness,
-                                   double bright_lux, int bright_brightness,
-                                   double very_bright_lux, int very_bright_brightness)
+/* Poll fallback */
+static gboolean on_poll_timer(gpointer data)
 {
-    if (!sensor) return;
+    LightSensor *sensor = (LightSensor*)data;
 
-    /* Free old curve if exists */
-    g_free(sensor->curve_points);
+    deliver_sample(sensor, light_sensor_read_lux(sensor));
+    return G_SOURCE_CONTINUE;
+}
 
-    /* Allocate new curve with 5 points */
-    sensor->num_curve_points = 5;
+/* Pick a trigger for drivers that need one (e.g. hid-sensor-als provides "als-dev0").
+ * Returns TRUE if a trigger was set. */
+static gboolean select_buffer_trigger(LightSensor *sensor)
+{
+    char path[512];
+    char value[128];
+    gboolean selected = FALSE;
 
-    /* Anonymous struct type for curve points */
-    typedef struct {
-        double lux;
-        int brightness;
-    } CurvePoint;
+    snprintf(path, sizeof(path), "%s/trigger/current_trigger", sensor->device_path);
+    if (!read_device_attribute(path, value, sizeof(value)) || value[0] != '\0') {
+        return FALSE;  /* No trigger support, or one is already set */
+    }
 
-    sensor->curve_points = g_new(CurvePoint, sensor->num_curve_points);
+    /* Device-specific triggers are named after the device number */
+    const char *device_number = strrchr(sensor->device_path, 'e');
+    device_number = device_number ? device_number + 1 : "";
+    char *suffix = g_strdup_printf("-dev%s", device_number);
 
-    sensor->curve_points[0].lux = dark_lux;
-    sensor->curve_points[0].brightness = dark_brightness;
+    DIR *dir = opendir("/sys/bus/iio/devices");
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "trigger", 7) != 0) {
+            continue;
+        }
 
-    sensor->curve_points[1].lux = dim_lux;
-    sensor->curve_points[1].brightness = dim_brightness;
+        char name_path[512];
+        snprintf(name_path, sizeof(name_path), "/sys/bus/iio/devices/%s/name", entry->d_name);
+        if (read_device_attribute(name_path, value, sizeof(value)) && g_str_has_suffix(value, suffix)) {
+            if (write_device_attribute(path, value)) {
+                g_debug("Using IIO trigger %s for light sensor", value);
+                selected = TRUE;
+            }
+            break;
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    g_free(suffix);
+    return selected;
+}
 
-    sensor->curve_points[2].lux = normal_lux;
-    sensor->curve_points[2].brightness = normal_brightness;
+/* Undo the sysfs configuration made for buffered capture, so a failed or
+ * stopped capture leaves the device as we found it. The buffer must already
+ * be disabled. */
+static void restore_buffer_configuration(LightSensor *sensor)
+{
+    char path[512];
+
+    if (sensor->restore_length[0] != '\0') {
+        snprintf(path, sizeof(path), "%s/buffer/length", sensor->device_path);
+        write_device_attribute(path, sensor->restore_length);
+        sensor->restore_length[0] = '\0';
+    }
+    if (sensor->restore_trigger) {
+        snprintf(path, sizeof(path), "%s/trigger/current_trigger", sensor->device_path);
+        write_device_attribute(path, "\n");  /* Detach */
+        sensor->restore_trigger = FALSE;
+    }
+    if (sensor->restore_channel) {
+        snprintf(path, sizeof(path), "%s/scan_elements/in_illuminance_en", sensor->device_path);
+        write_device_attribute(path, "0");
+        sensor->restore_channel = FALSE;
+    }
+}
 
-    sensor->curve_points[3].lux = bright_lux;
-    sensor->curve_points[3].brightness = bright_brightness;
+/* Enable buffered capture of the illuminance channel; needs write access to the
+ * device's sysfs attributes (usually root or a udev rule) */
+static gboolean start_buffered_capture(LightSensor *sensor)
+{
+    char path[512];
+    const char *device_name = strrchr(sensor->device_path, '/');
+    device_name = device_name ? device_name + 1 : sensor->device_path;
+
+    char *dev_node = g_strdup_printf("/dev/%s", device_name);
+    if (access(dev_node, R_OK) != 0) {
+        g_free(dev_node);
+        return FALSE;
+    }
+
+    char value[32];
+    snprintf(path, sizeof(path), "%s/scan_elements/in_illuminance_en", sensor->device_path);
+    if (!read_device_attribute(path, value, sizeof(value)) || strcmp(value, "1") != 0) {
+        if (!write_device_attribute(path, "1")) {
+            g_free(dev_node);
+            return FALSE;
+        }
+        sensor->restore_channel = TRUE;
+    }
+
+    sensor->restore_trigger = select_buffer_trigger(sensor);
+
+    LightSensorScanLayout layout = { 0 };
+    if (!compute_scan_layout(sensor->device_path, &layout)) {
+        g_debug("Unsupported IIO scan layout for light sensor");
+        restore_buffer_configuration(sensor);
+        g_free(dev_node);
+        return FALSE;
+    }
+    layout.scale = read_device_double(sensor->device_path, "in_illuminance_scale", 1.0);
+    layout.value_offset = read_device_double(sensor->device_path, "in_illuminance_offset", 0.0);
+    if (layout.scale == 0.0) {
+        layout.scale = 1.0;
+    }
+
+    snprintf(path, sizeof(path), "%s/buffer/length", sensor->device_path);
+    if (read_device_attribute(path, value, sizeof(value)) && strcmp(value, LIGHT_SENSOR_BUFFER_LENGTH) != 0 &&
+        write_device_attribute(path, LIGHT_SENSOR_BUFFER_LENGTH)) {
+        g_strlcpy(sensor->restore_length, value, sizeof(sensor->restore_length));
+    }
+
+    snprintf(path, sizeof(path), "%s/buffer/enable", sensor->device_path);
+    if (!write_device_attribute(path, "1")) {
+        restore_buffer_configuration(sensor);
+        g_free(dev_node);
+        return FALSE;
+    }
 
-    sensor->curve_points[4].lux = very_bright_lux;
-    sensor->curve_points[4].brightness = very_bright_brightness;
+    int fd = open(dev_node, O_RDONLY | O_NONBLOCK);
+    g_free(dev_node);
+    if (fd < 0) {
+        write_device_attribute(path, "0");
+        restore_buffer_configuration(sensor);
+        return FALSE;
+    }
+
+    sensor->layout = layout;
+    sensor->buffer_fd = fd;
+    sensor->source_id = g_unix_fd_add(fd, G_IO_IN | G_IO_ERR | G_IO_HUP, on_buffer_readable, sensor);
+    return TRUE;
+}
+
+/* Stop buffered capture and release the device node */
+static void stop_buffered_capture(LightSensor *sensor)
+{
+    if (sensor->buffer_fd < 0) {
+        return;
+    }
+
+    close(sensor->buffer_fd);
+    sensor->buffer_fd = -1;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/buffer/enable", sensor->device_path);
+    write_device_attribute(path, "0");
+    restore_buffer_configuration(sensor);
+}
+
+/* Start delivering samples */
+gboolean light_sensor_start(LightSensor *sensor, LightSensorSampleFunc func, gpointer user_data)
+{
+    if (!sensor || !sensor->available) {
+        return FALSE;
+    }
+
+    if (sensor->source_id > 0) {
+        g_source_remove(sensor->source_id);
+        sensor->source_id = 0;
+    }
+    stop_buffered_capture(sensor);
+
+    sensor->sample_func = func;
+    sensor->sample_data = user_data;
+
+    /* Take an initial reading so consumers have a value right away */
+    deliver_sample(sensor, light_sensor_read_lux(sensor));
+
+    if (start_buffered_capture(sensor)) {
+        g_message("Light sensor: event-driven buffered capture on %s", sensor->device_path);
+        return TRUE;
+    }
+
+    sensor->source_id = g_timeout_add(LIGHT_SENSOR_POLL_INTERVAL_MS, on_poll_timer, sensor);
+    g_message("Light sensor: buffered capture unavailable, polling every %d ms", LIGHT_SENSOR_POLL_INTERVAL_MS);
+    return FALSE;
 }
 
-/* Set calibration curve from array of points (flexible number of points) */
-void light_sensor_set_curve(LightSensor *sensor, const void *points_array, int count)
+/* Stop delivering samples */
+void light_sensor_stop(LightSensor *sensor)
 {
-    if (!sensor || !points_array || count < 2) {
+    if (!sensor) {
         return;
     }
 
-    /* Free old curve if exists */
-    g_free(sensor->curve_points);
+    if (sensor->source_id > 0) {
+        g_source_remove(sensor->source_id);
+        sensor->source_id = 0;
+    }
+    stop_buffered_capture(sensor);
+    sensor->sample_func = NULL;
+    sensor->sample_data = NULL;
+}
 
-    /* Allocate new curve */
-    sensor->num_curve_points = count;
+/* Latest sample */
+double light_sensor_get_last_lux(LightSensor *sensor)
+{
+    return sensor ? sensor->last_lux : -1.0;
+}
 
-    /* Anonymous struct type for curve points */
-    typedef struct {
-        double lux;
-        int brightness;
-    } CurvePoint;
+/* Take a reading outside the sampler, e.g. while it is stopped */
+double light_sensor_sample_now(LightSensor *sensor)
+{
+    if (!sensor || !sensor->available) {
+        return -1.0;
+    }
 
-    sensor->curve_points = g_new(CurvePoint, count);
+    deliver_sample(sensor, light_sensor_read_lux(sensor));
+    return sensor->last_lux;
+}
 
-    /* Copy points from input array
-     * The input array should have the same structure (double lux, int brightness) */
-    const CurvePoint *input_points = (const CurvePoint *)points_array;
+/* Latest sample with its timestamp */
+gboolean light_sensor_get_sample(LightSensor *sensor, double *lux, gint64 *timestamp)
+{
+    if (!sensor || sensor->last_lux < 0) {
+        return FALSE;
+    }
+
+    if (lux) *lux = sensor->last_lux;
+    if (timestamp) *timestamp = sensor->last_sample_time;
+    return TRUE;
+}
+
+/* Per-monitor lux filter */
+struct _LightSensorFilter {
+    LightSensorFilterSettings settings;
+
+    /* Median stage */
+    double window[LIGHT_SENSOR_FILTER_MAX_MEDIAN_WINDOW];
+    int window_count;
+    int window_pos;
+
+    /* Log-lux EMA stage */
+    gboolean have_average;
+    double log_average;         /* Smoothed log10(lux + 1) */
+    double log_input;           /* Input held since input_time */
+    gint64 input_time;
+
+    /* Hysteresis and dwell stages */
+    double committed_lux;       /* -1.0 = nothing committed yet */
+    gint64 candidate_since;     /* When the smoothed value left the hysteresis band, 0 = inside */
+};
+
+/* Default filter: tuned for a sensor delivering a few samples per second */
+void light_sensor_filter_settings_init(LightSensorFilterSettings *settings)
+{
+    settings->median_window = 5;
+    settings->smoothing_seconds = 2.0;
+    settings->hysteresis_percent = 15.0;
+    settings->hysteresis_lux = 5.0;
+    settings->dwell_seconds = 3.0;
+}
+
+/* Copy settings, clamping them to usable values */
+static void filter_apply_settings(LightSensorFilter *filter, const LightSensorFilterSettings *settings)
+{
+    filter->settings = *settings;
+
+    int window = CLAMP(settings->median_window, 1, LIGHT_SENSOR_FILTER_MAX_MEDIAN_WINDOW);
+    if (window % 2 == 0) {
+        window--;  /* Odd windows have a true middle element */
+    }
+    filter->settings.median_window = window;
+    filter->settings.smoothing_seconds = MAX(settings->smoothing_seconds, 0.0);
+    filter->settings.hysteresis_percent = MAX(settings->hysteresis_percent, 0.0);
+    filter->settings.hysteresis_lux = MAX(settings->hysteresis_lux, 0.0);
+    filter->settings.dwell_seconds = MAX(settings->dwell_seconds, 0.0);
+}
+
+LightSensorFilter* light_sensor_filter_new(const LightSensorFilterSettings *settings)
+{
+    LightSensorFilter *filter = g_new0(LightSensorFilter, 1);
+    LightSensorFilterSettings defaults;
+
+    if (!settings) {
+        light_sensor_filter_settings_init(&defaults);
+        settings = &defaults;
+    }
+    filter_apply_settings(filter, settings);
+    light_sensor_filter_reset(filter);
+
+    return filter;
+}
+
+void light_sensor_filter_free(LightSensorFilter *filter)
+{
+    g_free(filter);
+}
+
+/* Change settings; history is kept except where the median window shrank */
+void light_sensor_filter_set_settings(LightSensorFilter *filter, const LightSensorFilterSettings *settings)
+{
+    if (!filter || !settings) {
+        return;
+    }
+
+    int old_window = filter->settings.median_window;
+    filter_apply_settings(filter, settings);
+    if (filter->settings.median_window != old_window) {
+        filter->window_count = 0;
+        filter->window_pos = 0;
+    }
+}
+
+void light_sensor_filter_reset(LightSensorFilter *filter)
+{
+    if (!filter) {
+        return;
+    }
+
+    filter->window_count = 0;
+    filter->window_pos = 0;
+    filter->have_average = FALSE;
+    filter->committed_lux = -1.0;
+    filter->candidate_since = 0;
+}
+
+/* Median stage: add a sample and return the median of the window */
+static double filter_median(LightSensorFilter *filter, double lux)
+{
+    int size = filter->settings.median_window;
+
+    filter->window[filter->window_pos] = lux;
+    filter->window_pos = (filter->window_pos + 1) % size;
+    if (filter->window_count < size) {
+        filter->window_count++;
+    }
+
+    /* Insertion sort of a copy; the window is tiny */
+    double sorted[LIGHT_SENSOR_FILTER_MAX_MEDIAN_WINDOW];
+    int count = filter->window_count;
     for (int i = 0; i < count; i++) {
-        sensor->curve_points[i].lux = input_points[i].lux;
-        sensor->curve_points[i].brightness = input_points[i].brightness;
+        double value = filter->window[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    return sorted[count / 2];
+}
+
+/* EMA stage: advance the average over the time the held input was held */
+static void filter_advance(LightSensorFilter *filter, gint64 now)
+{
+    if (filter->have_average && now > filter->input_time) {
+        double dt = (double)(now - filter->input_time) / G_USEC_PER_SEC;
+        double alpha = 1.0 - exp(-dt / filter->settings.smoothing_seconds);
+        filter->log_average += alpha * (filter->log_input - filter->log_average);
+        filter->input_time = now;
+    }
+}
+
+/* EMA stage: advance the average, then hold the new input.
+ * Returns the smoothed value in lux. */
+static double filter_smooth(LightSensorFilter *filter, double lux, gint64 now)
+{
+    double log_lux = log10(lux + 1.0);
+
+    if (!filter->have_average || filter->settings.smoothing_seconds <= 0.0) {
+        filter->log_average = log_lux;
+        filter->have_average = TRUE;
+    } else {
+        filter_advance(filter, now);
+    }
+
+    filter->log_input = log_lux;
+    filter->input_time = now;
+
+    return pow(10.0, filter->log_average) - 1.0;
+}
+
+/* Change needed to leave the hysteresis band around the committed value */
+static double filter_threshold(LightSensorFilter *filter)
+{
+    return MAX(filter->committed_lux * filter->settings.hysteresis_percent / 100.0,
+               filter->settings.hysteresis_lux);
+}
+
+/* Hysteresis and dwell stages */
+static gboolean filter_commit(LightSensorFilter *filter, double smoothed, gint64 now,
+                              double *committed_lux)
+{
+    if (filter->committed_lux >= 0) {
+        if (fabs(smoothed - filter->committed_lux) <= filter_threshold(filter)) {
+            filter->candidate_since = 0;
+            return FALSE;
+        }
+
+        if (filter->candidate_since == 0) {
+            filter->candidate_since = now;
+        }
+        if ((double)(now - filter->candidate_since) < filter->settings.dwell_seconds * G_USEC_PER_SEC) {
+            return FALSE;
+        }
+    }
+
+    filter->committed_lux = smoothed;
+    filter->candidate_since = 0;
+    if (committed_lux) {
+        *committed_lux = smoothed;
+    }
+    return TRUE;
+}
+
+gboolean light_sensor_filter_process(LightSensorFilter *filter, double lux, gint64 now,
+                                     double *committed_lux)
+{
+    if (!filter || lux < 0) {
+        return FALSE;
+    }
+
+    double median = filter_median(filter, lux);
+    double smoothed = filter_smooth(filter, median, now);
+
+    return filter_commit(filter, smoothed, now, committed_lux);
+}
+
+/* Let the held input progress through smoothing and dwell without a new sample */
+gboolean light_sensor_filter_tick(LightSensorFilter *filter, gint64 now, double *committed_lux)
+{
+    if (!filter || !filter->have_average) {
+        return FALSE;
+    }
+
+    if (filter->settings.smoothing_seconds > 0.0) {
+        filter_advance(filter, now);
     }
+
+    return filter_commit(filter, pow(10.0, filter->log_average) - 1.0, now, committed_lux);
 }
 
+/* When the held input will next change the filter's decision */
+gint64 light_sensor_filter_get_deadline(LightSensorFilter *filter)
+{
+    /* Margin past the computed crossing, so rounding never lands a wakeup
+     * just short of it and re-arms for the same instant */
+    const gint64 margin = 10 * 1000;
+
+    if (!filter || !filter->have_average || filter->committed_lux < 0) {
+        return 0;
+    }
+
+    if (filter->candidate_since != 0) {
+        return filter->candidate_since + (gint64)(filter->settings.dwell_seconds * G_USEC_PER_SEC) + margin;
+    }
+
+    double input = pow(10.0, filter->log_input) - 1.0;
+    double threshold = filter_threshold(filter);
+    if (fabs(input - filter->committed_lux) <= threshold) {
+        return 0;  /* The average converges inside the band: nothing will happen */
+    }
+
+    double average = pow(10.0, filter->log_average) - 1.0;
+    if (filter->settings.smoothing_seconds <= 0.0 || fabs(average - filter->committed_lux) > threshold) {
+        return filter->input_time + margin;
+    }
+
+    /* Solve log_input + (log_average - log_input) * exp(-t / tau) = band edge */
+    double edge = input > filter->committed_lux ? filter->committed_lux + threshold
+                                                : filter->committed_lux - threshold;
+    double log_edge = log10(MAX(edge, 0.0) + 1.0);
+    double ratio = (filter->log_average - filter->log_input) / (log_edge - filter->log_input);
+    if (ratio <= 1.0) {
+        return filter->input_time + margin;
+    }
+
+    double seconds = filter->settings.smoothing_seconds * log(ratio);
+    return filter->input_time + (gint64)(seconds * G_USEC_PER_SEC) + margin;
+}
+
+double light_sensor_filter_get_committed_lux(LightSensorFilter *filter)
+{
+    return filter ? filter->committed_lux : -1.0;
+}
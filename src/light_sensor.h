@@ -28,24 +28,114 @@ void light_sensor_free(LightSensor *sensor);
 gboolean light_sensor_is_available(LightSensor *sensor);
 const char* light_sensor_get_device_path(LightSensor *sensor);
 
-/* Read sensor values */
+/* Read sensor values directly from the device. Consumers that only need the
+ * current light level should use light_sensor_get_last_lux() instead. */
 double light_sensor_read_lux(LightSensor *sensor);
 gboolean light_sensor_read_raw(LightSensor *sensor, int *raw_value, double *scale);
 
-/* Calculate brightness from ambient light */
-int light_sensor_calculate_brightness(LightSensor *sensor, double lux);
+/* Sampling: samples are pushed into the main loop as the light level changes.
+ * With write access to the IIO device the illuminance channel is captured
+ * through the /dev/iio:deviceN buffer (event-driven); otherwise sysfs is
+ * polled every 500 ms. func is called only when the value changes.
+ * Returns TRUE if buffered capture is active. */
+typedef void (*LightSensorSampleFunc)(LightSensor *sensor, double lux, gpointer user_data);
+gboolean light_sensor_start(LightSensor *sensor, LightSensorSampleFunc func, gpointer user_data);
+void light_sensor_stop(LightSensor *sensor);
 
-/* Calibration settings (legacy function for backward compatibility) */
-void light_sensor_set_curve_points(LightSensor *sensor,
-                                   double dark_lux, int dark_brightness,
-                                   double dim_lux, int dim_brightness,
-                                   double normal_lux, int normal_brightness,
-                                   double bright_lux, int bright_brightness,
-                                   double very_bright_lux, int very_bright_brightness);
+/* Latest sample taken by the sampler (-1.0 = none yet). This is the one
+ * shared reading for the control loop, tray, menu and curve dialog; it costs
+ * no sensor I/O. */
+double light_sensor_get_last_lux(LightSensor *sensor);
 
-/* Set calibration curve from array of points (flexible number of points)
- * points_array should be an array of structures with {double lux; int brightness;} */
-void light_sensor_set_curve(LightSensor *sensor, const void *points_array, int count);
+/* Latest sample and the monotonic time (g_get_monotonic_time()) it was last
+ * confirmed by a reading. Returns FALSE if no sample has been taken yet. */
+gboolean light_sensor_get_sample(LightSensor *sensor, double *lux, gint64 *timestamp);
+
+/* Read the sensor now and record the reading as the latest sample (delivered
+ * like any other sample if the sampler is running). Returns the latest lux. */
+double light_sensor_sample_now(LightSensor *sensor);
+
+/* Lux filter chain, one instance per monitor. Each sample passes through:
+ *   1. a running median over the last median_window samples (drops spikes),
+ *   2. an exponential moving average in log-lux with time constant
+ *      smoothing_seconds (the signal is held between samples),
+ *   3. relative hysteresis: the smoothed value must differ from the committed
+ *      one by more than hysteresis_percent (and at least hysteresis_lux, which
+ *      keeps dim rooms from reacting to single-lux noise),
+ *   4. a dwell time: the change must persist for dwell_seconds.
+ * Only then is a new lux value committed. The first sample after creation or
+ * a reset is committed immediately. */
+#define LIGHT_SENSOR_FILTER_MAX_MEDIAN_WINDOW 15
+
+typedef struct {
+    int median_window;          /* Samples, 1 = off (odd, <= LIGHT_SENSOR_FILTER_MAX_MEDIAN_WINDOW) */
+    double smoothing_seconds;   /* EMA time constant, 0 = off */
+    double hysteresis_percent;  /* Relative change needed to commit */
+    double hysteresis_lux;      /* Absolute floor of the change needed to commit */
+    double dwell_seconds;       /* How long a change must persist, 0 = off */
+} LightSensorFilterSettings;
+
+typedef struct _LightSensorFilter LightSensorFilter;
+
+void light_sensor_filter_settings_init(LightSensorFilterSettings *settings);
+
+LightSensorFilter* light_sensor_filter_new(const LightSensorFilterSettings *settings);
+void light_sensor_filter_free(LightSensorFilter *filter);
+void light_sensor_filter_set_settings(LightSensorFilter *filter, const LightSensorFilterSettings *settings);
+
+/* Forget all history; the next sample is committed immediately */
+void light_sensor_filter_reset(LightSensorFilter *filter);
+
+/* Feed a new sample taken at monotonic time now (us).
+ * Returns TRUE and sets *committed_lux when a new value is committed. */
+gboolean light_sensor_filter_process(LightSensorFilter *filter, double lux, gint64 now,
+                                     double *committed_lux);
+
+/* Advance the held input through smoothing and dwell up to now, without
+ * adding a sample to the median window. Same return as _process(). */
+gboolean light_sensor_filter_tick(LightSensorFilter *filter, gint64 now, double *committed_lux);
+
+/* Monotonic time at which _tick() could next commit a value if no new
+ * sample arrives, or 0 if the held input can never cause a commit */
+gint64 light_sensor_filter_get_deadline(LightSensorFilter *filter);
+
+/* Last committed value (-1.0 = none yet) */
+double light_sensor_filter_get_committed_lux(LightSensorFilter *filter);
+
+/* Calibration curve point */
+typedef struct {
+    double lux;
+    int brightness;  /* 0-100 */
+} LightSensorCurvePoint;
+
+/* How brightness is interpolated between curve points, in log-lux */
+typedef enum {
+    LIGHT_SENSOR_CURVE_MONOTONE_CUBIC = 0,  /* Smooth, never overshoots the points (Fritsch-Carlson) */
+    LIGHT_SENSOR_CURVE_LINEAR = 1
+} LightSensorCurveInterpolation;
+
+const char* light_sensor_curve_interpolation_to_string(LightSensorCurveInterpolation interpolation);
+LightSensorCurveInterpolation light_sensor_curve_interpolation_from_string(const char *name);
+
+/* Entries in a compiled curve's lookup table */
+#define LIGHT_SENSOR_CURVE_TABLE_SIZE 256
+
+/* Compiled lux -> brightness curve. Built once from a monitor's points into a
+ * lookup table indexed by log-lux and immutable afterwards, so evaluating it
+ * is O(1) and needs no config access. */
+typedef struct _LightSensorCurve LightSensorCurve;
+
+/* Returns NULL unless at least two distinct lux values are given; points need not be sorted */
+LightSensorCurve* light_sensor_curve_new(const LightSensorCurvePoint *points, int count,
+                                         LightSensorCurveInterpolation interpolation);
+LightSensorCurve* light_sensor_curve_new_default(LightSensorCurveInterpolation interpolation);
+void light_sensor_curve_free(LightSensorCurve *curve);
+
+/* Brightness (0-100) for a lux value, or -1 if curve is NULL or lux is negative */
+int light_sensor_curve_evaluate(const LightSensorCurve *curve, double lux);
+
+/* Same, unrounded (for drawing) */
+double light_sensor_curve_lookup(const LightSensorCurve *curve, double lux);
 
 G_END_DECLS
 
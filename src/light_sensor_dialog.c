@@ -22,10 +22,15 @@ typedef struct {
     GtkWidget *lux_spin;
     GtkWidget *brightness_spin;
     GtkWidget *hysteresis_spin;
+    GtkWidget *hysteresis_percent_spin;
+    GtkWidget *dwell_spin;
     GtkWidget *graph_drawing_area;
 
     AppConfig *config;
-    const char *device_path;
+    LightSensor *sensor;
+    guint lux_refresh_timer;    /* Redraws the current-lux marker */
+    double drawn_lux;           /* Lux value the marker was last drawn at */
+    const char *monitor_key;
     const char *monitor_name;
 
     GtkListStore *list_store;
@@ -57,12 +62,29 @@ static void redraw_graph(LightSensorDialogData *data);
 static void load_curve_from_config(LightSensorDialogData *data);
 static void set_default_curve(LightSensorDialogData *data);
 
+/* How often the current-lux marker follows the sensor */
+#define LUX_MARKER_REFRESH_MS 1000
+
+/* Redraw the graph when the shared sensor sample has moved */
+static gboolean on_lux_refresh_timer(gpointer user_data)
+{
+    LightSensorDialogData *data = (LightSensorDialogData*)user_data;
+
+    if (light_sensor_get_last_lux(data->sensor) != data->drawn_lux) {
+        redraw_graph(data);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
 /* Show light sensor curve configuration dialog */
-void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, const char *device_path, const char *monitor_name)
+void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, LightSensor *sensor,
+                              const char *monitor_key, const char *monitor_name)
 {
     LightSensorDialogData *data = g_new0(LightSensorDialogData, 1);
     data->config = config;
-    data->device_path = g_strdup(device_path);
+    data->sensor = light_sensor_is_available(sensor) ? sensor : NULL;
+    data->drawn_lux = -1.0;
+    data->monitor_key = g_strdup(monitor_key);
     data->monitor_name = g_strdup(monitor_name);
 
     /* Load existing curve or use defaults */
@@ -212,8 +234,8 @@ void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, const char *
 
     /* Explanation label */
     GtkWidget *hysteresis_label = gtk_label_new(
-        "Adjust how much ambient light must change before brightness adjusts.\n"
-        "Higher values = less sensitive to small light changes (reduces flickering).");
+        "Adjust how much ambient light must change, and for how long, before brightness adjusts.\n"
+        "Higher values = less sensitive to small or brief light changes (reduces flickering).");
     gtk_label_set_line_wrap(GTK_LABEL(hysteresis_label), TRUE);
     gtk_label_set_xalign(GTK_LABEL(hysteresis_label), 0);
     gtk_box_pack_start(GTK_BOX(hysteresis_vbox), hysteresis_label, FALSE, FALSE, 5);
@@ -222,17 +244,38 @@ void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, const char *
     GtkWidget *hysteresis_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
     gtk_box_pack_start(GTK_BOX(hysteresis_vbox), hysteresis_hbox, FALSE, FALSE, 0);
 
+    /* Load current filter settings from config */
+    LightSensorFilterSettings filter_settings;
+    config_get_light_sensor_filter(config, monitor_key, &filter_settings);
+
     gtk_box_pack_start(GTK_BOX(hysteresis_hbox), gtk_label_new("Change threshold:"), FALSE, FALSE, 0);
 
+    data->hysteresis_percent_spin = gtk_spin_button_new_with_range(0, 100, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(data->hysteresis_percent_spin), filter_settings.hysteresis_percent);
+    gtk_box_pack_start(GTK_BOX(hysteresis_hbox), data->hysteresis_percent_spin, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(hysteresis_hbox), gtk_label_new("%, at least"), FALSE, FALSE, 0);
+
     data->hysteresis_spin = gtk_spin_button_new_with_range(0, 100, 0.5);
     gtk_spin_button_set_digits(GTK_SPIN_BUTTON(data->hysteresis_spin), 1);
-    /* Load current hysteresis value from config */
-    double current_hysteresis = config_get_light_sensor_hysteresis(config, device_path);
-    gtk_spin_button_set_value(GTK_SPIN_BUTTON(data->hysteresis_spin), current_hysteresis);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(data->hysteresis_spin), filter_settings.hysteresis_lux);
     gtk_box_pack_start(GTK_BOX(hysteresis_hbox), data->hysteresis_spin, FALSE, FALSE, 0);
 
     gtk_box_pack_start(GTK_BOX(hysteresis_hbox), gtk_label_new("lux"), FALSE, FALSE, 0);
 
+    /* Dwell time line */
+    GtkWidget *dwell_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    gtk_box_pack_start(GTK_BOX(hysteresis_vbox), dwell_hbox, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(dwell_hbox), gtk_label_new("Change must last:"), FALSE, FALSE, 0);
+
+    data->dwell_spin = gtk_spin_button_new_with_range(0, 60, 0.5);
+    gtk_spin_button_set_digits(GTK_SPIN_BUTTON(data->dwell_spin), 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(data->dwell_spin), filter_settings.dwell_seconds);
+    gtk_box_pack_start(GTK_BOX(dwell_hbox), data->dwell_spin, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(dwell_hbox), gtk_label_new("seconds"), FALSE, FALSE, 0);
+
     /* Dialog buttons */
     GtkWidget *save_button = gtk_button_new_with_label("Save");
     GtkWidget *cancel_button = gtk_button_new_with_label("Cancel");
@@ -249,12 +292,19 @@ void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, const char *
     /* Show dialog */
     gtk_widget_show_all(data->dialog);
 
+    if (data->sensor) {
+        data->lux_refresh_timer = g_timeout_add(LUX_MARKER_REFRESH_MS, on_lux_refresh_timer, data);
+    }
+
     /* Run dialog */
     gtk_dialog_run(GTK_DIALOG(data->dialog));
 
     /* Cleanup */
+    if (data->lux_refresh_timer > 0) {
+        g_source_remove(data->lux_refresh_timer);
+    }
     gtk_widget_destroy(data->dialog);
-    g_free((char*)data->device_path);
+    g_free((char*)data->monitor_key);
     g_free((char*)data->monitor_name);
     g_free(data->points);
     g_free(data);
@@ -266,7 +316,7 @@ static void load_curve_from_config(LightSensorDialogData *data)
     LightSensorCurvePoint *points = NULL;
     int count = 0;
 
-    if (config_load_light_sensor_curve(data->config, data->device_path, &points, &count)) {
+    if (config_load_light_sensor_curve(data->config, data->monitor_key, &points, &count)) {
         data->points = points;
         data->point_count = count;
     } else {
@@ -466,13 +516,17 @@ static void on_save_clicked(GtkButton *button, LightSensorDialogData *data)
     }
 
     /* Save curve to configuration */
-    config_save_light_sensor_curve(data->config, data->device_path, data->points, data->point_count);
+    config_save_light_sensor_curve(data->config, data->monitor_key, data->points, data->point_count);
 
-    /* Save hysteresis setting */
-    double hysteresis = gtk_spin_button_get_value(GTK_SPIN_BUTTON(data->hysteresis_spin));
-    config_set_light_sensor_hysteresis(data->config, data->device_path, hysteresis);
+    /* Save hysteresis and dwell settings; smoothing keeps its configured value */
+    LightSensorFilterSettings filter_settings;
+    config_get_light_sensor_filter(data->config, data->monitor_key, &filter_settings);
+    filter_settings.hysteresis_lux = gtk_spin_button_get_value(GTK_SPIN_BUTTON(data->hysteresis_spin));
+    filter_settings.hysteresis_percent = gtk_spin_button_get_value(GTK_SPIN_BUTTON(data->hysteresis_percent_spin));
+    filter_settings.dwell_seconds = gtk_spin_button_get_value(GTK_SPIN_BUTTON(data->dwell_spin));
+    config_set_light_sensor_filter(data->config, data->monitor_key, &filter_settings);
 
-    config_save(data->config);
+    config_schedule_save(data->config);
 
     /* Close dialog */
     gtk_dialog_response(GTK_DIALOG(data->dialog), GTK_RESPONSE_OK);
@@ -561,32 +615,6 @@ static void on_brightness_edited(GtkCellRendererText *renderer, gchar *path, gch
     refresh_curve_list(data);
 }
 
-/* Linear interpolation helper */
-static double interpolate_brightness(double lux, LightSensorCurvePoint *points, int count)
-{
-    if (count < 2) return 50.0;
-
-    /* Below first point */
-    if (lux <= points[0].lux) {
-        return points[0].brightness;
-    }
-
-    /* Above last point */
-    if (lux >= points[count - 1].lux) {
-        return points[count - 1].brightness;
-    }
-
-    /* Find segment */
-    for (int i = 0; i < count - 1; i++) {
-        if (lux <= points[i + 1].lux) {
-            double ratio = (lux - points[i].lux) / (points[i + 1].lux - points[i].lux);
-            return points[i].brightness + ratio * (points[i + 1].brightness - points[i].brightness);
-        }
-    }
-
-    return points[count - 1].brightness;
-}
-
 /* Draw the curve graph */
 static gboolean on_graph_draw(GtkWidget *widget, cairo_t *cr, LightSensorDialogData *data)
 {
@@ -690,11 +718,13 @@ static gboolean on_graph_draw(GtkWidget *widget, cairo_t *cr, LightSensorDialogD
         double max_lux = data->points[data->point_count - 1].lux;
         if (max_lux < 1000) max_lux = 1000;
 
-        /* Draw curve with many segments for smooth interpolation */
+        /* Draw the curve exactly as it will be evaluated, with many segments */
+        LightSensorCurve *curve = light_sensor_curve_new(data->points, data->point_count,
+            config_get_light_sensor_curve_interpolation(data->config, data->monitor_key));
         gboolean first = TRUE;
-        for (int i = 0; i <= 100; i++) {
-            double lux = (i / 100.0) * max_lux;
-            double brightness = interpolate_brightness(lux, data->points, data->point_count);
+        for (int i = 0; curve && i <= 200; i++) {
+            double lux = (i / 200.0) * max_lux;
+            double brightness = light_sensor_curve_lookup(curve, lux);
 
             double x = margin + (lux / max_lux) * graph_width;
             double y = height - margin - (brightness / 100.0) * graph_height;
@@ -707,6 +737,7 @@ static gboolean on_graph_draw(GtkWidget *widget, cairo_t *cr, LightSensorDialogD
             }
         }
         cairo_stroke(cr);
+        light_sensor_curve_free(curve);
 
         /* Draw points */
         cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
@@ -717,6 +748,28 @@ static gboolean on_graph_draw(GtkWidget *widget, cairo_t *cr, LightSensorDialogD
             cairo_arc(cr, x, y, 4, 0, 2 * M_PI);
             cairo_fill(cr);
         }
+
+        /* Mark the current ambient light level (shared sensor sample, no device read) */
+        double lux = light_sensor_get_last_lux(data->sensor);
+        data->drawn_lux = lux;
+        if (lux >= 0) {
+            double x = margin + (MIN(lux, max_lux) / max_lux) * graph_width;
+            double dashes[] = { 4.0, 3.0 };
+
+            cairo_set_source_rgb(cr, 0.2, 0.6, 0.2);
+            cairo_set_line_width(cr, 1.0);
+            cairo_set_dash(cr, dashes, 2, 0);
+            cairo_move_to(cr, x, margin);
+            cairo_line_to(cr, x, height - margin);
+            cairo_stroke(cr);
+            cairo_set_dash(cr, NULL, 0, 0);
+
+            char label[32];
+            snprintf(label, sizeof(label), "%.0f lx", lux);
+            cairo_set_font_size(cr, 10);
+            cairo_move_to(cr, x + 3, margin + 10);
+            cairo_show_text(cr, label);
+        }
     }
 
     return FALSE;
@@ -7,11 +7,14 @@
 
 #include <gtk/gtk.h>
 #include "config.h"
+#include "light_sensor.h"
 
 G_BEGIN_DECLS
 
-/* Show light sensor curve configuration dialog for a specific monitor */
-void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, const char *device_path, const char *monitor_name);
+/* Show light sensor curve configuration dialog for a specific monitor.
+ * The sensor's latest sample is marked on the graph; sensor may be NULL. */
+void show_light_sensor_dialog(GtkWidget *parent, AppConfig *config, LightSensor *sensor,
+                              const char *monitor_key, const char *monitor_name);
 
 G_END_DECLS
 
@@ -3,6 +3,9 @@
  * A GUI application for automatic monitor brightness control using DDC/CI
  * 
  * Based on ddccontrol project patterns
+ *
+ * All brightness control runs in the BrightnessEngine (brightness_engine.c);
+ * this file is the GTK frontend that shows and edits its state.
  */
 
 #include <gtk/gtk.h>
@@ -13,13 +16,6 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/stat.h>
-#include <sys/inotify.h>
-#include <errno.h>
-
-/* Check if libudev is available - this will be defined by the Makefile */
-#ifdef HAVE_LIBUDEV
-    #include <libudev.h>
-#endif
 
 #ifdef HAVE_LIBAYATANA_APPINDICATOR
 #include <libayatana-appindicator/app-indicator.h>
@@ -31,29 +27,21 @@
 #define HAVE_APPINDICATOR 0
 #endif
 
+#include "brightness_engine.h"
+#include "dbus_service.h"
 #include "brightness_control.h"
-#include "monitor_detect.h"
 #include "config.h"
 #include "scheduler.h"
 #include "light_sensor.h"
 #include "laptop_backlight.h"
 #include "light_sensor_dialog.h"
-#include "power_management.h"
+#include "schedule_dialog.h"
 
 /* Application version information */
 #define APP_VERSION "1.1.1"
 #define APP_NAME "DDC Automatic Brightness"
 #define APP_AUTHOR "Drilix LTDA"
 
-/* Timer and delay constants */
-#define AUTO_BRIGHTNESS_INTERVAL_SECONDS 5
-#define BRIGHTNESS_TRANSITION_INTERVAL_MS 200
-#define MONITOR_RETRY_INITIAL_SECONDS 30
-#define MONITOR_REFRESH_RATE_LIMIT_SECONDS 1
-#define UDEV_DEBOUNCE_ADD_SECONDS 5      /* Longer delay for device addition to allow DDC/CI to stabilize */
-#define UDEV_DEBOUNCE_REMOVE_SECONDS 2   /* Shorter delay for device removal */
-#define DDC_COOLDOWN_SECONDS 60          /* Pause all DDC after repeated failures to let DP link recover */
-
 /* Global application state */
 typedef struct {
     GtkWidget *main_window;
@@ -72,8 +60,10 @@ typedef struct {
     GtkWidget *show_brightness_tray_check;
     GtkWidget *show_light_level_tray_check;
 
-    MonitorList *monitors;
+    BrightnessEngine *engine;
     Monitor *current_monitor;
+
+    /* Owned by the engine */
     AppConfig *config;
     BrightnessScheduler *scheduler;
     LightSensor *light_sensor;
@@ -81,40 +71,12 @@ typedef struct {
 
     gboolean updating_from_auto;
     gboolean in_monitor_refresh;
-    guint auto_brightness_timer;
-    guint brightness_transition_timer;
     gboolean start_minimized;
-
-    /* Laptop backlight inotify monitoring */
-    int laptop_backlight_inotify_fd;
-    int laptop_backlight_watch_fd;
-    GIOChannel *laptop_backlight_io_channel;
-    guint laptop_backlight_watch_id;
-    int last_laptop_brightness;
-
-    /* Monitor detection retry state */
-    guint monitor_retry_timer;
-    guint recheck_timer_id;
-    int monitor_retry_attempt;
-    gboolean monitors_found;
-
-    /* DDC error cooldown: timestamp until which all DDC commands are paused */
-    time_t ddc_cooldown_until;
-    
-    /* Udev monitoring for hardware changes */
-#if HAVE_LIBUDEV
-    struct udev *udev;
-    struct udev_monitor *udev_monitor;
-    GIOChannel *udev_io_channel;
-    guint udev_watch_id;
-#endif
-    
-    /* Power management for suspend/resume handling */
-    PowerManager *power_manager;
     
 #if HAVE_APPINDICATOR
     AppIndicator *indicator;
     GtkWidget *indicator_menu;
+    gboolean tray_watches_lux;  /* Tray label shows the light level */
 #endif
 } AppData;
 
@@ -130,31 +92,14 @@ static void on_schedule_clicked(GtkButton *button, gpointer data);
 static void on_curve_clicked(GtkButton *button, gpointer data);
 static void on_refresh_monitors_clicked(GtkButton *button, gpointer data);
 static void on_about_clicked(GtkButton *button, gpointer data);
-static void load_light_sensor_curve_for_monitor(const char *device_path, const char *reason);
 static void on_start_minimized_toggled(GtkToggleButton *button, gpointer data);
 static void on_show_brightness_tray_toggled(GtkToggleButton *button, gpointer data);
 static void on_show_light_level_tray_toggled(GtkToggleButton *button, gpointer data);
-static gboolean auto_brightness_timer_callback(gpointer data);
-static gboolean brightness_transition_timer_callback(gpointer data);
-static gboolean setup_laptop_backlight_monitoring(void);
-static void cleanup_laptop_backlight_monitoring(void);
-static gboolean on_laptop_backlight_change(GIOChannel *channel, GIOCondition condition, gpointer data);
+static void on_engine_event(BrightnessEngine *engine, BrightnessEngineEvent event,
+                            Monitor *monitor, gpointer user_data);
 static void setup_ui(void);
-static gboolean monitor_is_controllable(Monitor *monitor);
-static MonitorList* filter_controllable_monitors(MonitorList *all_monitors);
-static void load_monitors(void);
-static gboolean load_monitors_with_retry(gpointer data);
-static gboolean recheck_monitors_immediately(gpointer data);
-static gboolean auto_refresh_monitors_on_failure(void);
 static void update_brightness_display(void);
 static gboolean on_window_delete_event(GtkWidget *widget, GdkEvent *event, gpointer data);
-#if HAVE_LIBUDEV
-static gboolean setup_udev_monitoring(void);
-static void cleanup_udev_monitoring(void);
-static gboolean on_udev_event(GIOChannel *channel, GIOCondition condition, gpointer data);
-#endif
-static void on_suspend_prepare(gpointer data);
-static void on_resume_complete(gpointer data);
 
 /* Deferred mode change callback declaration (used by both windowed and tray modes) */
 static gboolean deferred_mode_change_callback(gpointer user_data);
@@ -175,27 +120,36 @@ static void on_indicator_quit(GtkMenuItem *item, gpointer data);
 static void update_indicator_menu(void);
 static void on_indicator_menu_show(GtkWidget *menu, gpointer data);
 static void update_tray_icon_label(void);
+static void update_tray_lux_watch(void);
 #endif
 
 /* Main entry point */
 int main(int argc, char *argv[])
 {
     gboolean start_minimized = FALSE;
-    gboolean no_gui = FALSE;
     
     /* Parse command line arguments */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--tray") == 0 || strcmp(argv[i], "--minimized") == 0) {
             start_minimized = TRUE;
+        } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            /* Client mode: the running instance applies the step */
+            return dbus_service_run_step_client(argv[i + 1]);
+        } else if (strncmp(argv[i], "--step=", 7) == 0) {
+            return dbus_service_run_step_client(argv[i] + 7);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            return dbus_service_run_stats_client();
         } else if (strcmp(argv[i], "--no-gui") == 0) {
-            no_gui = TRUE;
-            start_minimized = TRUE;
+            /* Same engine as ddc-automatic-brightnessd; GTK is never initialized */
+            return brightness_engine_run_headless();
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("DDC Automatic Brightness (GTK version)\n");
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
             printf("  --tray, --minimized  Start minimized to system tray\n");
-            printf("  --no-gui             Run in background (tray only)\n");
+            printf("  --no-gui             Run headless, without GTK (same as ddc-automatic-brightnessd)\n");
+            printf("  --step +N, --step -N Step the running instance's brightness by N%% and exit\n");
+            printf("  --stats              Print the running instance's DDC statistics and exit\n");
             printf("  --help, -h           Show this help\n");
             return 0;
         }
@@ -205,50 +159,12 @@ int main(int argc, char *argv[])
     gtk_init(&argc, &argv);
     
     /* Initialize application components */
-    app_data.config = config_new();
-    if (!config_load(app_data.config)) {
-        g_warning("Failed to load configuration, using defaults");
-    }
-
-    int pruned = config_prune_stale_monitors(app_data.config);
-    if (pruned > 0) {
-        g_message("Pruned %d stale monitor(s) from configuration", pruned);
-    }
-
-    app_data.scheduler = scheduler_new();
-    if (!scheduler_load_from_config(app_data.scheduler, app_data.config)) {
-        /* Load default schedule */
-        scheduler_add_time(app_data.scheduler, 9, 0, 70);   /* 9:00 AM - 70% */
-        scheduler_add_time(app_data.scheduler, 11, 0, 80);  /* 11:00 AM - 80% */
-        scheduler_add_time(app_data.scheduler, 13, 0, 90);  /* 1:00 PM - 90% */
-        scheduler_add_time(app_data.scheduler, 15, 0, 85);  /* 3:00 PM - 85% */
-        scheduler_add_time(app_data.scheduler, 17, 0, 70);  /* 5:00 PM - 70% */
-        scheduler_add_time(app_data.scheduler, 19, 0, 50);  /* 7:00 PM - 50% */
-    }
-
-    /* Initialize light sensor */
-    app_data.light_sensor = light_sensor_new();
-    if (light_sensor_is_available(app_data.light_sensor)) {
-        g_message("Ambient light sensor available for automatic brightness control");
-    }
-
-    /* Initialize laptop backlight */
-    app_data.laptop_backlight = laptop_backlight_new();
-    if (laptop_backlight_is_available(app_data.laptop_backlight)) {
-        g_message("Laptop backlight available for automatic brightness control");
-    }
-    
-    /* Initialize power manager for suspend/resume handling */
-    app_data.power_manager = power_manager_new();
-    power_manager_set_callbacks(app_data.power_manager,
-                                 on_suspend_prepare,
-                                 on_resume_complete,
-                                 NULL);
-    if (power_manager_setup_monitoring(app_data.power_manager)) {
-        g_message("Suspend/resume monitoring enabled");
-    } else {
-        g_message("Suspend/resume monitoring not available");
-    }
+    app_data.engine = brightness_engine_new();
+    app_data.config = brightness_engine_get_config(app_data.engine);
+    app_data.scheduler = brightness_engine_get_scheduler(app_data.engine);
+    app_data.light_sensor = brightness_engine_get_light_sensor(app_data.engine);
+    app_data.laptop_backlight = brightness_engine_get_laptop_backlight(app_data.engine);
+    brightness_engine_add_listener(app_data.engine, on_engine_event, NULL);
     
     /* Check configuration for start minimized */
     if (!start_minimized) {
@@ -262,33 +178,16 @@ int main(int argc, char *argv[])
     /* Setup tray indicator */
 #if HAVE_APPINDICATOR
     setup_tray_indicator();
+    update_tray_lux_watch();
 #endif
-    
-    /* Setup udev monitoring for hardware changes */
-#if HAVE_LIBUDEV
-    setup_udev_monitoring();
-#endif
-
-    /* Setup laptop backlight monitoring for real-time brightness changes */
-    setup_laptop_backlight_monitoring();
 
-    /* Load monitors */
-    load_monitors();
+    /* Load monitors and start automatic control */
+    brightness_engine_start(app_data.engine);
     
     /* Update tray icon after initial monitor detection */
 #if HAVE_APPINDICATOR
     update_tray_icon_label();
 #endif
-    
-    /* Start timer for menu updates and auto brightness (runs always) */
-    app_data.auto_brightness_timer = g_timeout_add_seconds(AUTO_BRIGHTNESS_INTERVAL_SECONDS,
-                                                          auto_brightness_timer_callback,
-                                                          &app_data);
-
-    /* Start timer for gradual brightness transitions (runs every 0.2 seconds for smooth 1% steps) */
-    app_data.brightness_transition_timer = g_timeout_add(BRIGHTNESS_TRANSITION_INTERVAL_MS,
-                                                         brightness_transition_timer_callback,
-                                                         &app_data);
 
     /* Show main window unless starting minimized */
     if (!start_minimized || !HAVE_APPINDICATOR) {
@@ -302,59 +201,187 @@ int main(int argc, char *argv[])
     gtk_main();
     
     /* Cleanup */
-    if (app_data.auto_brightness_timer > 0) {
-        g_source_remove(app_data.auto_brightness_timer);
+#if HAVE_APPINDICATOR
+    if (app_data.tray_watches_lux) {
+        brightness_engine_unwatch_lux(app_data.engine);
     }
+#endif
+    brightness_engine_remove_listener(app_data.engine, on_engine_event, NULL);
+    brightness_engine_free(app_data.engine);
 
-    if (app_data.brightness_transition_timer > 0) {
-        g_source_remove(app_data.brightness_transition_timer);
-    }
+    return 0;
+}
+
+/* Window destroy callback */
+static void on_window_destroy(GtkWidget *widget, gpointer data)
+{
+    gtk_main_quit();
+}
 
-    if (app_data.monitor_retry_timer > 0) {
-        g_source_remove(app_data.monitor_retry_timer);
+/* Show the selected monitor's automatic mode on the radio buttons */
+static void show_current_monitor_mode(void)
+{
+    if (!app_data.current_monitor) {
+        return;
     }
-    
-    /* Cleanup udev monitoring */
-#if HAVE_LIBUDEV
-    cleanup_udev_monitoring();
-#endif
 
-    /* Cleanup laptop backlight monitoring */
-    cleanup_laptop_backlight_monitoring();
+    AutoBrightnessMode mode = config_get_monitor_auto_brightness_mode(app_data.config,
+                                                                      monitor_get_config_key(app_data.current_monitor));
 
-    if (app_data.monitors) {
-        monitor_list_free(app_data.monitors);
-    }
+    /* Block radio button signals to prevent cascading callbacks */
+    g_signal_handlers_block_by_func(app_data.auto_brightness_disabled_radio,
+                                   G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_block_by_func(app_data.auto_brightness_schedule_radio,
+                                   G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_block_by_func(app_data.auto_brightness_sensor_radio,
+                                   G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_block_by_func(app_data.auto_brightness_laptop_radio,
+                                   G_CALLBACK(on_auto_brightness_mode_changed), NULL);
 
-    if (app_data.scheduler) {
-        scheduler_free(app_data.scheduler);
+    /* Update radio buttons based on mode */
+    switch (mode) {
+        case AUTO_BRIGHTNESS_MODE_DISABLED:
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_disabled_radio), TRUE);
+            break;
+        case AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE:
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_schedule_radio), TRUE);
+            break;
+        case AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR:
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_sensor_radio), TRUE);
+            break;
+        case AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY:
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_laptop_radio), TRUE);
+            break;
     }
 
-    if (app_data.light_sensor) {
-        light_sensor_free(app_data.light_sensor);
+    /* Unblock radio button signals */
+    g_signal_handlers_unblock_by_func(app_data.auto_brightness_disabled_radio,
+                                     G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_unblock_by_func(app_data.auto_brightness_schedule_radio,
+                                     G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_unblock_by_func(app_data.auto_brightness_sensor_radio,
+                                     G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+    g_signal_handlers_unblock_by_func(app_data.auto_brightness_laptop_radio,
+                                     G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+}
+
+/* Rebuild the monitor combo box, keeping the selection if it is still connected */
+static void rebuild_monitor_combo(void)
+{
+    MonitorList *monitors = brightness_engine_get_monitors(app_data.engine);
+    int count = monitor_list_get_count(monitors);
+    int active = -1;
+
+    app_data.in_monitor_refresh = TRUE;
+
+    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app_data.monitor_combo));
+    if (model) {
+        gtk_list_store_clear(GTK_LIST_STORE(model));
     }
 
-    if (app_data.laptop_backlight) {
-        laptop_backlight_free(app_data.laptop_backlight);
+    /* Populate combo box with controllable monitors only */
+    char *default_monitor = config_get_default_monitor(app_data.config);
+
+    for (int i = 0; i < count; i++) {
+        Monitor *monitor = monitor_list_get_monitor(monitors, i);
+
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app_data.monitor_combo),
+                                       monitor_get_display_name(monitor));
+
+        if (monitor == app_data.current_monitor) {
+            active = i;
+        } else if (!app_data.current_monitor && active < 0 && default_monitor &&
+                   strcmp(monitor_get_config_key(monitor), default_monitor) == 0) {
+            /* Restore the previously selected monitor */
+            active = i;
+        }
     }
 
-    /* Cleanup power manager */
-    if (app_data.power_manager) {
-        power_manager_free(app_data.power_manager);
+    g_free(default_monitor);
+    app_data.in_monitor_refresh = FALSE;
+
+    if (count == 0) {
+        app_data.current_monitor = NULL;
+        gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), 50);
+        update_brightness_display();
+        return;
     }
 
-    if (app_data.config) {
-        config_save(app_data.config);
-        config_free(app_data.config);
+    if (active >= 0 && monitor_list_get_monitor(monitors, active) == app_data.current_monitor) {
+        /* Same monitor still selected: only move the combo back to it */
+        app_data.in_monitor_refresh = TRUE;
+        gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), active);
+        app_data.in_monitor_refresh = FALSE;
+        return;
     }
 
-    return 0;
+    /* Select monitor: restore previous selection or select first */
+    gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), active >= 0 ? active : 0);
 }
 
-/* Window destroy callback */
-static void on_window_destroy(GtkWidget *widget, gpointer data)
+/* Engine state changed: bring the window and tray up to date */
+static void on_engine_event(BrightnessEngine *engine, BrightnessEngineEvent event,
+                            Monitor *monitor, gpointer user_data)
 {
-    gtk_main_quit();
+    (void)engine;
+    (void)user_data;
+
+    switch (event) {
+        case BRIGHTNESS_ENGINE_EVENT_MONITORS_CHANGED:
+            rebuild_monitor_combo();
+#if HAVE_APPINDICATOR
+            update_tray_icon_label();
+#endif
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_MONITOR_REMOVED:
+            if (monitor == app_data.current_monitor) {
+                app_data.current_monitor = NULL;
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_BRIGHTNESS_CHANGED:
+            /* Only the selected monitor is shown on the slider. While a newer write
+             * is queued (slider drag) the slider already shows where it is going. */
+            if (monitor == app_data.current_monitor && monitor_get_current_brightness(monitor) >= 0 &&
+                !monitor_has_pending_commands(monitor)) {
+                app_data.updating_from_auto = TRUE;
+                gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), monitor_get_current_brightness(monitor));
+                app_data.updating_from_auto = FALSE;
+                update_brightness_display();
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_MODE_CHANGED:
+            if (monitor == app_data.current_monitor) {
+                show_current_monitor_mode();
+#if HAVE_APPINDICATOR
+                update_indicator_menu();
+#endif
+            }
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_STATUS_CHANGED:
+#if HAVE_APPINDICATOR
+            update_tray_icon_label();
+#endif
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_HEALTH_CHANGED:
+            /* The tray shows "X" while the selected monitor's link backs off */
+#if HAVE_APPINDICATOR
+            if (monitor == app_data.current_monitor) {
+                update_tray_icon_label();
+            }
+#endif
+            break;
+
+        case BRIGHTNESS_ENGINE_EVENT_ALREADY_RUNNING:
+            /* The running instance keeps its window and tray icon */
+            g_message("DDC Automatic Brightness is already running");
+            gtk_main_quit();
+            break;
+    }
 }
 
 /* Monitor selection changed */
@@ -368,80 +395,33 @@ static void on_monitor_changed(GtkComboBox *combo, gpointer data)
         return;
     }
 
+    MonitorList *monitors = brightness_engine_get_monitors(app_data.engine);
     gint active = gtk_combo_box_get_active(combo);
-    if (active >= 0 && app_data.monitors) {
-        app_data.current_monitor = monitor_list_get_monitor(app_data.monitors, active);
+    if (active >= 0 && monitors) {
+        app_data.current_monitor = monitor_list_get_monitor(monitors, active);
 
         if (app_data.current_monitor) {
             /* Save as default monitor */
             config_set_default_monitor(app_data.config,
-                                     monitor_get_device_path(app_data.current_monitor));
-
-            /* Read current brightness */
-            int brightness = monitor_get_brightness_with_retry(app_data.current_monitor, auto_refresh_monitors_on_failure);
-
-            /* If refresh was triggered, app_data.current_monitor has been updated to the new monitor.
-             * Retry reading brightness from the refreshed monitor. */
-            if (brightness < 0 && app_data.current_monitor) {
-                g_message("Retrying brightness read after auto-refresh...");
-                brightness = monitor_get_brightness(app_data.current_monitor);
-                if (brightness >= 0) {
-                    g_message("Brightness read successful on retry: %d%%", brightness);
-                } else {
-                    g_message("Brightness read still failed after retry");
-                }
-            }
+                                     monitor_get_config_key(app_data.current_monitor));
 
-            if (brightness >= 0) {
+            /* Show the last confirmed (or cached) brightness right away; re-read it on the
+             * bus worker only if it may be stale, and the slider follows when that completes */
+            int known_brightness = monitor_get_current_brightness(app_data.current_monitor);
+            if (known_brightness >= 0) {
                 app_data.updating_from_auto = TRUE;
-                gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), brightness);
+                gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), known_brightness);
                 app_data.updating_from_auto = FALSE;
                 update_brightness_display();
             }
-            
-            /* Load auto brightness mode for this monitor */
-            AutoBrightnessMode mode = config_get_monitor_auto_brightness_mode(app_data.config,
-                                                                              monitor_get_device_path(app_data.current_monitor));
-
-            /* Block radio button signals to prevent cascading callbacks during monitor refresh */
-            g_signal_handlers_block_by_func(app_data.auto_brightness_disabled_radio,
-                                           G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_block_by_func(app_data.auto_brightness_schedule_radio,
-                                           G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_block_by_func(app_data.auto_brightness_sensor_radio,
-                                           G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_block_by_func(app_data.auto_brightness_laptop_radio,
-                                           G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-
-            /* Update radio buttons based on mode */
-            switch (mode) {
-                case AUTO_BRIGHTNESS_MODE_DISABLED:
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_disabled_radio), TRUE);
-                    break;
-                case AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE:
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_schedule_radio), TRUE);
-                    break;
-                case AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR:
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_sensor_radio), TRUE);
-                    break;
-                case AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY:
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app_data.auto_brightness_laptop_radio), TRUE);
-                    break;
-            }
+            brightness_engine_refresh_brightness(app_data.engine, app_data.current_monitor);
 
-            /* Unblock radio button signals */
-            g_signal_handlers_unblock_by_func(app_data.auto_brightness_disabled_radio,
-                                             G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_unblock_by_func(app_data.auto_brightness_schedule_radio,
-                                             G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_unblock_by_func(app_data.auto_brightness_sensor_radio,
-                                             G_CALLBACK(on_auto_brightness_mode_changed), NULL);
-            g_signal_handlers_unblock_by_func(app_data.auto_brightness_laptop_radio,
-                                             G_CALLBACK(on_auto_brightness_mode_changed), NULL);
+            /* Load auto brightness mode for this monitor */
+            show_current_monitor_mode();
 
             /* Load brightness offset for this monitor */
             int offset = config_get_monitor_brightness_offset(app_data.config,
-                                                             monitor_get_device_path(app_data.current_monitor));
+                                                             monitor_get_config_key(app_data.current_monitor));
             app_data.updating_from_auto = TRUE;
             gtk_range_set_value(GTK_RANGE(app_data.brightness_offset_scale), offset);
             app_data.updating_from_auto = FALSE;
@@ -454,11 +434,6 @@ static void on_monitor_changed(GtkComboBox *combo, gpointer data)
                 snprintf(offset_text, sizeof(offset_text), "%d%%", offset);
             }
             gtk_label_set_text(GTK_LABEL(app_data.brightness_offset_label), offset_text);
-
-            /* Load light sensor curve for this monitor (only when monitor changes) */
-            if (light_sensor_is_available(app_data.light_sensor)) {
-                load_light_sensor_curve_for_monitor(monitor_get_device_path(app_data.current_monitor), "monitor changed");
-            }
         }
     }
 }
@@ -472,7 +447,7 @@ static void on_brightness_changed(GtkRange *range, gpointer data)
 
     if (app_data.current_monitor) {
         int brightness = (int)gtk_range_get_value(range);
-        monitor_set_brightness_with_retry(app_data.current_monitor, brightness, auto_refresh_monitors_on_failure);
+        brightness_engine_set_brightness(app_data.engine, app_data.current_monitor, brightness);
         update_brightness_display();
 
         /* Disable auto brightness when user manually adjusts */
@@ -506,46 +481,8 @@ static void on_brightness_offset_changed(GtkRange *range, gpointer data)
     }
     gtk_label_set_text(GTK_LABEL(app_data.brightness_offset_label), text);
 
-    /* Save offset for this monitor */
-    config_set_monitor_brightness_offset(app_data.config,
-                                         monitor_get_device_path(app_data.current_monitor),
-                                         offset);
-    config_save(app_data.config);
-}
-
-/* Load the light sensor curve for a specific monitor from config */
-static void load_light_sensor_curve_for_monitor(const char *device_path, const char *reason)
-{
-    if (!device_path || !app_data.light_sensor) {
-        return;
-    }
-
-    /* Skip configuration reload during monitor refresh to prevent feedback loops */
-    if (app_data.in_monitor_refresh) {
-        g_debug("Skipping curve load during monitor refresh for %s (reason: %s)", device_path, reason);
-        return;
-    }
-
-    /* Load curve from config */
-    LightSensorCurvePoint *points = NULL;
-    int count = 0;
-
-    if (config_load_light_sensor_curve(app_data.config, device_path, &points, &count)) {
-        /* Successfully loaded curve from config */
-        g_message("Loaded %d curve points for monitor %s [%s]", count, device_path, reason);
-
-        /* Apply the curve to the light sensor */
-        if (count >= 2) {
-            /* Use the new flexible API that accepts any number of points */
-            light_sensor_set_curve(app_data.light_sensor, points, count);
-        }
-
-        g_free(points);
-    } else {
-        /* No curve configured, use default */
-        g_message("No curve configured for monitor %s, using defaults", device_path);
-        /* The light sensor already has default values, so nothing to do */
-    }
+    /* Save offset for this monitor; laptop-display mode follows it right away */
+    brightness_engine_set_brightness_offset(app_data.engine, app_data.current_monitor, offset);
 }
 
 /* Auto brightness mode radio button changed */
@@ -574,9 +511,7 @@ static void on_auto_brightness_mode_changed(GtkToggleButton *button, gpointer da
     }
 
     /* Save setting per monitor (fast, in-memory only) */
-    config_set_monitor_auto_brightness_mode(app_data.config,
-                                            monitor_get_device_path(app_data.current_monitor),
-                                            mode);
+    brightness_engine_set_mode(app_data.engine, app_data.current_monitor, mode);
 
     /* Schedule high-priority callback for I/O operations (runs within ~1ms) */
     g_timeout_add(1, deferred_mode_change_callback, GINT_TO_POINTER(mode));
@@ -602,31 +537,26 @@ static void on_curve_clicked(GtkButton *button, gpointer data)
         return;
     }
 
-    const char *device_path = monitor_get_device_path(app_data.current_monitor);
+    const char *monitor_key = monitor_get_config_key(app_data.current_monitor);
     const char *display_name = monitor_get_display_name(app_data.current_monitor);
 
-    /* Open curve configuration dialog */
-    show_light_sensor_dialog(app_data.main_window, app_data.config, device_path, display_name);
+    /* Open curve configuration dialog; it marks the live reading on the graph */
+    brightness_engine_watch_lux(app_data.engine);
+    show_light_sensor_dialog(app_data.main_window, app_data.config, app_data.light_sensor,
+                             monitor_key, display_name);
+    brightness_engine_unwatch_lux(app_data.engine);
 
-    /* Reload the curve after dialog closes (user may have saved changes) */
-    if (light_sensor_is_available(app_data.light_sensor)) {
-        load_light_sensor_curve_for_monitor(device_path, "curve dialog closed");
-    }
+    /* Recompile the curve and reload filter settings after dialog closes (user may have saved changes) */
+    brightness_engine_reload_light_sensor_settings(app_data.engine, app_data.current_monitor);
 }
 
 /* Refresh monitors button clicked */
 static void on_refresh_monitors_clicked(GtkButton *button, gpointer data)
 {
-    /* Cancel any pending retry timer */
-    if (app_data.monitor_retry_timer > 0) {
-        g_source_remove(app_data.monitor_retry_timer);
-        app_data.monitor_retry_timer = 0;
-    }
-    
-    /* Set retry attempt to a manual value to show error dialog if no monitors found */
-    app_data.monitor_retry_attempt = -2;  /* Special value for manual refresh */
-    load_monitors();
-    app_data.monitor_retry_attempt = 0;   /* Reset after manual refresh */
+    (void)button; (void)data;
+
+    /* Cancels any pending retry and runs full detection */
+    brightness_engine_reload_monitors(app_data.engine);
 }
 
 /* About button callback - shows application information */
@@ -717,196 +647,6 @@ static void on_about_clicked(GtkButton *button, gpointer data)
     gtk_widget_destroy(about_dialog);
 }
 
-/* Brightness transition timer callback - handles gradual brightness changes */
-static gboolean brightness_transition_timer_callback(gpointer data)
-{
-    (void)data;  /* Unused parameter */
-
-    /* Skip all DDC commands while screen is blanked, suspended, or in cooldown */
-    if (app_data.power_manager &&
-        (power_manager_is_screen_blanked(app_data.power_manager) ||
-         power_manager_is_system_suspended(app_data.power_manager))) {
-        return TRUE;
-    }
-
-    if (time(NULL) < app_data.ddc_cooldown_until) {
-        return TRUE;
-    }
-
-    /* Process each monitor's transition */
-    if (app_data.monitors) {
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-            int current = monitor_get_current_brightness(monitor);
-            int target = monitor_get_target_brightness(monitor);
-
-            /* Skip if no transition needed */
-            if (target < 0 || current == target) {
-                continue;
-            }
-
-            /* Move one step toward target */
-            int next_brightness;
-            if (current < 0) {
-                /* Unknown current brightness, jump directly to target */
-                next_brightness = target;
-            } else if (current < target) {
-                /* Increase by 1% */
-                next_brightness = current + 1;
-            } else {
-                /* Decrease by 1% */
-                next_brightness = current - 1;
-            }
-
-            /* Set the brightness */
-            monitor_set_brightness_with_retry(monitor, next_brightness, auto_refresh_monitors_on_failure);
-
-            /* Update UI if this is the current monitor */
-            if (monitor == app_data.current_monitor) {
-                app_data.updating_from_auto = TRUE;
-                gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), next_brightness);
-                app_data.updating_from_auto = FALSE;
-                /* Update the label below the slider to reflect current brightness */
-                update_brightness_display();
-            }
-
-            /* If we've reached the target, clear it */
-            if (next_brightness == target) {
-                monitor_set_target_brightness(monitor, -1);
-            }
-        }
-    }
-
-    /* Note: Tray icon and menu are already updated by update_brightness_display()
-     * when processing the current monitor above */
-
-    /* Continue timer */
-    return TRUE;
-}
-
-/* Auto brightness timer callback */
-static gboolean auto_brightness_timer_callback(gpointer data)
-{
-    static gboolean previously_blanked = FALSE;
-
-    if (!app_data.current_monitor) {
-        return TRUE;
-    }
-
-    /* Don't touch DDC while the screen is blanked or system is suspended */
-    if (app_data.power_manager &&
-        (power_manager_is_screen_blanked(app_data.power_manager) ||
-         power_manager_is_system_suspended(app_data.power_manager))) {
-        previously_blanked = TRUE;
-        return TRUE;
-    }
-
-    /* First tick after screen unblanks: reset stable_lux on all monitors so the
-     * light-sensor mode recalculates and pushes the correct brightness immediately. */
-    if (previously_blanked && app_data.monitors) {
-        g_message("Screen unblanked — resetting brightness state for all monitors");
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            monitor_set_stable_lux(monitor_list_get_monitor(app_data.monitors, i), -1.0);
-        }
-        previously_blanked = FALSE;
-    }
-
-    /* Process each monitor based on its auto brightness mode */
-    /* Note: app_data.monitors only contains controllable monitors (filtered during detection) */
-    if (app_data.monitors) {
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-            AutoBrightnessMode mode = config_get_monitor_auto_brightness_mode(app_data.config,
-                                                                              monitor_get_device_path(monitor));
-
-            int target_brightness = -1;
-
-            if (mode == AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE) {
-                /* Apply scheduled brightness to this monitor */
-                target_brightness = scheduler_get_current_brightness(app_data.scheduler);
-            } else if (mode == AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
-                /* Apply light sensor-based brightness with hysteresis */
-                if (light_sensor_is_available(app_data.light_sensor)) {
-                    /* Use the already-loaded curve for this monitor (loaded when monitor was selected) */
-                    double lux = light_sensor_read_lux(app_data.light_sensor);
-                    if (lux >= 0) {
-                        /* Get the last stable lux value used for this monitor */
-                        double stable_lux = monitor_get_stable_lux(monitor);
-
-                        /* Get configured hysteresis for this monitor (default: 5.0 lux) */
-                        double lux_hysteresis = config_get_light_sensor_hysteresis(app_data.config,
-                                                                                   monitor_get_device_path(monitor));
-                        gboolean should_update = FALSE;
-
-                        if (stable_lux < 0) {
-                            /* First time setting brightness for this monitor */
-                            should_update = TRUE;
-                        } else if (lux < stable_lux - lux_hysteresis || lux > stable_lux + lux_hysteresis) {
-                            /* Lux changed significantly, update brightness */
-                            should_update = TRUE;
-                        }
-
-                        if (should_update) {
-                            target_brightness = light_sensor_calculate_brightness(app_data.light_sensor, lux);
-                            monitor_set_stable_lux(monitor, lux);
-
-                            if (monitor == app_data.current_monitor) {
-                                g_debug("Light sensor: %.1f lux -> %d%% brightness (was %.1f lux)",
-                                        lux, target_brightness, stable_lux);
-                            }
-                        } else {
-                            /* Within hysteresis zone, keep current brightness target */
-                            if (monitor == app_data.current_monitor) {
-                                g_debug("Light sensor: %.1f lux within hysteresis zone of %.1f lux (±%.1f), no change",
-                                       lux, stable_lux, lux_hysteresis);
-                            }
-                            target_brightness = -1;  /* Don't update */
-                        }
-                    }
-                }
-            } else if (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY) {
-                /* Apply laptop display-based brightness */
-                if (laptop_backlight_is_available(app_data.laptop_backlight)) {
-                    int laptop_brightness = laptop_backlight_read_brightness(app_data.laptop_backlight);
-                    if (laptop_brightness >= 0) {
-                        target_brightness = laptop_brightness;
-
-                        /* Apply brightness offset */
-                        int offset = config_get_monitor_brightness_offset(app_data.config,
-                                                                          monitor_get_device_path(monitor));
-                        target_brightness += offset;
-
-                        /* Clamp to 0-100 range */
-                        if (target_brightness < 0) target_brightness = 0;
-                        if (target_brightness > 100) target_brightness = 100;
-
-                        if (monitor == app_data.current_monitor) {
-                            g_debug("Laptop display: %d%% + offset %d%% -> %d%% brightness",
-                                    laptop_brightness, offset, target_brightness);
-                        }
-                    }
-                }
-            }
-
-            /* Set target brightness for gradual transition */
-            if (target_brightness >= 0) {
-                monitor_set_target_brightness(monitor, target_brightness);
-
-                if (monitor == app_data.current_monitor) {
-                    g_debug("Set target brightness to %d%% (current: %d%%) for gradual transition",
-                           target_brightness, monitor_get_current_brightness(monitor));
-                }
-            }
-        }
-    }
-
-    /* Update tray icon to reflect current brightness and lux values after processing all monitors */
-    update_tray_icon_label();
-
-    /* Timer continues running for auto brightness adjustments */
-    return TRUE; /* Continue timer */
-}
-
 /* Setup the user interface */
 static void setup_ui(void)
 {
@@ -1120,521 +860,59 @@ static void setup_ui(void)
     g_signal_connect(quit_button, "clicked",
                      G_CALLBACK(on_window_destroy), NULL);
 }
-
-/* Check if a monitor is controllable (external and DDC/CI works) */
-static gboolean monitor_is_controllable(Monitor *monitor)
+/* Update brightness percentage display */
+static void update_brightness_display(void)
 {
-    if (!monitor) {
-        return FALSE;
-    }
-
-    /* Internal monitors are not controllable via DDC/CI */
-    if (monitor_is_internal(monitor)) {
-        g_debug("Monitor %s is internal, not controllable", monitor_get_display_name(monitor));
-        return FALSE;
-    }
-
-    /* Test if DDC/CI communication works by trying to read brightness */
-    int brightness = monitor_get_brightness(monitor);
-    if (brightness < 0) {
-        g_debug("Monitor %s DDC/CI read failed, not controllable", monitor_get_display_name(monitor));
-        return FALSE;
-    }
-
-    g_message("Monitor %s is controllable (brightness: %d%%)", monitor_get_display_name(monitor), brightness);
-    return TRUE;
+    int brightness = (int)gtk_range_get_value(GTK_RANGE(app_data.brightness_scale));
+    char text[16];
+    snprintf(text, sizeof(text), "%d%%", brightness);
+    gtk_label_set_text(GTK_LABEL(app_data.brightness_label), text);
+    
+#if HAVE_APPINDICATOR
+    /* Update tray icon and menu */
+    update_tray_icon_label();
+    update_indicator_menu();
+#endif
 }
 
-/* Filter monitor list to only include controllable monitors */
-static MonitorList* filter_controllable_monitors(MonitorList *all_monitors)
+/* Window delete event handler */
+static gboolean on_window_delete_event(GtkWidget *widget, GdkEvent *event, gpointer data)
 {
-    if (!all_monitors) {
-        return NULL;
-    }
-
-    MonitorList *filtered = monitor_list_new();
-    int total_count = monitor_list_get_count(all_monitors);
-    int controllable_count = 0;
-
-    g_message("Filtering %d detected monitors for controllability...", total_count);
-
-    for (int i = 0; i < total_count; i++) {
-        Monitor *monitor = monitor_list_get_monitor(all_monitors, i);
-
-        if (monitor_is_controllable(monitor)) {
-            /* Create a new monitor instance with the same data */
-            Monitor *filtered_monitor = monitor_new(
-                monitor_get_device_path(monitor),
-                monitor_get_display_name(monitor)
-            );
-            monitor_set_internal(filtered_monitor, monitor_is_internal(monitor));
-            monitor_set_available(filtered_monitor, monitor_is_available(monitor));
-            if (monitor_get_model_name(monitor))
-                monitor_set_model_name(filtered_monitor, monitor_get_model_name(monitor));
-
-            monitor_list_add(filtered, filtered_monitor);
-            controllable_count++;
-        } else {
-            g_message("Excluding non-controllable monitor: %s", monitor_get_display_name(monitor));
-        }
-    }
+    (void)widget; (void)event; (void)data;
+    
+#if HAVE_APPINDICATOR
+    /* Hide to tray instead of closing if tray is available */
+    gtk_widget_hide(app_data.main_window);
+    return TRUE; /* Don't propagate the event */
+#else
+    /* No tray available, quit the application */
+    gtk_main_quit();
+    return FALSE;
+#endif
+}
 
-    g_message("Found %d controllable monitors out of %d total", controllable_count, total_count);
-    return filtered;
+/* Start minimized checkbox toggled */
+static void on_start_minimized_toggled(GtkToggleButton *button, gpointer data)
+{
+    (void)data;
+    gboolean enabled = gtk_toggle_button_get_active(button);
+    config_set_start_minimized(app_data.config, enabled);
+    config_schedule_save(app_data.config);
 }
 
-/* For each external monitor that has no light sensor curve on its current I2C bus,
- * search for a curve stored under a different bus that was previously used by the
- * same monitor model and copy it across.  This handles the case where a hub
- * reconnect causes the kernel to assign a new /dev/i2c-N number. */
-static void migrate_monitor_curves(void)
+/* Show brightness in tray checkbox toggled */
+static void on_show_brightness_tray_toggled(GtkToggleButton *button, gpointer data)
 {
-    if (!app_data.monitors || !app_data.config) return;
+    (void)data;
+    gboolean enabled = gtk_toggle_button_get_active(button);
+    config_set_show_brightness_in_tray(app_data.config, enabled);
+    config_schedule_save(app_data.config);
 
-    GKeyFile *keyfile = config_get_keyfile(app_data.config);
-    int count = monitor_list_get_count(app_data.monitors);
-
-    for (int i = 0; i < count; i++) {
-        Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-        if (monitor_is_internal(monitor)) continue;
-
-        const char *device_path = monitor_get_device_path(monitor);
-        const char *model_name  = monitor_get_model_name(monitor);
-        if (!model_name || model_name[0] == '\0') continue;
-
-        /* Always record the model name for the current bus so future calls can find it */
-        config_set_monitor_model_name(app_data.config, device_path, model_name);
-
-        /* If this bus already has a curve, nothing to do */
-        LightSensorCurvePoint *existing = NULL;
-        int existing_count = 0;
-        if (config_load_light_sensor_curve(app_data.config, device_path, &existing, &existing_count)) {
-            g_free(existing);
-            continue;
-        }
-
-        /* Search all LightSensorCurve_* groups for a matching model name on another bus */
-        gsize n_groups = 0;
-        char **groups = g_key_file_get_groups(keyfile, &n_groups);
-        if (!groups) continue;
-
-        for (gsize g = 0; g < n_groups; g++) {
-            if (!g_str_has_prefix(groups[g], "LightSensorCurve_")) continue;
-
-            const char *old_path = groups[g] + strlen("LightSensorCurve_");
-            if (strcmp(old_path, device_path) == 0) continue;
-
-            /* Only migrate from buses whose device is no longer present */
-            if (access(old_path, F_OK) == 0) continue;
-
-            char *old_model = config_get_monitor_model_name(app_data.config, old_path);
-            if (!old_model) continue;
-
-            gboolean match = (strcmp(old_model, model_name) == 0);
-            g_free(old_model);
-            if (!match) continue;
-
-            LightSensorCurvePoint *old_points = NULL;
-            int old_count = 0;
-            if (!config_load_light_sensor_curve(app_data.config, old_path, &old_points, &old_count))
-                continue;
-
-            double hysteresis = config_get_light_sensor_hysteresis(app_data.config, old_path);
-            config_save_light_sensor_curve(app_data.config, device_path, old_points, old_count);
-            config_set_light_sensor_hysteresis(app_data.config, device_path, hysteresis);
-            g_free(old_points);
-
-            g_message("Migrated light sensor curve from %s to %s (model: %s)",
-                      old_path, device_path, model_name);
-            break;
-        }
-
-        g_strfreev(groups);
-    }
-}
-
-/* Load available monitors */
-static void load_monitors(void)
-{
-    /* Clear existing monitors */
-    if (app_data.monitors) {
-        monitor_list_free(app_data.monitors);
-        app_data.monitors = NULL;
-        app_data.current_monitor = NULL;
-    }
-
-    /* Clear combo box */
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app_data.monitor_combo));
-    if (model) {
-        gtk_list_store_clear(GTK_LIST_STORE(model));
-    }
-
-    /* Detect all monitors */
-    MonitorList *all_monitors = monitor_detect_all();
-
-    if (!all_monitors || monitor_list_get_count(all_monitors) == 0) {
-        g_message("No monitors detected");
-        app_data.monitors_found = FALSE;
-
-        /* Start retry timer if this is the initial load (retry_attempt == 0) */
-        if (app_data.monitor_retry_attempt == 0) {
-            app_data.monitor_retry_attempt = 1;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(MONITOR_RETRY_INITIAL_SECONDS, load_monitors_with_retry, NULL);
-            g_message("No monitors found on startup, will retry in %d seconds...", MONITOR_RETRY_INITIAL_SECONDS);
-        }
-
-#if HAVE_APPINDICATOR
-        /* Update tray icon to reflect no monitors state */
-        update_tray_icon_label();
-#endif
-        return;
-    }
-
-    /* Filter to only controllable monitors */
-    app_data.monitors = filter_controllable_monitors(all_monitors);
-    monitor_list_free(all_monitors);  /* Free the unfiltered list */
-
-    if (!app_data.monitors || monitor_list_get_count(app_data.monitors) == 0) {
-        g_message("No controllable monitors found");
-        app_data.monitors_found = FALSE;
-
-        /* Start retry timer if this is the initial load */
-        if (app_data.monitor_retry_attempt == 0) {
-            app_data.monitor_retry_attempt = 1;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(MONITOR_RETRY_INITIAL_SECONDS, load_monitors_with_retry, NULL);
-            g_message("No controllable monitors found on startup, will retry in %d seconds...", MONITOR_RETRY_INITIAL_SECONDS);
-        }
-
-#if HAVE_APPINDICATOR
-        /* Update tray icon to reflect no monitors state */
-        update_tray_icon_label();
-#endif
-        return;
-    }
-
-    /* Controllable monitors found! */
-    app_data.monitors_found = TRUE;
-
-    /* Migrate any light sensor curves that moved to a new I2C bus */
-    migrate_monitor_curves();
-
-    /* Cancel any pending retry timer */
-    if (app_data.monitor_retry_timer > 0) {
-        g_source_remove(app_data.monitor_retry_timer);
-        app_data.monitor_retry_timer = 0;
-        app_data.monitor_retry_attempt = 0;
-        g_message("Controllable monitors detected successfully!");
-    }
-
-    /* Populate combo box with controllable monitors only */
-    char *default_monitor = config_get_default_monitor(app_data.config);
-    int default_index = -1;
-
-    for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-        Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-        const char *display_name = monitor_get_display_name(monitor);
-        const char *device_path = monitor_get_device_path(monitor);
-
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app_data.monitor_combo), display_name);
-
-        /* Check if this is the previously selected monitor */
-        if (default_monitor && strcmp(device_path, default_monitor) == 0) {
-            default_index = i;
-        }
-    }
-
-    g_free(default_monitor);
-
-    /* Select monitor: restore previous selection or select first */
-    if (default_index >= 0) {
-        g_message("Restoring previously selected monitor at index %d", default_index);
-        gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), default_index);
-    } else {
-        g_message("No previous selection, selecting first monitor");
-        gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), 0);
-    }
-
-#if HAVE_APPINDICATOR
-    /* Update tray icon to reflect monitors found */
-    update_tray_icon_label();
-#endif
-}
-
-/* Retry monitor detection with delayed intervals */
-static gboolean load_monitors_with_retry(gpointer data)
-{
-    (void)data;
-
-    /* Clear the timer ID since it's about to complete */
-    app_data.monitor_retry_timer = 0;
-
-    /* Try to detect monitors again */
-    g_message("Retrying monitor detection (attempt %d)...", app_data.monitor_retry_attempt);
-
-    /* Temporarily increase retry attempt to avoid triggering another retry from load_monitors */
-    int saved_attempt = app_data.monitor_retry_attempt;
-    app_data.monitor_retry_attempt = -1;  /* Special value to indicate retry in progress */
-
-    /* Clear existing monitors */
-    if (app_data.monitors) {
-        monitor_list_free(app_data.monitors);
-        app_data.monitors = NULL;
-        app_data.current_monitor = NULL;
-    }
-
-    /* Clear combo box */
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app_data.monitor_combo));
-    if (model) {
-        gtk_list_store_clear(GTK_LIST_STORE(model));
-    }
-
-    /* Detect all monitors */
-    MonitorList *all_monitors = monitor_detect_all();
-
-    if (!all_monitors || monitor_list_get_count(all_monitors) == 0) {
-        /* Restore attempt counter */
-        app_data.monitor_retry_attempt = saved_attempt;
-
-        /* Schedule next retry based on attempt number */
-        if (app_data.monitor_retry_attempt == 1) {
-            /* Second attempt: retry after 90 seconds from startup (60 more seconds) */
-            app_data.monitor_retry_attempt = 2;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(60, load_monitors_with_retry, NULL);
-            g_message("No monitors found on retry 1, will retry in 60 seconds...");
-        } else if (app_data.monitor_retry_attempt == 2) {
-            /* Third attempt: retry after 180 seconds from startup (90 more seconds) */
-            app_data.monitor_retry_attempt = 3;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(90, load_monitors_with_retry, NULL);
-            g_message("No monitors found on retry 2, will retry in 90 seconds...");
-        } else {
-            /* Final attempt failed, stop retrying */
-            app_data.monitor_retry_attempt = 0;
-            app_data.monitors_found = FALSE;
-            g_message("All monitor detection attempts failed");
-
-#if HAVE_APPINDICATOR
-            /* Update tray icon to reflect no monitors state */
-            update_tray_icon_label();
-#endif
-        }
-
-        return FALSE; /* Stop the current timer */
-    }
-
-    /* Filter to only controllable monitors */
-    app_data.monitors = filter_controllable_monitors(all_monitors);
-    monitor_list_free(all_monitors);  /* Free the unfiltered list */
-
-    if (!app_data.monitors || monitor_list_get_count(app_data.monitors) == 0) {
-        g_message("No controllable monitors found on retry");
-        /* Restore attempt counter */
-        app_data.monitor_retry_attempt = saved_attempt;
-
-        /* Schedule next retry based on attempt number */
-        if (app_data.monitor_retry_attempt == 1) {
-            app_data.monitor_retry_attempt = 2;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(60, load_monitors_with_retry, NULL);
-            g_message("No controllable monitors found on retry 1, will retry in 60 seconds...");
-        } else if (app_data.monitor_retry_attempt == 2) {
-            app_data.monitor_retry_attempt = 3;
-            app_data.monitor_retry_timer = g_timeout_add_seconds(90, load_monitors_with_retry, NULL);
-            g_message("No controllable monitors found on retry 2, will retry in 90 seconds...");
-        } else {
-            app_data.monitor_retry_attempt = 0;
-            app_data.monitors_found = FALSE;
-            g_message("All controllable monitor detection attempts failed");
-
-#if HAVE_APPINDICATOR
-            update_tray_icon_label();
-#endif
-        }
-
-        return FALSE;
-    }
-
-    /* Controllable monitors found! */
-    app_data.monitors_found = TRUE;
-    app_data.monitor_retry_attempt = 0;
-    g_message("Controllable monitors detected successfully on retry!");
-
-    /* Migrate any light sensor curves that moved to a new I2C bus */
-    migrate_monitor_curves();
-
-    /* Populate combo box with controllable monitors only */
-    char *default_monitor = config_get_default_monitor(app_data.config);
-    int default_index = -1;
-
-    for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-        Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-        const char *display_name = monitor_get_display_name(monitor);
-        const char *device_path = monitor_get_device_path(monitor);
-
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app_data.monitor_combo), display_name);
-
-        /* Check if this is the previously selected monitor */
-        if (default_monitor && strcmp(device_path, default_monitor) == 0) {
-            default_index = i;
-        }
-    }
-
-    g_free(default_monitor);
-
-    /* Select monitor: restore previous selection or select first */
-    if (default_index >= 0) {
-        g_message("Restoring previously selected monitor at index %d", default_index);
-        gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), default_index);
-    } else {
-        g_message("No previous selection, selecting first monitor");
-        gtk_combo_box_set_active(GTK_COMBO_BOX(app_data.monitor_combo), 0);
-    }
-
-#if HAVE_APPINDICATOR
-    /* Update tray icon to reflect monitors found */
-    update_tray_icon_label();
-#endif
-
-    return FALSE; /* Stop the timer */
-}
-
-/* Immediately re-check monitor availability (for hardware disconnect events) */
-static gboolean recheck_monitors_immediately(gpointer data)
-{
-    (void)data;
-
-    /* Clear the timer ID since we're executing now */
-    app_data.recheck_timer_id = 0;
-
-    g_message("Re-checking monitor availability");
-
-    /* Cancel any pending retry timer */
-    if (app_data.monitor_retry_timer > 0) {
-        g_source_remove(app_data.monitor_retry_timer);
-        app_data.monitor_retry_timer = 0;
-    }
-
-    /* Set retry attempt to avoid triggering another retry from load_monitors */
-    app_data.monitor_retry_attempt = -2;  /* Special value for manual/auto refresh */
-
-    /* Re-run monitor detection - this will properly filter and select monitors */
-    load_monitors();
-
-    /* Reset retry attempt */
-    app_data.monitor_retry_attempt = 0;
-
-    return FALSE; /* Single execution */
-}
-
-/* Auto-refresh monitors when DDC communication fails.
- *
- * Instead of immediately re-probing via ddccontrol -p (which adds more traffic
- * to an already-failing DDC/AUX channel and can cascade into a link collapse),
- * we enter a cooldown period and let udev events or the cooldown timer trigger
- * re-detection once the DP link has had time to recover.
- */
-static gboolean auto_refresh_monitors_on_failure(void)
-{
-    /* Rate limiting: prevent entering cooldown more than once per second */
-    static time_t last_refresh_time = 0;
-    time_t current_time = time(NULL);
-
-    if (current_time - last_refresh_time < MONITOR_REFRESH_RATE_LIMIT_SECONDS) {
-        return FALSE;
-    }
-
-    last_refresh_time = current_time;
-
-    /* If already in cooldown, don't reset the timer */
-    if (current_time < app_data.ddc_cooldown_until) {
-        return FALSE;
-    }
-
-    /* Enter DDC cooldown: stop all DDC traffic so the DP link can recover */
-    app_data.ddc_cooldown_until = current_time + DDC_COOLDOWN_SECONDS;
-    g_message("DDC communication failed — entering %ds cooldown to protect DP link",
-              DDC_COOLDOWN_SECONDS);
-
-    /* Clear monitor state without running ddccontrol -p */
-    if (app_data.monitors) {
-        monitor_list_free(app_data.monitors);
-        app_data.monitors = NULL;
-    }
-    app_data.current_monitor = NULL;
-    app_data.monitors_found = FALSE;
-
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app_data.monitor_combo));
-    if (model) {
-        gtk_list_store_clear(GTK_LIST_STORE(model));
-    }
-
-    gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), 50);
-    update_brightness_display();
-
-#if HAVE_APPINDICATOR
-    update_tray_icon_label();
-#endif
-
-    /* Schedule re-detection after cooldown; udev events may also trigger it sooner */
-    if (app_data.recheck_timer_id > 0) {
-        g_source_remove(app_data.recheck_timer_id);
-    }
-    app_data.recheck_timer_id = g_timeout_add_seconds(DDC_COOLDOWN_SECONDS,
-                                                       recheck_monitors_immediately, NULL);
-    return FALSE;
-}
-
-/* Update brightness percentage display */
-static void update_brightness_display(void)
-{
-    int brightness = (int)gtk_range_get_value(GTK_RANGE(app_data.brightness_scale));
-    char text[16];
-    snprintf(text, sizeof(text), "%d%%", brightness);
-    gtk_label_set_text(GTK_LABEL(app_data.brightness_label), text);
-    
-#if HAVE_APPINDICATOR
-    /* Update tray icon and menu */
-    update_tray_icon_label();
-    update_indicator_menu();
-#endif
-}
-
-/* Window delete event handler */
-static gboolean on_window_delete_event(GtkWidget *widget, GdkEvent *event, gpointer data)
-{
-    (void)widget; (void)event; (void)data;
-    
-#if HAVE_APPINDICATOR
-    /* Hide to tray instead of closing if tray is available */
-    gtk_widget_hide(app_data.main_window);
-    return TRUE; /* Don't propagate the event */
-#else
-    /* No tray available, quit the application */
-    gtk_main_quit();
-    return FALSE;
-#endif
-}
-
-/* Start minimized checkbox toggled */
-static void on_start_minimized_toggled(GtkToggleButton *button, gpointer data)
-{
-    (void)data;
-    gboolean enabled = gtk_toggle_button_get_active(button);
-    config_set_start_minimized(app_data.config, enabled);
-    config_save(app_data.config);
-}
-
-/* Show brightness in tray checkbox toggled */
-static void on_show_brightness_tray_toggled(GtkToggleButton *button, gpointer data)
-{
-    (void)data;
-    gboolean enabled = gtk_toggle_button_get_active(button);
-    config_set_show_brightness_in_tray(app_data.config, enabled);
-    config_save(app_data.config);
-
-#if HAVE_APPINDICATOR
-    /* Update tray icon label immediately */
-    update_tray_icon_label();
-#endif
-}
+#if HAVE_APPINDICATOR
+    /* Update tray icon label immediately */
+    update_tray_icon_label();
+#endif
+}
 
 /* Show light level in tray checkbox toggled */
 static void on_show_light_level_tray_toggled(GtkToggleButton *button, gpointer data)
@@ -1642,10 +920,11 @@ static void on_show_light_level_tray_toggled(GtkToggleButton *button, gpointer d
     (void)data;
     gboolean enabled = gtk_toggle_button_get_active(button);
     config_set_show_light_level_in_tray(app_data.config, enabled);
-    config_save(app_data.config);
+    config_schedule_save(app_data.config);
 
 #if HAVE_APPINDICATOR
     /* Update tray icon label immediately */
+    update_tray_lux_watch();
     update_tray_icon_label();
 #endif
 }
@@ -1797,11 +1076,9 @@ static void set_brightness_from_indicator(int brightness)
 {
     if (app_data.current_monitor) {
         /* Disable auto brightness and save config immediately */
-        config_set_monitor_auto_brightness_mode(app_data.config,
-                                                monitor_get_device_path(app_data.current_monitor),
-                                                AUTO_BRIGHTNESS_MODE_DISABLED);
+        brightness_engine_set_mode(app_data.engine, app_data.current_monitor, AUTO_BRIGHTNESS_MODE_DISABLED);
 
-        monitor_set_brightness_with_retry(app_data.current_monitor, brightness, auto_refresh_monitors_on_failure);
+        brightness_engine_set_brightness(app_data.engine, app_data.current_monitor, brightness);
         app_data.updating_from_auto = TRUE;
         gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), brightness);
         app_data.updating_from_auto = FALSE;
@@ -1854,73 +1131,14 @@ static void on_indicator_brightness_100(GtkMenuItem *item, gpointer data)
 
 /* Deferred mode change callback - does the heavy I/O work after UI updates
  * This is called for MANUAL mode changes (user clicking), so brightness should change INSTANTLY.
- * Automatic adjustments (60s timer) use their own path with gradual transitions. */
+ * Automatic adjustments use their own path with gradual transitions. */
 static gboolean deferred_mode_change_callback(gpointer user_data)
 {
-    AutoBrightnessMode mode = GPOINTER_TO_INT(user_data);
-
-    if (!app_data.current_monitor) {
-        return FALSE;
-    }
+    (void)user_data;
 
-    int new_brightness = -1;
-
-    /* Calculate the appropriate brightness based on the new mode */
-    if (mode == AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE) {
-        /* Apply current scheduled brightness immediately */
-        new_brightness = scheduler_get_current_brightness(app_data.scheduler);
-        if (new_brightness >= 0) {
-            g_message("Scheduled brightness: setting immediately to %d%%", new_brightness);
-        }
-    } else if (mode == AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR) {
-        /* Apply light sensor-based brightness immediately */
-        if (light_sensor_is_available(app_data.light_sensor)) {
-            /* Load the curve for this monitor */
-            load_light_sensor_curve_for_monitor(monitor_get_device_path(app_data.current_monitor), "user mode change");
-
-            double lux = light_sensor_read_lux(app_data.light_sensor);
-            if (lux >= 0) {
-                new_brightness = light_sensor_calculate_brightness(app_data.light_sensor, lux);
-                if (new_brightness >= 0) {
-                    /* Set stable lux when mode is first enabled */
-                    monitor_set_stable_lux(app_data.current_monitor, lux);
-                    g_message("Light sensor: %.1f lux -> %d%% brightness (mode enabled, applying immediately)",
-                             lux, new_brightness);
-                }
-            }
-        }
-    } else if (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY) {
-        /* Apply laptop display-based brightness immediately */
-        if (laptop_backlight_is_available(app_data.laptop_backlight)) {
-            int laptop_brightness = laptop_backlight_read_brightness(app_data.laptop_backlight);
-            if (laptop_brightness >= 0) {
-                /* Apply brightness offset */
-                int offset = config_get_monitor_brightness_offset(app_data.config,
-                                                                  monitor_get_device_path(app_data.current_monitor));
-                new_brightness = laptop_brightness + offset;
-
-                /* Clamp to 0-100 range */
-                if (new_brightness < 0) new_brightness = 0;
-                if (new_brightness > 100) new_brightness = 100;
-
-                g_message("Laptop display: %d%% + offset %d%% -> %d%% brightness (applying immediately)",
-                         laptop_brightness, offset, new_brightness);
-            }
-        }
-    }
-
-    /* Apply brightness IMMEDIATELY (not gradual) for manual mode changes */
-    if (new_brightness >= 0) {
-        monitor_set_brightness_with_retry(app_data.current_monitor, new_brightness, auto_refresh_monitors_on_failure);
-
-        /* Clear any pending target brightness (no gradual transition needed) */
-        monitor_set_target_brightness(app_data.current_monitor, -1);
-
-        /* Update UI to reflect the new brightness (also updates tray icon and menu) */
-        app_data.updating_from_auto = TRUE;
-        gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), new_brightness);
-        app_data.updating_from_auto = FALSE;
-        update_brightness_display();  /* This calls update_tray_icon_label() and update_indicator_menu() */
+    if (app_data.current_monitor) {
+        /* The engine reports the new brightness back through on_engine_event() */
+        brightness_engine_apply_mode(app_data.engine, app_data.current_monitor);
     }
 
     return FALSE; /* Remove this timeout callback after one execution */
@@ -1932,9 +1150,7 @@ static void on_indicator_auto_schedule(GtkMenuItem *item, gpointer data)
     (void)data;
     if (app_data.current_monitor) {
         /* Save config directly without triggering radio button callback */
-        config_set_monitor_auto_brightness_mode(app_data.config,
-                                                monitor_get_device_path(app_data.current_monitor),
-                                                AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE);
+        brightness_engine_set_mode(app_data.engine, app_data.current_monitor, AUTO_BRIGHTNESS_MODE_TIME_SCHEDULE);
 
         /* Update radio button without triggering its callback (to prevent duplicate work) */
         g_signal_handlers_block_by_func(app_data.auto_brightness_schedule_radio,
@@ -1959,9 +1175,7 @@ static void on_indicator_auto_sensor(GtkMenuItem *item, gpointer data)
     (void)data;
     if (app_data.current_monitor && light_sensor_is_available(app_data.light_sensor)) {
         /* Save config directly without triggering radio button callback */
-        config_set_monitor_auto_brightness_mode(app_data.config,
-                                                monitor_get_device_path(app_data.current_monitor),
-                                                AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR);
+        brightness_engine_set_mode(app_data.engine, app_data.current_monitor, AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR);
 
         /* Update radio button without triggering its callback (to prevent duplicate work) */
         g_signal_handlers_block_by_func(app_data.auto_brightness_sensor_radio,
@@ -1986,9 +1200,7 @@ static void on_indicator_auto_main_display(GtkMenuItem *item, gpointer data)
     (void)data;
     if (app_data.current_monitor && laptop_backlight_is_available(app_data.laptop_backlight)) {
         /* Save config directly without triggering radio button callback */
-        config_set_monitor_auto_brightness_mode(app_data.config,
-                                                monitor_get_device_path(app_data.current_monitor),
-                                                AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY);
+        brightness_engine_set_mode(app_data.engine, app_data.current_monitor, AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY);
 
         /* Update radio button without triggering its callback (to prevent duplicate work) */
         g_signal_handlers_block_by_func(app_data.auto_brightness_laptop_radio,
@@ -2020,6 +1232,23 @@ static void on_indicator_quit(GtkMenuItem *item, gpointer data)
     gtk_main_quit();
 }
 
+/* Keep the light sensor sampled while the tray label shows the light level */
+static void update_tray_lux_watch(void)
+{
+    gboolean wanted = app_data.indicator && config_get_show_light_level_in_tray(app_data.config);
+
+    if (wanted == app_data.tray_watches_lux) {
+        return;
+    }
+
+    app_data.tray_watches_lux = wanted;
+    if (wanted) {
+        brightness_engine_watch_lux(app_data.engine);
+    } else {
+        brightness_engine_unwatch_lux(app_data.engine);
+    }
+}
+
 static void update_tray_icon_label(void)
 {
     if (!app_data.indicator) {
@@ -2027,8 +1256,9 @@ static void update_tray_icon_label(void)
     }
 
     /* Check if monitors are available */
-    if (!app_data.monitors_found || !app_data.current_monitor || !monitor_is_available(app_data.current_monitor)) {
-        /* Show "X" to indicate no monitors found or current monitor unavailable */
+    if (!brightness_engine_has_monitors(app_data.engine) || !app_data.current_monitor || !monitor_is_available(app_data.current_monitor) ||
+        monitor_get_health_state(app_data.current_monitor) == MONITOR_HEALTH_OPEN) {
+        /* Show "X" to indicate no monitors found or current monitor unavailable / backing off */
         app_indicator_set_label(app_data.indicator, "X", "X");
         return;
     }
@@ -2046,7 +1276,7 @@ static void update_tray_icon_label(void)
     /* Build label based on what's enabled */
     if (show_brightness && show_light_level && light_sensor_is_available(app_data.light_sensor)) {
         /* Show both brightness and light level */
-        double lux = light_sensor_read_lux(app_data.light_sensor);
+        double lux = light_sensor_get_last_lux(app_data.light_sensor);
 
         if (lux >= 0) {
             char label[48];
@@ -2075,7 +1305,7 @@ static void update_tray_icon_label(void)
         }
     } else if (show_light_level && light_sensor_is_available(app_data.light_sensor)) {
         /* Show only ambient light level */
-        double lux = light_sensor_read_lux(app_data.light_sensor);
+        double lux = light_sensor_get_last_lux(app_data.light_sensor);
         if (lux >= 0) {
             char label[32];
             if (lux < 10) {
@@ -2120,7 +1350,7 @@ static void update_indicator_menu(void)
     AutoBrightnessMode mode = AUTO_BRIGHTNESS_MODE_DISABLED;
     if (app_data.current_monitor) {
         mode = config_get_monitor_auto_brightness_mode(app_data.config,
-                                                       monitor_get_device_path(app_data.current_monitor));
+                                                       monitor_get_config_key(app_data.current_monitor));
     }
 
     /* Calculate brightness for each mode */
@@ -2128,26 +1358,11 @@ static void update_indicator_menu(void)
     int sensor_brightness = -1;
     int main_display_brightness = -1;
 
-    if (light_sensor_is_available(app_data.light_sensor) && app_data.current_monitor) {
-        /* Use the already-loaded curve for the current monitor */
-        double lux = light_sensor_read_lux(app_data.light_sensor);
-        if (lux >= 0) {
-            sensor_brightness = light_sensor_calculate_brightness(app_data.light_sensor, lux);
-        }
-    }
-
-    if (laptop_backlight_is_available(app_data.laptop_backlight) && app_data.current_monitor) {
-        int laptop_brightness = laptop_backlight_read_brightness(app_data.laptop_backlight);
-        if (laptop_brightness >= 0) {
-            /* Apply brightness offset to get the actual target brightness */
-            int offset = config_get_monitor_brightness_offset(app_data.config,
-                                                              monitor_get_device_path(app_data.current_monitor));
-            main_display_brightness = laptop_brightness + offset;
-
-            /* Clamp to 0-100 range */
-            if (main_display_brightness < 0) main_display_brightness = 0;
-            if (main_display_brightness > 100) main_display_brightness = 100;
-        }
+    if (app_data.current_monitor) {
+        sensor_brightness = brightness_engine_get_mode_brightness(app_data.engine, app_data.current_monitor,
+                                                                  AUTO_BRIGHTNESS_MODE_LIGHT_SENSOR);
+        main_display_brightness = brightness_engine_get_mode_brightness(app_data.engine, app_data.current_monitor,
+                                                                        AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY);
     }
 
     /* Update menu items */
@@ -2244,382 +1459,3 @@ static void update_indicator_menu(void)
 }
 
 #endif
-
-#if HAVE_LIBUDEV
-/* Setup udev monitoring for hardware changes */
-static gboolean setup_udev_monitoring(void)
-{
-    app_data.udev = udev_new();
-    if (!app_data.udev) {
-        g_warning("Cannot create udev context");
-        return FALSE;
-    }
-    
-    app_data.udev_monitor = udev_monitor_new_from_netlink(app_data.udev, "udev");
-    if (!app_data.udev_monitor) {
-        g_warning("Cannot create udev monitor");
-        udev_unref(app_data.udev);
-        app_data.udev = NULL;
-        return FALSE;
-    }
-    
-    /* Monitor USB and DRM (display) subsystems for relevant hardware changes */
-    udev_monitor_filter_add_match_subsystem_devtype(app_data.udev_monitor, "usb", NULL);
-    udev_monitor_filter_add_match_subsystem_devtype(app_data.udev_monitor, "drm", NULL);
-    udev_monitor_filter_add_match_subsystem_devtype(app_data.udev_monitor, "i2c", NULL);
-    
-    if (udev_monitor_enable_receiving(app_data.udev_monitor) < 0) {
-        g_warning("Cannot enable udev monitor");
-        udev_monitor_unref(app_data.udev_monitor);
-        udev_unref(app_data.udev);
-        app_data.udev_monitor = NULL;
-        app_data.udev = NULL;
-        return FALSE;
-    }
-    
-    /* Create GIO channel to monitor udev events */
-    int fd = udev_monitor_get_fd(app_data.udev_monitor);
-    app_data.udev_io_channel = g_io_channel_unix_new(fd);
-    
-    /* Set up the watch */
-    app_data.udev_watch_id = g_io_add_watch(app_data.udev_io_channel, 
-                                           G_IO_IN, 
-                                           on_udev_event, 
-                                           NULL);
-    
-    g_message("Udev monitoring setup successfully");
-    return TRUE;
-}
-
-/* Cleanup udev monitoring */
-static void cleanup_udev_monitoring(void)
-{
-    if (app_data.udev_watch_id > 0) {
-        g_source_remove(app_data.udev_watch_id);
-        app_data.udev_watch_id = 0;
-    }
-    
-    if (app_data.udev_io_channel) {
-        g_io_channel_unref(app_data.udev_io_channel);
-        app_data.udev_io_channel = NULL;
-    }
-    
-    if (app_data.udev_monitor) {
-        udev_monitor_unref(app_data.udev_monitor);
-        app_data.udev_monitor = NULL;
-    }
-    
-    if (app_data.udev) {
-        udev_unref(app_data.udev);
-        app_data.udev = NULL;
-    }
-}
-
-/* Handle udev events */
-static gboolean on_udev_event(GIOChannel *channel, GIOCondition condition, gpointer data)
-{
-    (void)channel; (void)data;
-    
-    if (condition & G_IO_IN) {
-        struct udev_device *device = udev_monitor_receive_device(app_data.udev_monitor);
-        if (device) {
-            const char *action = udev_device_get_action(device);
-            const char *subsystem = udev_device_get_subsystem(device);
-            /* const char *devtype = udev_device_get_devtype(device); */ /* Not currently used */
-            
-            /* Check for device addition/removal events that might affect display hardware */
-            if (action && (strcmp(action, "add") == 0 || strcmp(action, "remove") == 0)) {
-                gboolean should_check_monitors = FALSE;
-                
-                if (subsystem && strcmp(subsystem, "drm") == 0) {
-                    /* DRM device added/removed - could be display hardware */
-                    should_check_monitors = TRUE;
-                    g_message("DRM device %s, checking monitor status", action);
-                } else if (subsystem && strcmp(subsystem, "usb") == 0) {
-                    /* USB device added/removed - could be USB-C/Thunderbolt display */
-                    should_check_monitors = TRUE;
-                    g_message("USB device %s, checking monitor status", action);
-                } else if (subsystem && strcmp(subsystem, "i2c") == 0) {
-                    /* I2C device added/removed - DDC/CI uses I2C */
-                    should_check_monitors = TRUE;
-                    g_message("I2C device %s, checking monitor status", action);
-                }
-                
-                if (should_check_monitors) {
-                    /* Debounce udev events: cancel any existing timers to prevent rapid
-                     * plug/unplug sequences from triggering multiple monitor refreshes */
-                    if (app_data.monitor_retry_timer > 0) {
-                        g_source_remove(app_data.monitor_retry_timer);
-                        app_data.monitor_retry_timer = 0;
-                    }
-
-                    if (strcmp(action, "add") == 0) {
-                        /* Device added - trigger monitor refresh to pick up newly connected displays */
-                        /* Use longer debounce to allow DDC/CI hardware to fully stabilize */
-                        if (app_data.recheck_timer_id > 0) {
-                            g_source_remove(app_data.recheck_timer_id);
-                        }
-                        app_data.recheck_timer_id = g_timeout_add_seconds(UDEV_DEBOUNCE_ADD_SECONDS, recheck_monitors_immediately, NULL);
-                        g_message("Hardware added, will refresh monitors in %d seconds to allow DDC/CI to stabilize", UDEV_DEBOUNCE_ADD_SECONDS);
-                    } else if (strcmp(action, "remove") == 0) {
-                        /* Device removed - re-check to see if our monitor was disconnected */
-                        /* Use shorter debounce for removals */
-                        if (app_data.recheck_timer_id > 0) {
-                            g_source_remove(app_data.recheck_timer_id);
-                        }
-                        app_data.recheck_timer_id = g_timeout_add_seconds(UDEV_DEBOUNCE_REMOVE_SECONDS, recheck_monitors_immediately, NULL);
-                        g_message("Hardware removed, will re-check monitor status in %d seconds", UDEV_DEBOUNCE_REMOVE_SECONDS);
-                    }
-                }
-            }
-            
-            udev_device_unref(device);
-        }
-    }
-    
-    return TRUE; /* Keep the watch active */
-}
-#endif /* HAVE_LIBUDEV */
-
-/* Setup inotify monitoring for laptop backlight changes */
-static gboolean setup_laptop_backlight_monitoring(void)
-{
-    /* Initialize fields */
-    app_data.laptop_backlight_inotify_fd = -1;
-    app_data.laptop_backlight_watch_fd = -1;
-    app_data.laptop_backlight_io_channel = NULL;
-    app_data.laptop_backlight_watch_id = 0;
-    app_data.last_laptop_brightness = -1;
-
-    /* Only setup monitoring if laptop backlight is available */
-    if (!laptop_backlight_is_available(app_data.laptop_backlight)) {
-        return FALSE;
-    }
-
-    /* Get the backlight device path */
-    const char *device_path = laptop_backlight_get_device_path(app_data.laptop_backlight);
-    if (!device_path) {
-        g_warning("Cannot get laptop backlight device path");
-        return FALSE;
-    }
-
-    /* Build the path to the brightness file */
-    char brightness_file[512];
-    snprintf(brightness_file, sizeof(brightness_file), "%s/brightness", device_path);
-
-    /* Create inotify instance */
-    app_data.laptop_backlight_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
-    if (app_data.laptop_backlight_inotify_fd < 0) {
-        g_warning("Failed to create inotify instance for laptop backlight: %s", strerror(errno));
-        return FALSE;
-    }
-
-    /* Watch the brightness file for modifications */
-    app_data.laptop_backlight_watch_fd = inotify_add_watch(app_data.laptop_backlight_inotify_fd,
-                                                            brightness_file,
-                                                            IN_MODIFY);
-    if (app_data.laptop_backlight_watch_fd < 0) {
-        g_warning("Failed to watch laptop backlight file %s: %s", brightness_file, strerror(errno));
-        close(app_data.laptop_backlight_inotify_fd);
-        app_data.laptop_backlight_inotify_fd = -1;
-        return FALSE;
-    }
-
-    /* Create GIO channel for inotify events */
-    app_data.laptop_backlight_io_channel = g_io_channel_unix_new(app_data.laptop_backlight_inotify_fd);
-    g_io_channel_set_encoding(app_data.laptop_backlight_io_channel, NULL, NULL);
-    g_io_channel_set_buffered(app_data.laptop_backlight_io_channel, FALSE);
-
-    /* Setup watch for inotify events */
-    app_data.laptop_backlight_watch_id = g_io_add_watch(app_data.laptop_backlight_io_channel,
-                                                        G_IO_IN,
-                                                        on_laptop_backlight_change,
-                                                        NULL);
-
-    /* Initialize last known brightness */
-    app_data.last_laptop_brightness = laptop_backlight_read_brightness(app_data.laptop_backlight);
-
-    g_message("Laptop backlight monitoring setup successfully (using inotify)");
-    return TRUE;
-}
-
-/* Cleanup laptop backlight monitoring */
-static void cleanup_laptop_backlight_monitoring(void)
-{
-    if (app_data.laptop_backlight_watch_id > 0) {
-        g_source_remove(app_data.laptop_backlight_watch_id);
-        app_data.laptop_backlight_watch_id = 0;
-    }
-
-    if (app_data.laptop_backlight_io_channel) {
-        g_io_channel_unref(app_data.laptop_backlight_io_channel);
-        app_data.laptop_backlight_io_channel = NULL;
-    }
-
-    if (app_data.laptop_backlight_watch_fd >= 0) {
-        inotify_rm_watch(app_data.laptop_backlight_inotify_fd, app_data.laptop_backlight_watch_fd);
-        app_data.laptop_backlight_watch_fd = -1;
-    }
-
-    if (app_data.laptop_backlight_inotify_fd >= 0) {
-        close(app_data.laptop_backlight_inotify_fd);
-        app_data.laptop_backlight_inotify_fd = -1;
-    }
-}
-
-/* Handle laptop backlight change events */
-static gboolean on_laptop_backlight_change(GIOChannel *channel, GIOCondition condition, gpointer data)
-{
-    (void)channel;
-    (void)data;
-
-    if (!(condition & G_IO_IN)) {
-        return TRUE;
-    }
-
-    /* Read and discard inotify events */
-    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
-    ssize_t len = read(app_data.laptop_backlight_inotify_fd, buffer, sizeof(buffer));
-
-    if (len < 0 && errno != EAGAIN) {
-        g_warning("Error reading inotify events: %s", strerror(errno));
-        return TRUE;
-    }
-
-    /* Read the current laptop brightness */
-    int current_brightness = laptop_backlight_read_brightness(app_data.laptop_backlight);
-    if (current_brightness < 0) {
-        return TRUE;
-    }
-
-    /* Check if brightness has actually changed */
-    if (current_brightness == app_data.last_laptop_brightness) {
-        return TRUE;  /* No change, ignore */
-    }
-
-    app_data.last_laptop_brightness = current_brightness;
-    g_message("Laptop brightness changed to %d%%", current_brightness);
-
-    /* Update all monitors that are in laptop display mode */
-    /* Note: app_data.monitors only contains controllable monitors (filtered during detection) */
-    if (app_data.monitors) {
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-            AutoBrightnessMode mode = config_get_monitor_auto_brightness_mode(app_data.config,
-                                                                              monitor_get_device_path(monitor));
-
-            if (mode == AUTO_BRIGHTNESS_MODE_LAPTOP_DISPLAY) {
-                /* Apply brightness offset */
-                int offset = config_get_monitor_brightness_offset(app_data.config,
-                                                                  monitor_get_device_path(monitor));
-                int target_brightness = current_brightness + offset;
-
-                /* Clamp to 0-100 range */
-                if (target_brightness < 0) target_brightness = 0;
-                if (target_brightness > 100) target_brightness = 100;
-
-                /* Use gradual transition instead of direct DDC command.
-                 * When laptop brightness oscillates rapidly during idle/dim events,
-                 * direct DDC calls per inotify event can overwhelm the DDC/AUX channel.
-                 * The transition timer applies at most one DDC command per 200ms and
-                 * naturally tracks the latest target if it changes mid-transition. */
-                monitor_set_target_brightness(monitor, target_brightness);
-
-                g_message("Laptop brightness %d%% + offset %d%% -> target %d%% (gradual transition)",
-                         current_brightness, offset, target_brightness);
-            }
-        }
-    }
-
-    return TRUE;  /* Keep the watch active */
-}
-
-/* Suspend preparation handler */
-static void on_suspend_prepare(gpointer data)
-{
-    (void)data;  /* Unused parameter */
-    
-    if (!app_data.power_manager || !app_data.monitors) {
-        return;
-    }
-    
-    g_message("Preparing for system suspend...");
-    
-    /* Save current brightness state for all monitors */
-    GList *all_monitors = NULL;
-    if (app_data.monitors) {
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-            if (monitor) {
-                all_monitors = g_list_append(all_monitors, monitor);
-            }
-        }
-    }
-    
-    power_manager_save_brightness_state(app_data.power_manager, all_monitors);
-    
-    /* Mark system as suspended */
-    app_data.power_manager->system_suspended = TRUE;
-    
-    if (all_monitors) {
-        g_list_free(all_monitors);
-    }
-    
-    g_message("Suspend preparation complete");
-}
-
-/* Called 5 seconds after resume to restore DDC brightness once monitors are stable */
-static gboolean post_resume_restore_brightness(gpointer data)
-{
-    (void)data;
-
-    if (!app_data.power_manager || app_data.power_manager->system_suspended) {
-        return G_SOURCE_REMOVE;
-    }
-
-    GList *all_monitors = NULL;
-    if (app_data.monitors) {
-        for (int i = 0; i < monitor_list_get_count(app_data.monitors); i++) {
-            Monitor *monitor = monitor_list_get_monitor(app_data.monitors, i);
-            if (monitor) all_monitors = g_list_append(all_monitors, monitor);
-        }
-    }
-
-    if (all_monitors) {
-        power_manager_restore_brightness_state(app_data.power_manager, all_monitors);
-        g_list_free(all_monitors);
-
-        if (app_data.current_monitor) {
-            int brightness = monitor_get_current_brightness(app_data.current_monitor);
-            if (brightness >= 0) {
-                app_data.updating_from_auto = TRUE;
-                gtk_range_set_value(GTK_RANGE(app_data.brightness_scale), brightness);
-                app_data.updating_from_auto = FALSE;
-                update_brightness_display();
-            }
-        }
-        g_message("Post-resume brightness restore complete");
-    }
-
-    return G_SOURCE_REMOVE;
-}
-
-/* Resume recovery handler — called from power_manager on PrepareForSleep(false) */
-static void on_resume_complete(gpointer data)
-{
-    (void)data;
-
-    if (!app_data.power_manager) return;
-
-    g_message("System resume detected, re-detecting monitors...");
-
-    /* system_suspended is already cleared by power_manager before this callback */
-
-    /* Kick off monitor detection immediately; the retry timer handles the case
-     * where the hardware (UCSI / DP link) isn't ready yet. */
-    load_monitors();
-
-    /* Restore DDC brightness asynchronously after a short delay so we don't
-     * block the main loop and give the DP link time to train. */
-    g_timeout_add_seconds(5, post_resume_restore_brightness, NULL);
-}
\ No newline at end of file
@@ -3,6 +3,8 @@
  */
 
 #include "monitor_detect.h"
+#include "edid.h"
+#include "subprocess.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,7 +12,12 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <limits.h>
-#include <sys/wait.h>
+
+/* Per-bus deadline for the controllability probe; covers the ddccontrol fallback */
+#define MONITOR_PROBE_TIMEOUT_MS 5000
+
+/* ddccontrol -p walks every I2C bus; give up on it after this long */
+#define MONITOR_SCAN_TIMEOUT_MS 30000
 
 /* Check if an i2c device corresponds to an internal display (eDP or LVDS) */
 static gboolean is_internal_display(const char *device_path)
@@ -86,157 +93,488 @@ static gint monitor_compare_func(gconstpointer a, gconstpointer b)
     return 0;
 }
 
-/* Detect all available monitors */
-MonitorList* monitor_detect_all(void)
+/* Parser state for "ddccontrol -p" output */
+typedef struct {
+    regex_t device_regex;
+    regex_t name_regex;
+    char current_device[64];
+    char current_name[128];
+    gboolean ddc_supported;
+    MonitorList *list;
+    MonitorDetectCallback callback;
+    gpointer user_data;
+} DdccontrolScan;
+
+/* Add the monitor whose block of ddccontrol -p output just ended, if it supports DDC/CI */
+static void scan_add_current_monitor(DdccontrolScan *scan)
+{
+    if (strlen(scan->current_device) == 0 || !scan->ddc_supported) {
+        return;
+    }
+
+    /* Check if this is an internal display */
+    gboolean is_internal = is_internal_display(scan->current_device);
+
+    /* Create display name with Internal/External label */
+    char display_name[256];
+    const char *type_label = is_internal ? "Internal" : "External";
+
+    if (strlen(scan->current_name) > 0) {
+        snprintf(display_name, sizeof(display_name), "%s (%s - %s)",
+                scan->current_name, type_label, scan->current_device);
+    } else {
+        snprintf(display_name, sizeof(display_name), "Monitor (%s - %s)",
+                type_label, scan->current_device);
+    }
+
+    Monitor *monitor = monitor_new(scan->current_device, display_name);
+    monitor_set_internal(monitor, is_internal);
+    if (strlen(scan->current_name) > 0)
+        monitor_set_model_name(monitor, scan->current_name);
+
+    monitor_list_add(scan->list, monitor);
+    g_message("Found monitor: %s (%s)", scan->current_device, type_label);
+}
+
+/* One line of ddccontrol -p output */
+static void on_ddccontrol_scan_line(const char *line, gpointer user_data)
+{
+    DdccontrolScan *scan = (DdccontrolScan*)user_data;
+    regmatch_t matches[3];
+
+    /* Look for device path */
+    if (regexec(&scan->device_regex, line, 3, matches, 0) == 0) {
+        /* If we have a previous monitor with DDC support, add it */
+        scan_add_current_monitor(scan);
+
+        /* Extract new device path */
+        int len = matches[1].rm_eo - matches[1].rm_so;
+        if (len < (int)sizeof(scan->current_device)) {
+            strncpy(scan->current_device, line + matches[1].rm_so, len);
+            scan->current_device[len] = '\0';
+            scan->current_name[0] = '\0';  /* Reset name */
+            scan->ddc_supported = FALSE;   /* Reset DDC support flag */
+        }
+    }
+
+    /* Look for DDC/CI support */
+    if (strstr(line, "DDC/CI supported: Yes")) {
+        scan->ddc_supported = TRUE;
+    }
+
+    /* Look for monitor name */
+    if (regexec(&scan->name_regex, line, 3, matches, 0) == 0) {
+        int len = matches[1].rm_eo - matches[1].rm_so;
+        if (len < (int)sizeof(scan->current_name)) {
+            strncpy(scan->current_name, line + matches[1].rm_so, len);
+            scan->current_name[len] = '\0';
+        }
+    }
+}
+
+/* ddccontrol -p finished (or was killed at the deadline) */
+static void on_ddccontrol_scan_done(gboolean success, gboolean timed_out, gpointer user_data)
+{
+    DdccontrolScan *scan = (DdccontrolScan*)user_data;
+    (void)success;
+
+    if (timed_out) {
+        g_warning("ddccontrol -p did not finish within %d ms, using the monitors found so far",
+                  MONITOR_SCAN_TIMEOUT_MS);
+    } else {
+        /* Add the last monitor if it has DDC support */
+        scan_add_current_monitor(scan);
+    }
+
+    regfree(&scan->device_regex);
+    regfree(&scan->name_regex);
+
+    if (monitor_list_get_count(scan->list) == 0) {
+        g_warning("No DDC/CI compatible monitors found");
+    } else {
+        /* Sort monitors: external monitors first, then internal */
+        monitor_list_sort(scan->list, monitor_compare_func);
+        g_message("Sorted %d monitor(s) - external monitors prioritized",
+                 monitor_list_get_count(scan->list));
+    }
+
+    scan->callback(scan->list, scan->user_data);
+    g_free(scan);
+}
+
+/* Detect all available monitors with ddccontrol -p */
+void monitor_detect_all_async(MonitorDetectCallback callback, gpointer user_data)
 {
     MonitorList *list = monitor_list_new();
-    
+
     /* Check if ddccontrol is available */
     if (!monitor_detect_ddccontrol_available()) {
         g_warning("ddccontrol command not found");
-        return list;
+        callback(list, user_data);
+        return;
     }
-    
-    /* Execute ddccontrol -p to probe for monitors */
-    FILE *fp = popen("ddccontrol -p 2>/dev/null", "r");
-    if (!fp) {
-        g_warning("Failed to execute ddccontrol -p");
-        return list;
-    }
-    
-    char line[512];
-    regex_t device_regex, name_regex;
-    regmatch_t matches[3];
-    
+
+    DdccontrolScan *scan = g_new0(DdccontrolScan, 1);
+    scan->list = list;
+    scan->callback = callback;
+    scan->user_data = user_data;
+
     /* Compile regex to match device lines and monitor name lines */
-    if (regcomp(&device_regex, "Device: dev:(/dev/i2c-[0-9]+)", REG_EXTENDED) != 0) {
+    if (regcomp(&scan->device_regex, "Device: dev:(/dev/i2c-[0-9]+)", REG_EXTENDED) != 0) {
         g_warning("Failed to compile device regex");
-        pclose(fp);
-        return list;
+        g_free(scan);
+        callback(list, user_data);
+        return;
     }
-    
-    if (regcomp(&name_regex, "Monitor Name: (.+)", REG_EXTENDED) != 0) {
+
+    if (regcomp(&scan->name_regex, "Monitor Name: (.+)", REG_EXTENDED) != 0) {
         g_warning("Failed to compile name regex");
-        regfree(&device_regex);
-        pclose(fp);
-        return list;
-    }
-    
-    char current_device[64] = "";
-    char current_name[128] = "";
-    gboolean ddc_supported = FALSE;
-    
-    while (fgets(line, sizeof(line), fp)) {
-        /* Remove trailing newline */
-        char *newline = strchr(line, '\n');
+        regfree(&scan->device_regex);
+        g_free(scan);
+        callback(list, user_data);
+        return;
+    }
+
+    /* Execute ddccontrol -p to probe for monitors; output is parsed as it arrives */
+    const char *argv[] = { "ddccontrol", "-p", NULL };
+    if (!subprocess_run_async(argv, MONITOR_SCAN_TIMEOUT_MS,
+                              on_ddccontrol_scan_line, on_ddccontrol_scan_done, scan)) {
+        regfree(&scan->device_regex);
+        regfree(&scan->name_regex);
+        g_free(scan);
+        callback(list, user_data);
+    }
+}
+
+/* Test if ddccontrol is available */
+gboolean monitor_detect_ddccontrol_available(void)
+{
+    char *path = g_find_program_in_path("ddccontrol");
+    gboolean available = (path != NULL);
+
+    g_free(path);
+    return available;
+}
+
+/* Read a short sysfs attribute into buf, stripping the trailing newline */
+static gboolean read_sysfs_attribute(const char *path, char *buf, size_t size)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return FALSE;
+    }
+
+    gboolean ok = (fgets(buf, size, fp) != NULL);
+    fclose(fp);
+
+    if (ok) {
+        char *newline = strchr(buf, '\n');
         if (newline) *newline = '\0';
-        
-        /* Look for device path */
-        if (regexec(&device_regex, line, 3, matches, 0) == 0) {
-            /* If we have a previous monitor with DDC support, add it */
-            if (strlen(current_device) > 0 && ddc_supported) {
-                /* Check if this is an internal display */
-                gboolean is_internal = is_internal_display(current_device);
-
-                /* Create display name with Internal/External label */
-                char display_name[256];
-                const char *type_label = is_internal ? "Internal" : "External";
-
-                if (strlen(current_name) > 0) {
-                    snprintf(display_name, sizeof(display_name), "%s (%s - %s)",
-                            current_name, type_label, current_device);
-                } else {
-                    snprintf(display_name, sizeof(display_name), "Monitor (%s - %s)",
-                            type_label, current_device);
-                }
+    }
+    return ok;
+}
 
-                Monitor *monitor = monitor_new(current_device, display_name);
-                monitor_set_internal(monitor, is_internal);
-                if (strlen(current_name) > 0)
-                    monitor_set_model_name(monitor, current_name);
+/* List external DDC/CI candidates from DRM connectors in sysfs.
+ * Each connected connector's "ddc" symlink names its I2C adapter and its "edid"
+ * file identifies the monitor, so candidates are known without any I2C traffic.
+ * Internal panels are skipped. */
+GPtrArray* monitor_detect_list_candidates(void)
+{
+    GPtrArray *candidates = g_ptr_array_new();
 
-                monitor_list_add(list, monitor);
-                g_message("Found monitor: %s (%s)", current_device, type_label);
-            }
-            
-            /* Extract new device path */
-            int len = matches[1].rm_eo - matches[1].rm_so;
-            if (len < sizeof(current_device)) {
-                strncpy(current_device, line + matches[1].rm_so, len);
-                current_device[len] = '\0';
-                current_name[0] = '\0';  /* Reset name */
-                ddc_supported = FALSE;   /* Reset DDC support flag */
-            }
+    DIR *drm_dir = opendir("/sys/class/drm");
+    if (!drm_dir) {
+        return candidates;
+    }
+
+    GHashTable *seen_buses = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GHashTable *identity_counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GPtrArray *connectors = g_ptr_array_new_with_free_func(g_free);  /* Parallel to candidates */
+    struct dirent *entry;
+    char path[PATH_MAX];
+    char link_target[PATH_MAX];
+    char status[32];
+
+    while ((entry = readdir(drm_dir)) != NULL) {
+        /* Connector entries look like card0-DP-1, card1-HDMI-A-2 */
+        if (strncmp(entry->d_name, "card", 4) != 0 || !strchr(entry->d_name, '-')) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/sys/class/drm/%s/status", entry->d_name);
+        if (!read_sysfs_attribute(path, status, sizeof(status)) || strcmp(status, "connected") != 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/sys/class/drm/%s/ddc", entry->d_name);
+        ssize_t len = readlink(path, link_target, sizeof(link_target) - 1);
+        if (len <= 0) {
+            continue;
+        }
+        link_target[len] = '\0';
+
+        const char *bus_name = strrchr(link_target, '/');
+        bus_name = bus_name ? bus_name + 1 : link_target;
+        if (!g_str_has_prefix(bus_name, "i2c-")) {
+            continue;
+        }
+
+        const char *connector = strchr(entry->d_name, '-') + 1;
+        if (g_str_has_prefix(connector, "eDP-") || g_str_has_prefix(connector, "LVDS-")) {
+            g_debug("Skipping internal display connector %s", entry->d_name);
+            continue;
+        }
+
+        char device_path[64];
+        snprintf(device_path, sizeof(device_path), "/dev/%s", bus_name);
+        if (g_hash_table_contains(seen_buses, device_path)) {
+            continue;
+        }
+        if (access(device_path, F_OK) != 0) {
+            g_debug("%s for connector %s does not exist (is i2c-dev loaded?)", device_path, entry->d_name);
+            continue;
         }
-        
-        /* Look for DDC/CI support */
-        if (strstr(line, "DDC/CI supported: Yes")) {
-            ddc_supported = TRUE;
-        }
-        
-        /* Look for monitor name */
-        if (regexec(&name_regex, line, 3, matches, 0) == 0) {
-            int len = matches[1].rm_eo - matches[1].rm_so;
-            if (len < sizeof(current_name)) {
-                strncpy(current_name, line + matches[1].rm_so, len);
-                current_name[len] = '\0';
+        g_hash_table_add(seen_buses, g_strdup(device_path));
+
+        EdidInfo edid;
+        char *identity = NULL;
+        snprintf(path, sizeof(path), "/sys/class/drm/%s/edid", entry->d_name);
+        gboolean has_edid = edid_read_file(path, &edid);
+        if (has_edid) {
+            identity = edid_build_identity(&edid);
+
+            /* Without a serial, identical models share an identity: tell them apart by
+             * connector, whatever order they are listed in */
+            if (!edid_has_serial(&edid)) {
+                char *unique = g_strdup_printf("%s-%s", identity, connector);
+                g_free(identity);
+                identity = unique;
             }
+            int count = GPOINTER_TO_INT(g_hash_table_lookup(identity_counts, identity));
+            g_hash_table_insert(identity_counts, g_strdup(identity), GINT_TO_POINTER(count + 1));
         }
-    }
-    
-    /* Add the last monitor if it has DDC support */
-    if (strlen(current_device) > 0 && ddc_supported) {
-        /* Check if this is an internal display */
-        gboolean is_internal = is_internal_display(current_device);
 
-        /* Create display name with Internal/External label */
         char display_name[256];
-        const char *type_label = is_internal ? "Internal" : "External";
+        if (has_edid && edid.name[0] != '\0') {
+            snprintf(display_name, sizeof(display_name), "%s (External - %s - %s)",
+                     edid.name, connector, device_path);
+        } else {
+            snprintf(display_name, sizeof(display_name), "Monitor (External - %s - %s)", connector, device_path);
+        }
+
+        Monitor *monitor = monitor_new(device_path, display_name);
+        monitor_set_internal(monitor, FALSE);
+        monitor_set_identity(monitor, identity);
+        if (has_edid && edid.name[0] != '\0') {
+            monitor_set_model_name(monitor, edid.name);
+        }
+        g_ptr_array_add(candidates, monitor);
+        g_ptr_array_add(connectors, g_strdup(connector));
+        g_message("Found DDC candidate: %s on connector %s (%s)", device_path, connector,
+                  identity ? identity : "no EDID");
+        g_free(identity);
+    }
 
-        if (strlen(current_name) > 0) {
-            snprintf(display_name, sizeof(display_name), "%s (%s - %s)",
-                    current_name, type_label, current_device);
+    /* Monitors reporting the same serial: suffix every one of them, not just
+     * those listed after the first */
+    for (guint i = 0; i < candidates->len; i++) {
+        Monitor *monitor = g_ptr_array_index(candidates, i);
+        const char *identity = monitor_get_identity(monitor);
+        if (!identity || GPOINTER_TO_INT(g_hash_table_lookup(identity_counts, identity)) < 2) {
+            continue;
+        }
+
+        char *unique = g_strdup_printf("%s-%s", identity, (const char*)g_ptr_array_index(connectors, i));
+        g_message("EDID identity %s is not unique, using %s", identity, unique);
+        monitor_set_identity(monitor, unique);
+        g_free(unique);
+    }
+
+    g_ptr_array_free(connectors, TRUE);
+    g_hash_table_destroy(identity_counts);
+    g_hash_table_destroy(seen_buses);
+    closedir(drm_dir);
+    return candidates;
+}
+
+/* Controllability probe state */
+typedef struct _DetectProbe DetectProbe;
+
+typedef struct {
+    DetectProbe *probe;
+    Monitor *monitor;
+    guint timeout_id;
+    gboolean done;
+    gboolean controllable;
+} BusProbe;
+
+struct _DetectProbe {
+    BusProbe *buses;
+    guint count;
+    guint pending;
+    MonitorDetectCallback callback;
+    gpointer user_data;
+};
+
+/* Every bus has answered or timed out: hand over the controllable monitors */
+static void finish_detect_probe(DetectProbe *probe)
+{
+    MonitorList *list = monitor_list_new();
+
+    for (guint i = 0; i < probe->count; i++) {
+        BusProbe *bus = &probe->buses[i];
+        if (bus->controllable) {
+            monitor_list_add(list, bus->monitor);
         } else {
-            snprintf(display_name, sizeof(display_name), "Monitor (%s - %s)",
-                    type_label, current_device);
+            /* Detaches the bus queue, so a late probe reply is dropped */
+            g_message("Excluding non-controllable monitor: %s", monitor_get_display_name(bus->monitor));
+            monitor_unref(bus->monitor);
         }
+    }
+
+    g_message("Found %d controllable monitors out of %u candidates", monitor_list_get_count(list), probe->count);
 
-        Monitor *monitor = monitor_new(current_device, display_name);
-        monitor_set_internal(monitor, is_internal);
-        if (strlen(current_name) > 0)
-            monitor_set_model_name(monitor, current_name);
+    probe->callback(list, probe->user_data);
+    g_free(probe->buses);
+    g_free(probe);
+}
+
+/* Mark one bus finished */
+static void complete_bus_probe(BusProbe *bus)
+{
+    DetectProbe *probe = bus->probe;
 
-        monitor_list_add(list, monitor);
-        g_message("Found monitor: %s (%s)", current_device, type_label);
+    bus->done = TRUE;
+    if (bus->timeout_id > 0) {
+        g_source_remove(bus->timeout_id);
+        bus->timeout_id = 0;
     }
-    
-    regfree(&device_regex);
-    regfree(&name_regex);
-    pclose(fp);
 
-    if (monitor_list_get_count(list) == 0) {
-        g_warning("No DDC/CI compatible monitors found");
+    if (--probe->pending == 0) {
+        finish_detect_probe(probe);
+    }
+}
+
+/* Probe read completed on the bus worker */
+static void on_bus_probe_read(Monitor *monitor, int brightness, gboolean success, gpointer user_data)
+{
+    BusProbe *bus = (BusProbe*)user_data;
+    if (bus->done) {
+        return;
+    }
+
+    if (success) {
+        g_message("Monitor %s is controllable (brightness: %d%%)", monitor_get_display_name(monitor), brightness);
+        bus->controllable = TRUE;
     } else {
-        /* Sort monitors: external monitors first, then internal */
-        monitor_list_sort(list, monitor_compare_func);
-        g_message("Sorted %d monitor(s) - external monitors prioritized",
-                 monitor_list_get_count(list));
+        g_debug("Monitor %s DDC/CI read failed, not controllable", monitor_get_display_name(monitor));
     }
 
-    return list;
+    complete_bus_probe(bus);
 }
 
-/* Test if ddccontrol is available */
-gboolean monitor_detect_ddccontrol_available(void)
+/* Probe did not answer in time */
+static gboolean on_bus_probe_timeout(gpointer user_data)
 {
-    int result = system("which ddccontrol >/dev/null 2>&1");
+    BusProbe *bus = (BusProbe*)user_data;
 
-    /* Check if fork/exec failed */
-    if (result == -1) {
-        g_warning("Failed to execute 'which' command");
-        return FALSE;
+    bus->timeout_id = 0;
+    g_warning("DDC/CI probe of %s timed out after %d ms",
+              monitor_get_device_path(bus->monitor), MONITOR_PROBE_TIMEOUT_MS);
+    complete_bus_probe(bus);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Pending ddccontrol -p fallback of monitor_detect_controllable_async() */
+typedef struct {
+    MonitorDetectCallback callback;
+    gpointer user_data;
+} DetectFallback;
+
+/* ddccontrol -p scan done: probe the external monitors it found */
+static void on_fallback_scan_done(MonitorList *scanned, gpointer user_data)
+{
+    DetectFallback *fallback = (DetectFallback*)user_data;
+    GPtrArray *candidates = g_ptr_array_new();
+
+    for (int i = 0; i < monitor_list_get_count(scanned); i++) {
+        Monitor *scanned_monitor = monitor_list_get_monitor(scanned, i);
+
+        /* Internal monitors are not controllable via DDC/CI */
+        if (monitor_is_internal(scanned_monitor)) {
+            continue;
+        }
+
+        Monitor *monitor = monitor_new(monitor_get_device_path(scanned_monitor),
+                                       monitor_get_display_name(scanned_monitor));
+        if (monitor_get_model_name(scanned_monitor))
+            monitor_set_model_name(monitor, monitor_get_model_name(scanned_monitor));
+        g_ptr_array_add(candidates, monitor);
     }
+    monitor_list_free(scanned);
 
-    /* Check if command executed successfully and exited with status 0 */
-    return (WIFEXITED(result) && WEXITSTATUS(result) == 0);
-}
\ No newline at end of file
+    monitor_detect_probe_async(candidates, fallback->callback, fallback->user_data);
+    g_free(fallback);
+}
+
+/* Detect controllable monitors without blocking the main loop */
+void monitor_detect_controllable_async(MonitorDetectCallback callback, gpointer user_data)
+{
+    GPtrArray *candidates = monitor_detect_list_candidates();
+
+    /* Drivers without DRM ddc links: fall back to a ddccontrol -p scan */
+    if (candidates->len == 0) {
+        g_ptr_array_free(candidates, TRUE);
+        g_message("No DDC buses found in sysfs, falling back to ddccontrol -p");
+
+        DetectFallback *fallback = g_new0(DetectFallback, 1);
+        fallback->callback = callback;
+        fallback->user_data = user_data;
+        monitor_detect_all_async(on_fallback_scan_done, fallback);
+        return;
+    }
+
+    monitor_detect_probe_async(candidates, callback, user_data);
+}
+
+/* Probe the given candidates concurrently */
+void monitor_detect_probe_async(GPtrArray *candidates, MonitorDetectCallback callback, gpointer user_data)
+{
+    DetectProbe *probe = g_new0(DetectProbe, 1);
+    probe->count = candidates->len;
+    probe->buses = g_new0(BusProbe, MAX(candidates->len, 1));
+    probe->callback = callback;
+    probe->user_data = user_data;
+    probe->pending = 1;  /* Held until every probe has been submitted */
+
+    g_message("Probing %u DDC bus(es) for controllability...", probe->count);
+
+    /* Each bus has its own worker thread, so all probes run concurrently */
+    for (guint i = 0; i < candidates->len; i++) {
+        BusProbe *bus = &probe->buses[i];
+        bus->probe = probe;
+        bus->monitor = g_ptr_array_index(candidates, i);
+
+        /* Brightness already seeded from the cache: the monitor answered DDC/CI
+         * recently, so accept it without waiting for the bus; the caller
+         * revalidates it in the background */
+        if (monitor_get_current_brightness(bus->monitor) >= 0) {
+            g_message("Monitor %s is controllable (cached brightness: %d%%)",
+                      monitor_get_display_name(bus->monitor), monitor_get_current_brightness(bus->monitor));
+            bus->done = TRUE;
+            bus->controllable = TRUE;
+            continue;
+        }
+
+        probe->pending++;
+        bus->timeout_id = g_timeout_add(MONITOR_PROBE_TIMEOUT_MS, on_bus_probe_timeout, bus);
+        monitor_get_brightness_async(bus->monitor, on_bus_probe_read, bus);
+    }
+
+    g_ptr_array_free(candidates, TRUE);
+
+    if (--probe->pending == 0) {
+        finish_detect_probe(probe);
+    }
+}
@@ -9,8 +9,29 @@
 
 G_BEGIN_DECLS
 
-/* Detect all available DDC/CI monitors */
-MonitorList* monitor_detect_all(void);
+/* Detect controllable external monitors without blocking: DDC buses are listed
+ * from DRM connectors in sysfs (ddccontrol -p if none are exposed) and each is
+ * probed concurrently with a brightness read, under a per-bus timeout. Probed
+ * monitors come back with their current brightness already known.
+ * The callback owns the returned list and runs on the main loop. */
+typedef void (*MonitorDetectCallback)(MonitorList *controllable, gpointer user_data);
+void monitor_detect_controllable_async(MonitorDetectCallback callback, gpointer user_data);
+
+/* Detect all DDC/CI monitors with a ddccontrol -p scan, internal ones included.
+ * Runs ddccontrol without a shell under a deadline; the callback owns the list. */
+void monitor_detect_all_async(MonitorDetectCallback callback, gpointer user_data);
+
+/* List connected external monitors from DRM connectors in sysfs (EDID identity
+ * and DDC bus) without any I2C traffic. Returns unprobed Monitors; the caller
+ * owns the array and the monitors in it (free with g_ptr_array_free(a, TRUE)
+ * after unreffing or handing off each monitor). */
+GPtrArray* monitor_detect_list_candidates(void);
+
+/* Probe candidate monitors concurrently, as monitor_detect_controllable_async()
+ * does after listing them. Candidates whose brightness is already known (seeded
+ * from a cache) are accepted without a probe. Takes ownership of the array and
+ * the monitors. */
+void monitor_detect_probe_async(GPtrArray *candidates, MonitorDetectCallback callback, gpointer user_data);
 
 /* Test if ddccontrol is available */
 gboolean monitor_detect_ddccontrol_available(void);
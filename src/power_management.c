@@ -25,7 +25,7 @@ struct _PowerManager {
     gboolean screen_blanked;
 
     /* Saved brightness state for restoration after resume */
-    GHashTable *saved_brightness_states;  /* device_path -> GINT_TO_POINTER(brightness) */
+    GHashTable *saved_brightness_states;  /* monitor config key -> GINT_TO_POINTER(brightness) */
 
     /* systemd/logind integration */
     #if HAVE_POWER_MANAGEMENT
@@ -66,6 +66,8 @@ PowerManager* power_manager_new(void)
     manager->on_suspend_cb = NULL;
     manager->on_resume_cb = NULL;
     manager->cb_data = NULL;
+    manager->on_blank_cb = NULL;
+    manager->blank_cb_data = NULL;
 
     return manager;
 }
@@ -85,7 +87,7 @@ void power_manager_free(PowerManager *manager)
 }
 
 /* Save current brightness state for all monitors */
-void power_manager_save_brightness_state(PowerManager *manager, GList *monitors)
+void power_manager_save_brightness_state(PowerManager *manager, MonitorList *monitors)
 {
     if (!manager || !monitors) {
         return;
@@ -97,16 +99,18 @@ void power_manager_save_brightness_state(PowerManager *manager, GList *monitors)
     g_hash_table_remove_all(manager->saved_brightness_states);
     
     /* Save brightness for each monitor */
-    for (GList *iter = monitors; iter != NULL; iter = iter->next) {
-        Monitor *monitor = (Monitor *)iter->data;
-        if (monitor && monitor_is_available(monitor)) {
+    MonitorListIter iter;
+    Monitor *monitor;
+    monitor_list_iter_init(&iter, monitors);
+    while (monitor_list_iter_next(&iter, &monitor)) {
+        if (monitor_is_available(monitor)) {
             int brightness = monitor_get_current_brightness(monitor);
             if (brightness >= 0) {
-                const char *device_path = monitor_get_device_path(monitor);
-                if (device_path) {
-                    g_message("Saved brightness %d%% for monitor %s", brightness, device_path);
+                const char *monitor_key = monitor_get_config_key(monitor);
+                if (monitor_key) {
+                    g_message("Saved brightness %d%% for monitor %s", brightness, monitor_key);
                     g_hash_table_insert(manager->saved_brightness_states, 
-                                       g_strdup(device_path), 
+                                       g_strdup(monitor_key), 
                                        GINT_TO_POINTER(brightness));
                 }
             }
@@ -117,43 +121,15 @@ void power_manager_save_brightness_state(PowerManager *manager, GList *monitors)
               g_hash_table_size(manager->saved_brightness_states));
 }
 
-/* Restore brightness state to all monitors */
-void power_manager_restore_brightness_state(PowerManager *manager, GList *monitors)
+/* Brightness saved for a monitor before suspend */
+int power_manager_get_saved_brightness(PowerManager *manager, const char *monitor_key)
 {
-    if (!manager || !monitors || g_hash_table_size(manager->saved_brightness_states) == 0) {
-        return;
-    }
-    
-    g_message("Restoring brightness state after resume...");
-    
-    int restored_count = 0;
-    
-    /* Restore brightness for each monitor */
-    for (GList *iter = monitors; iter != NULL; iter = iter->next) {
-        Monitor *monitor = (Monitor *)iter->data;
-        if (monitor && monitor_is_available(monitor)) {
-            const char *device_path = monitor_get_device_path(monitor);
-            if (device_path) {
-                gpointer brightness_ptr = g_hash_table_lookup(manager->saved_brightness_states, 
-                                                             device_path);
-                if (brightness_ptr) {
-                    int brightness = GPOINTER_TO_INT(brightness_ptr);
-                    gboolean success = monitor_set_brightness(monitor, brightness);
-                    
-                    if (success) {
-                        g_message("Restored brightness %d%% for monitor %s", brightness, device_path);
-                        restored_count++;
-                    } else {
-                        g_warning("Failed to restore brightness %d%% for monitor %s", 
-                                  brightness, device_path);
-                    }
-                }
-            }
-        }
+    if (!manager || !monitor_key) {
+        return -1;
     }
-    
-    g_message("Restored brightness state for %d/%d monitors", 
-              restored_count, g_hash_table_size(manager->saved_brightness_states));
+
+    gpointer brightness_ptr = g_hash_table_lookup(manager->saved_brightness_states, monitor_key);
+    return brightness_ptr ? GPOINTER_TO_INT(brightness_ptr) : -1;
 }
 
 /* Check if system is suspended */
@@ -188,8 +164,12 @@ static void on_screensaver_active_changed(GDBusConnection *connection,
     gboolean active = FALSE;
     g_variant_get(parameters, "(b)", &active);
 
+    gboolean changed = manager->screen_blanked != active;
     manager->screen_blanked = active;
     g_message("Screen %s (signal: %s)", active ? "blanked" : "unblanked", interface_name);
+
+    if (changed && manager->on_blank_cb)
+        manager->on_blank_cb(active, manager->blank_cb_data);
 }
 
 /* Subscribe to screensaver ActiveChanged signals on the session bus.
@@ -249,6 +229,16 @@ void power_manager_set_callbacks(PowerManager *manager,
     manager->cb_data       = user_data;
 }
 
+/* Register screen blank callback */
+void power_manager_set_blank_callback(PowerManager *manager,
+                                      void (*on_blank)(gboolean, gpointer),
+                                      gpointer user_data)
+{
+    if (!manager) return;
+    manager->on_blank_cb   = on_blank;
+    manager->blank_cb_data = user_data;
+}
+
 /* GDBus handler for org.freedesktop.login1.Manager.PrepareForSleep(b before).
  * before=TRUE  → system is about to suspend.
  * before=FALSE → system has just resumed. */
@@ -6,6 +6,7 @@
 #define POWER_MANAGEMENT_H
 
 #include <glib.h>
+#include "brightness_control.h"
 
 G_BEGIN_DECLS
 
@@ -37,6 +38,10 @@ typedef struct {
     void (*on_resume_cb)(gpointer user_data);
     gpointer cb_data;
 
+    /* Callback fired when the screen blanks or unblanks */
+    void (*on_blank_cb)(gboolean blanked, gpointer user_data);
+    gpointer blank_cb_data;
+
 } PowerManager;
 
 /* Initialize power management */
@@ -48,10 +53,10 @@ gboolean power_manager_setup_monitoring(PowerManager *manager);
 void power_manager_cleanup_monitoring(PowerManager *manager);
 
 /* Save current brightness state for all monitors */
-void power_manager_save_brightness_state(PowerManager *manager, GList *monitors);
+void power_manager_save_brightness_state(PowerManager *manager, MonitorList *monitors);
 
-/* Restore brightness state to all monitors */
-void power_manager_restore_brightness_state(PowerManager *manager, GList *monitors);
+/* Brightness saved for a monitor (by config key) before suspend, or -1 */
+int power_manager_get_saved_brightness(PowerManager *manager, const char *monitor_key);
 
 /* Check if system is suspended */
 gboolean power_manager_is_system_suspended(PowerManager *manager);
@@ -65,6 +70,11 @@ void power_manager_set_callbacks(PowerManager *manager,
                                   void (*on_resume)(gpointer),
                                   gpointer user_data);
 
+/* Register a callback for screensaver/DPMS blank changes */
+void power_manager_set_blank_callback(PowerManager *manager,
+                                      void (*on_blank)(gboolean, gpointer),
+                                      gpointer user_data);
+
 G_END_DECLS
 
 #endif /* POWER_MANAGEMENT_H */
\ No newline at end of file
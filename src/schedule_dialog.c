@@ -2,7 +2,7 @@
  * schedule_dialog.c - Schedule configuration dialog implementation
  */
 
-#include "scheduler.h"
+#include "schedule_dialog.h"
 #include <gtk/gtk.h>
 
 /* Dialog data structure */
@@ -215,10 +215,10 @@ static void refresh_schedule_list(ScheduleDialogData *data)
 {
     gtk_list_store_clear(data->list_store);
     
-    GList *entries = scheduler_get_entries(data->scheduler);
+    int count = scheduler_get_entry_count(data->scheduler);
     
-    for (GList *item = entries; item; item = item->next) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
+    for (int i = 0; i < count; i++) {
+        const ScheduleEntry *entry = scheduler_get_entry(data->scheduler, i);
         
         char time_str[16];
         snprintf(time_str, sizeof(time_str), "%02d:%02d", entry->hour, entry->minute);
@@ -242,9 +242,9 @@ static void on_add_clicked(GtkButton *button, ScheduleDialogData *data)
     int brightness = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(data->brightness_spin));
     
     /* Check for duplicate time */
-    GList *entries = scheduler_get_entries(data->scheduler);
-    for (GList *item = entries; item; item = item->next) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
+    int count = scheduler_get_entry_count(data->scheduler);
+    for (int i = 0; i < count; i++) {
+        const ScheduleEntry *entry = scheduler_get_entry(data->scheduler, i);
         if (entry->hour == hour && entry->minute == minute) {
             GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(data->dialog),
                                                       GTK_DIALOG_MODAL,
@@ -313,7 +313,7 @@ static void on_save_clicked(GtkButton *button, ScheduleDialogData *data)
     
     /* Save to configuration */
     if (scheduler_save_to_config(data->scheduler, data->config)) {
-        config_save(data->config);
+        config_schedule_save(data->config);
         gtk_dialog_response(GTK_DIALOG(data->dialog), GTK_RESPONSE_OK);
     } else {
         GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(data->dialog),
@@ -587,13 +587,10 @@ static gboolean on_graph_draw(GtkWidget *widget, cairo_t *cr, ScheduleDialogData
 
     SchedulePoint *points = g_new(SchedulePoint, count);
 
-    GList *entries = scheduler_get_entries(data->scheduler);
-    int idx = 0;
-    for (GList *item = entries; item; item = item->next) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
+    for (int idx = 0; idx < count; idx++) {
+        const ScheduleEntry *entry = scheduler_get_entry(data->scheduler, idx);
         points[idx].hour_decimal = entry->hour + (entry->minute / 60.0);
         points[idx].brightness = entry->brightness;
-        idx++;
     }
 
     /* Draw the brightness curve */
@@ -0,0 +1,19 @@
+/*
+ * schedule_dialog.h - Schedule configuration dialog interface
+ */
+
+#ifndef SCHEDULE_DIALOG_H
+#define SCHEDULE_DIALOG_H
+
+#include <gtk/gtk.h>
+#include "config.h"
+#include "scheduler.h"
+
+G_BEGIN_DECLS
+
+/* Show the schedule configuration dialog */
+void show_schedule_dialog(GtkWidget *parent, BrightnessScheduler *scheduler, AppConfig *config);
+
+G_END_DECLS
+
+#endif /* SCHEDULE_DIALOG_H */
@@ -1,23 +1,56 @@
 /*
  * scheduler.c - Brightness scheduling implementation
+ *
+ * Entries live in a sorted array. Instead of being polled, the scheduler
+ * computes the next second at which the interpolated brightness changes and
+ * arms a single timeout for it, so a schedule-only setup wakes once per 1%
+ * step plus a periodic safety wakeup. Wall-clock jumps (settimeofday, NTP
+ * steps) are caught with a CLOCK_REALTIME timerfd using
+ * TFD_TIMER_CANCEL_ON_SET, time zone changes by watching /etc/localtime, and
+ * the owner re-arms after resume with scheduler_rearm().
  */
 
+/* CLOCK_REALTIME */
+#define _XOPEN_SOURCE 700
+
 #include "scheduler.h"
+#include <gio/gio.h>
+#include <glib-unix.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <time.h>
-#include <math.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+/* Longest sleep between wakeups; bounds the error of a DST switch or a missed
+ * time zone notification */
+#define SCHEDULER_MAX_SLEEP_SECONDS (60 * 60)
 
 /* Scheduler structure */
 struct _BrightnessScheduler {
-    GList *entries;
+    GArray *entries;            /* ScheduleEntry, sorted by time of day */
+
+    /* Deadline tracking (active between scheduler_start() and scheduler_stop()) */
+    SchedulerChangeFunc change_func;
+    gpointer change_data;
+    int current_brightness;     /* Value as of the last wakeup */
+    guint timeout_id;           /* Next change */
+    int clock_fd;               /* timerfd reporting wall-clock jumps, -1 if unavailable */
+    guint clock_watch_id;
+    GFileMonitor *zone_monitor; /* /etc/localtime */
 };
 
 /* Create new scheduler */
 BrightnessScheduler* scheduler_new(void)
 {
     BrightnessScheduler *scheduler = g_new0(BrightnessScheduler, 1);
-    scheduler->entries = NULL;
+    scheduler->entries = g_array_new(FALSE, FALSE, sizeof(ScheduleEntry));
+    scheduler->current_brightness = -1;
+    scheduler->clock_fd = -1;
     return scheduler;
 }
 
@@ -25,23 +58,41 @@ BrightnessScheduler* scheduler_new(void)
 void scheduler_free(BrightnessScheduler *scheduler)
 {
     if (scheduler) {
-        g_list_free_full(scheduler->entries, g_free);
+        scheduler_stop(scheduler);
+        g_array_free(scheduler->entries, TRUE);
         g_free(scheduler);
     }
 }
 
-/* Compare function for sorting schedule entries */
-static gint schedule_entry_compare(gconstpointer a, gconstpointer b)
+/* Seconds since local midnight for an entry */
+static int entry_seconds(const ScheduleEntry *entry)
 {
-    const ScheduleEntry *entry_a = (const ScheduleEntry*)a;
-    const ScheduleEntry *entry_b = (const ScheduleEntry*)b;
-    
-    int time_a = entry_a->hour * 60 + entry_a->minute;
-    int time_b = entry_b->hour * 60 + entry_b->minute;
-    
-    return time_a - time_b;
+    return (entry->hour * 60 + entry->minute) * 60;
 }
 
+/* Index of the entry at hour:minute, or of where it would be inserted */
+static guint find_entry(BrightnessScheduler *scheduler, int hour, int minute, gboolean *found)
+{
+    int seconds = (hour * 60 + minute) * 60;
+    guint low = 0;
+    guint high = scheduler->entries->len;
+
+    while (low < high) {
+        guint mid = (low + high) / 2;
+        if (entry_seconds(&g_array_index(scheduler->entries, ScheduleEntry, mid)) < seconds) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    *found = (low < scheduler->entries->len &&
+              entry_seconds(&g_array_index(scheduler->entries, ScheduleEntry, low)) == seconds);
+    return low;
+}
+
+static void scheduler_update(BrightnessScheduler *scheduler);
+
 /* Add time to schedule */
 void scheduler_add_time(BrightnessScheduler *scheduler, int hour, int minute, int brightness)
 {
@@ -49,27 +100,19 @@ void scheduler_add_time(BrightnessScheduler *scheduler, int hour, int minute, in
         brightness < 0 || brightness > 100) {
         return;
     }
-    
-    /* Check if entry already exists */
-    GList *item = scheduler->entries;
-    while (item) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
-        if (entry->hour == hour && entry->minute == minute) {
-            /* Update existing entry */
-            entry->brightness = brightness;
-            return;
-        }
-        item = item->next;
+
+    gboolean found;
+    guint index = find_entry(scheduler, hour, minute, &found);
+
+    if (found) {
+        /* Update existing entry */
+        g_array_index(scheduler->entries, ScheduleEntry, index).brightness = brightness;
+    } else {
+        ScheduleEntry entry = { hour, minute, brightness };
+        g_array_insert_val(scheduler->entries, index, entry);
     }
-    
-    /* Create new entry */
-    ScheduleEntry *entry = g_new(ScheduleEntry, 1);
-    entry->hour = hour;
-    entry->minute = minute;
-    entry->brightness = brightness;
-    
-    /* Insert in sorted order */
-    scheduler->entries = g_list_insert_sorted(scheduler->entries, entry, schedule_entry_compare);
+
+    scheduler_update(scheduler);
 }
 
 /* Remove time from schedule */
@@ -78,16 +121,12 @@ void scheduler_remove_time(BrightnessScheduler *scheduler, int hour, int minute)
     if (!scheduler) {
         return;
     }
-    
-    GList *item = scheduler->entries;
-    while (item) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
-        if (entry->hour == hour && entry->minute == minute) {
-            scheduler->entries = g_list_delete_link(scheduler->entries, item);
-            g_free(entry);
-            return;
-        }
-        item = item->next;
+
+    gboolean found;
+    guint index = find_entry(scheduler, hour, minute, &found);
+    if (found) {
+        g_array_remove_index(scheduler->entries, index);
+        scheduler_update(scheduler);
     }
 }
 
@@ -95,82 +134,290 @@ void scheduler_remove_time(BrightnessScheduler *scheduler, int hour, int minute)
 void scheduler_clear(BrightnessScheduler *scheduler)
 {
     if (scheduler) {
-        g_list_free_full(scheduler->entries, g_free);
-        scheduler->entries = NULL;
+        g_array_set_size(scheduler->entries, 0);
+        scheduler_update(scheduler);
     }
 }
 
-/* Get current brightness based on time */
-int scheduler_get_current_brightness(BrightnessScheduler *scheduler)
+/* Brightness at a local time of day (seconds since midnight, 0 - SECONDS_PER_DAY).
+ * Before the first entry the last entry's value holds over from the previous
+ * day; between entries the value is interpolated linearly. */
+int scheduler_get_brightness_at(BrightnessScheduler *scheduler, int seconds)
 {
-    if (!scheduler || !scheduler->entries) {
+    if (!scheduler || scheduler->entries->len == 0) {
         return -1;
     }
-    
-    /* Get current time */
-    time_t now_time = time(NULL);
-    struct tm *now_tm = localtime(&now_time);
-    int current_minutes = now_tm->tm_hour * 60 + now_tm->tm_min;
-    
-    GList *entries = scheduler->entries;
-    int count = g_list_length(entries);
-    
-    if (count == 0) {
-        return -1;
+
+    const ScheduleEntry *entries = (const ScheduleEntry*)scheduler->entries->data;
+    guint count = scheduler->entries->len;
+    const ScheduleEntry *last = &entries[count - 1];
+
+    if (count == 1 || seconds <= entry_seconds(&entries[0]) || seconds > entry_seconds(last)) {
+        return last->brightness;
     }
-    
-    if (count == 1) {
-        ScheduleEntry *entry = (ScheduleEntry*)entries->data;
-        return entry->brightness;
+
+    /* First entry at or after this time; entries[0] is strictly before it */
+    guint low = 1;
+    guint high = count - 1;
+    while (low < high) {
+        guint mid = (low + high) / 2;
+        if (entry_seconds(&entries[mid]) < seconds) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
-    
-    /* Find appropriate brightness value */
-    for (GList *item = entries; item; item = item->next) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
-        int entry_minutes = entry->hour * 60 + entry->minute;
-        
-        if (current_minutes <= entry_minutes) {
-            if (item == entries) {
-                /* Before first entry, use last entry from previous day */
-                GList *last = g_list_last(entries);
-                ScheduleEntry *last_entry = (ScheduleEntry*)last->data;
-                return last_entry->brightness;
+
+    const ScheduleEntry *prev = &entries[low - 1];
+    const ScheduleEntry *next = &entries[low];
+    int prev_seconds = entry_seconds(prev);
+
+    /* Linear interpolation */
+    double ratio = (double)(seconds - prev_seconds) / (double)(entry_seconds(next) - prev_seconds);
+    return (int)(prev->brightness + ratio * (next->brightness - prev->brightness));
+}
+
+/* First schedule boundary strictly after a time of day. Between consecutive
+ * boundaries the brightness is monotone. */
+static int next_boundary(BrightnessScheduler *scheduler, int seconds)
+{
+    for (guint i = 0; i < scheduler->entries->len; i++) {
+        int boundary = entry_seconds(&g_array_index(scheduler->entries, ScheduleEntry, i));
+        if (boundary > seconds) {
+            return boundary;
+        }
+    }
+    return SECONDS_PER_DAY;
+}
+
+/* Seconds from a time of day until the brightness next differs from its value
+ * then, or -1 if it never changes */
+gint64 scheduler_get_seconds_until_change(BrightnessScheduler *scheduler, int seconds)
+{
+    if (!scheduler || scheduler->entries->len < 2) {
+        return -1;
+    }
+
+    int value = scheduler_get_brightness_at(scheduler, seconds);
+    int position = seconds;
+
+    /* Walk at most one full day, one monotone segment at a time */
+    while (position < seconds + SECONDS_PER_DAY) {
+        int day_position = position % SECONDS_PER_DAY;
+        int segment_end = next_boundary(scheduler, day_position);
+        int low = day_position + 1;
+        int high = segment_end;
+
+        if (scheduler_get_brightness_at(scheduler, high % SECONDS_PER_DAY) == value &&
+            scheduler_get_brightness_at(scheduler, low) == value) {
+            position += segment_end - day_position;
+            continue;
+        }
+
+        /* The segment starts at the old value and leaves it: binary search the edge */
+        if (scheduler_get_brightness_at(scheduler, low) != value) {
+            high = low;
+        }
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (scheduler_get_brightness_at(scheduler, mid % SECONDS_PER_DAY) != value) {
+                high = mid;
             } else {
-                /* Interpolate between previous and current entry */
-                GList *prev_item = item->prev;
-                ScheduleEntry *prev_entry = (ScheduleEntry*)prev_item->data;
-                
-                int prev_minutes = prev_entry->hour * 60 + prev_entry->minute;
-                int next_minutes = entry_minutes;
-                
-                /* Linear interpolation */
-                double ratio = (double)(current_minutes - prev_minutes) / 
-                              (double)(next_minutes - prev_minutes);
-                
-                int brightness = (int)(prev_entry->brightness + 
-                                     ratio * (entry->brightness - prev_entry->brightness));
-                
-                return brightness;
+                low = mid + 1;
             }
         }
+        return (gint64)(position - day_position) + high - seconds;
     }
-    
-    /* After last entry, use last brightness */
-    GList *last = g_list_last(entries);
-    ScheduleEntry *last_entry = (ScheduleEntry*)last->data;
-    return last_entry->brightness;
+
+    return -1;
+}
+
+/* Local time of day in seconds */
+static int local_seconds_now(void)
+{
+    time_t now = time(NULL);
+    struct tm *now_tm = localtime(&now);
+    return (now_tm->tm_hour * 60 + now_tm->tm_min) * 60 + now_tm->tm_sec;
 }
 
-/* Get all schedule entries */
-GList* scheduler_get_entries(BrightnessScheduler *scheduler)
+/* Get current brightness based on time */
+int scheduler_get_current_brightness(BrightnessScheduler *scheduler)
 {
-    return scheduler ? scheduler->entries : NULL;
+    if (!scheduler) {
+        return -1;
+    }
+
+    /* While running, the value computed at the last deadline is current */
+    if (scheduler->change_func) {
+        return scheduler->current_brightness;
+    }
+    return scheduler_get_brightness_at(scheduler, local_seconds_now());
+}
+
+static gboolean on_schedule_deadline(gpointer data);
+
+/* Recompute the current value, notify if it changed and arm the next deadline */
+static void scheduler_update(BrightnessScheduler *scheduler)
+{
+    if (!scheduler->change_func) {
+        return;
+    }
+
+    if (scheduler->timeout_id > 0) {
+        g_source_remove(scheduler->timeout_id);
+        scheduler->timeout_id = 0;
+    }
+
+    int seconds = local_seconds_now();
+    int brightness = scheduler_get_brightness_at(scheduler, seconds);
+    gint64 delay = scheduler_get_seconds_until_change(scheduler, seconds);
+
+    if (delay < 0 || delay > SCHEDULER_MAX_SLEEP_SECONDS) {
+        delay = SCHEDULER_MAX_SLEEP_SECONDS;
+    }
+    scheduler->timeout_id = g_timeout_add_seconds((guint)delay, on_schedule_deadline, scheduler);
+    g_debug("Schedule: %d%% now, next check in %" G_GINT64_FORMAT " s", brightness, delay);
+
+    if (brightness != scheduler->current_brightness) {
+        scheduler->current_brightness = brightness;
+        if (brightness >= 0) {
+            scheduler->change_func(scheduler, brightness, scheduler->change_data);
+        }
+    }
+}
+
+/* The interpolated value is due to change */
+static gboolean on_schedule_deadline(gpointer data)
+{
+    BrightnessScheduler *scheduler = (BrightnessScheduler*)data;
+
+    scheduler->timeout_id = 0;
+    scheduler_update(scheduler);
+    return G_SOURCE_REMOVE;
+}
+
+/* Arm the clock-jump detector: an absolute CLOCK_REALTIME timer far in the
+ * future that the kernel cancels whenever the wall clock is set */
+static gboolean arm_clock_watch(BrightnessScheduler *scheduler)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = time(NULL) + 365 * SECONDS_PER_DAY;
+
+    return timerfd_settime(scheduler->clock_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                           &spec, NULL) == 0;
+}
+
+/* Wall clock was set: deadlines computed from the old time are wrong */
+static gboolean on_clock_changed(gint fd, GIOCondition condition, gpointer data)
+{
+    BrightnessScheduler *scheduler = (BrightnessScheduler*)data;
+    guint64 expirations;
+
+    (void)condition;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno == ECANCELED) {
+        g_message("System clock changed, re-arming brightness schedule");
+    }
+
+    arm_clock_watch(scheduler);
+    scheduler_update(scheduler);
+    return G_SOURCE_CONTINUE;
+}
+
+/* /etc/localtime changed: the time of day may have shifted */
+static void on_time_zone_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                                 GFileMonitorEvent event, gpointer data)
+{
+    (void)monitor;
+    (void)file;
+    (void)other_file;
+
+    if (event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT ||
+        event == G_FILE_MONITOR_EVENT_CREATED ||
+        event == G_FILE_MONITOR_EVENT_DELETED) {
+        g_message("Time zone changed, re-arming brightness schedule");
+        scheduler_update((BrightnessScheduler*)data);
+    }
+}
+
+/* Start deadline tracking */
+void scheduler_start(BrightnessScheduler *scheduler, SchedulerChangeFunc func, gpointer user_data)
+{
+    if (!scheduler || !func) {
+        return;
+    }
+
+    scheduler_stop(scheduler);
+    scheduler->change_func = func;
+    scheduler->change_data = user_data;
+    scheduler->current_brightness = -1;
+
+    scheduler->clock_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (scheduler->clock_fd >= 0 && arm_clock_watch(scheduler)) {
+        scheduler->clock_watch_id = g_unix_fd_add(scheduler->clock_fd, G_IO_IN, on_clock_changed, scheduler);
+    } else {
+        g_debug("Clock change notification unavailable; schedule relies on periodic re-arming");
+    }
+
+    GFile *zone_file = g_file_new_for_path("/etc/localtime");
+    scheduler->zone_monitor = g_file_monitor_file(zone_file, G_FILE_MONITOR_NONE, NULL, NULL);
+    g_object_unref(zone_file);
+    if (scheduler->zone_monitor) {
+        g_signal_connect(scheduler->zone_monitor, "changed", G_CALLBACK(on_time_zone_changed), scheduler);
+    }
+
+    scheduler_update(scheduler);
+}
+
+/* Stop deadline tracking */
+void scheduler_stop(BrightnessScheduler *scheduler)
+{
+    if (!scheduler) {
+        return;
+    }
+
+    if (scheduler->timeout_id > 0) {
+        g_source_remove(scheduler->timeout_id);
+        scheduler->timeout_id = 0;
+    }
+    if (scheduler->clock_watch_id > 0) {
+        g_source_remove(scheduler->clock_watch_id);
+        scheduler->clock_watch_id = 0;
+    }
+    if (scheduler->clock_fd >= 0) {
+        close(scheduler->clock_fd);
+        scheduler->clock_fd = -1;
+    }
+    if (scheduler->zone_monitor) {
+        g_file_monitor_cancel(scheduler->zone_monitor);
+        g_object_unref(scheduler->zone_monitor);
+        scheduler->zone_monitor = NULL;
+    }
+    scheduler->change_func = NULL;
+    scheduler->change_data = NULL;
+}
+
+/* Recompute after the monotonic clock lost track of wall time (resume) */
+void scheduler_rearm(BrightnessScheduler *scheduler)
+{
+    if (scheduler) {
+        scheduler_update(scheduler);
+    }
+}
+
+/* Get schedule entry by index (sorted by time) */
+const ScheduleEntry* scheduler_get_entry(BrightnessScheduler *scheduler, int index)
+{
+    if (!scheduler || index < 0 || (guint)index >= scheduler->entries->len) {
+        return NULL;
+    }
+    return &g_array_index(scheduler->entries, ScheduleEntry, index);
 }
 
 /* Get entry count */
 int scheduler_get_entry_count(BrightnessScheduler *scheduler)
 {
-    return scheduler ? g_list_length(scheduler->entries) : 0;
+    return scheduler ? (int)scheduler->entries->len : 0;
 }
 
 /* Load schedule from configuration */
@@ -238,8 +485,8 @@ gboolean scheduler_save_to_config(BrightnessScheduler *scheduler, AppConfig *con
     g_key_file_remove_group(keyfile, "Schedule", NULL);
     
     /* Save each entry */
-    for (GList *item = scheduler->entries; item; item = item->next) {
-        ScheduleEntry *entry = (ScheduleEntry*)item->data;
+    for (guint i = 0; i < scheduler->entries->len; i++) {
+        const ScheduleEntry *entry = &g_array_index(scheduler->entries, ScheduleEntry, i);
         
         char key[16];
         snprintf(key, sizeof(key), "%02d:%02d", entry->hour, entry->minute);
@@ -6,7 +6,6 @@
 #define SCHEDULER_H
 
 #include <glib.h>
-#include <gtk/gtk.h>
 #include "config.h"
 
 G_BEGIN_DECLS
@@ -30,20 +29,34 @@ void scheduler_add_time(BrightnessScheduler *scheduler, int hour, int minute, in
 void scheduler_remove_time(BrightnessScheduler *scheduler, int hour, int minute);
 void scheduler_clear(BrightnessScheduler *scheduler);
 
-/* Get current brightness based on time */
+/* Get current brightness based on time (the cached value while started) */
 int scheduler_get_current_brightness(BrightnessScheduler *scheduler);
 
-/* Get all schedule entries */
-GList* scheduler_get_entries(BrightnessScheduler *scheduler);
+/* Brightness at a local time of day, in seconds since midnight */
+int scheduler_get_brightness_at(BrightnessScheduler *scheduler, int seconds);
+
+/* Seconds from a time of day until the brightness next changes by at least
+ * 1%, or -1 if the schedule is constant */
+gint64 scheduler_get_seconds_until_change(BrightnessScheduler *scheduler, int seconds);
+
+/* Deadline tracking: func runs on the main loop whenever the scheduled
+ * brightness changes (and once on start). A single timeout is armed for the
+ * next change and re-armed on wall-clock jumps and time zone changes. */
+typedef void (*SchedulerChangeFunc)(BrightnessScheduler *scheduler, int brightness, gpointer user_data);
+void scheduler_start(BrightnessScheduler *scheduler, SchedulerChangeFunc func, gpointer user_data);
+void scheduler_stop(BrightnessScheduler *scheduler);
+
+/* Re-arm after the wall clock moved without notice (e.g. after resume) */
+void scheduler_rearm(BrightnessScheduler *scheduler);
+
+/* Schedule entries, sorted by time */
+const ScheduleEntry* scheduler_get_entry(BrightnessScheduler *scheduler, int index);
 int scheduler_get_entry_count(BrightnessScheduler *scheduler);
 
 /* Configuration integration */
 gboolean scheduler_load_from_config(BrightnessScheduler *scheduler, AppConfig *config);
 gboolean scheduler_save_to_config(BrightnessScheduler *scheduler, AppConfig *config);
 
-/* Schedule dialog */
-void show_schedule_dialog(GtkWidget *parent, BrightnessScheduler *scheduler, AppConfig *config);
-
 G_END_DECLS
 
 #endif /* SCHEDULER_H */
\ No newline at end of file
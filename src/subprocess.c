@@ -0,0 +1,222 @@
+/*
+ * subprocess.c - Shell-free child processes with deadlines
+ *
+ * ddccontrol can block forever on a wedged I2C transaction. Children are
+ * exec'd directly (no /bin/sh), their stdout is parsed as it arrives from a
+ * GIOChannel watch, and a per-command deadline kills them if they hang. The
+ * child is always reaped through a child watch, so a killed ddccontrol never
+ * leaves a zombie behind.
+ */
+
+/* kill() */
+#define _XOPEN_SOURCE 700
+
+#include "subprocess.h"
+#include <string.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* One running child */
+typedef struct {
+    GPid pid;
+    char *program;
+    GSource *timeout_source;
+    gboolean stdout_done;
+    gboolean child_done;
+    gboolean timed_out;
+    int wait_status;
+    SubprocessLineFunc line_func;
+    SubprocessDoneFunc done_func;
+    gpointer user_data;
+} Subprocess;
+
+/* Report the result once the child has exited and stdout hit EOF */
+static void subprocess_maybe_finish(Subprocess *proc)
+{
+    if (!proc->stdout_done || !proc->child_done) {
+        return;
+    }
+
+    if (proc->timeout_source) {
+        g_source_destroy(proc->timeout_source);
+        g_source_unref(proc->timeout_source);
+        proc->timeout_source = NULL;
+    }
+
+    gboolean success = !proc->timed_out &&
+                       WIFEXITED(proc->wait_status) && WEXITSTATUS(proc->wait_status) == 0;
+
+    if (proc->done_func) {
+        proc->done_func(success, proc->timed_out, proc->user_data);
+    }
+
+    g_free(proc->program);
+    g_free(proc);
+}
+
+/* Child stdout readable: hand complete lines to the parser */
+static gboolean on_subprocess_stdout(GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    Subprocess *proc = (Subprocess*)data;
+    (void)condition;
+
+    for (;;) {
+        char *line = NULL;
+        gsize terminator = 0;
+        GIOStatus status = g_io_channel_read_line(channel, &line, NULL, &terminator, NULL);
+
+        if (status == G_IO_STATUS_NORMAL) {
+            if (line) {
+                line[terminator] = '\0';
+                if (proc->line_func) {
+                    proc->line_func(line, proc->user_data);
+                }
+                g_free(line);
+            }
+            continue;
+        }
+
+        if (status == G_IO_STATUS_AGAIN) {
+            return G_SOURCE_CONTINUE;
+        }
+
+        /* EOF or read error: the pipe is finished either way */
+        g_free(line);
+        proc->stdout_done = TRUE;
+        subprocess_maybe_finish(proc);
+        return G_SOURCE_REMOVE;
+    }
+}
+
+/* Child exited (or was killed) */
+static void on_subprocess_exit(GPid pid, gint wait_status, gpointer data)
+{
+    Subprocess *proc = (Subprocess*)data;
+
+    g_spawn_close_pid(pid);
+    proc->wait_status = wait_status;
+    proc->child_done = TRUE;
+    subprocess_maybe_finish(proc);
+}
+
+/* Deadline passed: kill the child; the exit watch finishes the bookkeeping */
+static gboolean on_subprocess_timeout(gpointer data)
+{
+    Subprocess *proc = (Subprocess*)data;
+
+    g_source_unref(proc->timeout_source);
+    proc->timeout_source = NULL;
+
+    if (!proc->child_done) {
+        g_warning("%s (pid %d) did not finish in time, killing it", proc->program, (int)proc->pid);
+        proc->timed_out = TRUE;
+        kill(proc->pid, SIGKILL);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Start a child on the thread-default main context */
+gboolean subprocess_run_async(const char * const *argv, guint timeout_ms,
+                              SubprocessLineFunc line_func, SubprocessDoneFunc done_func,
+                              gpointer user_data)
+{
+    g_return_val_if_fail(argv != NULL && argv[0] != NULL, FALSE);
+
+    GPid pid;
+    int stdout_fd = -1;
+    GError *error = NULL;
+
+    if (!g_spawn_async_with_pipes(NULL, (char **)argv, NULL,
+                                  G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+                                  G_SPAWN_STDERR_TO_DEV_NULL,
+                                  NULL, NULL, &pid, NULL, &stdout_fd, NULL, &error)) {
+        g_warning("Failed to run %s: %s", argv[0], error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    GMainContext *context = g_main_context_get_thread_default();
+
+    Subprocess *proc = g_new0(Subprocess, 1);
+    proc->pid = pid;
+    proc->program = g_strdup(argv[0]);
+    proc->line_func = line_func;
+    proc->done_func = done_func;
+    proc->user_data = user_data;
+
+    GIOChannel *channel = g_io_channel_unix_new(stdout_fd);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    g_io_channel_set_encoding(channel, NULL, NULL);
+    g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
+
+    GSource *source = g_io_create_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR);
+    g_source_set_callback(source, G_SOURCE_FUNC(on_subprocess_stdout), proc, NULL);
+    g_source_attach(source, context);
+    g_source_unref(source);
+    g_io_channel_unref(channel);  /* Kept alive by the watch until EOF */
+
+    source = g_child_watch_source_new(pid);
+    g_source_set_callback(source, G_SOURCE_FUNC(on_subprocess_exit), proc, NULL);
+    g_source_attach(source, context);
+    g_source_unref(source);
+
+    if (timeout_ms > 0) {
+        proc->timeout_source = g_timeout_source_new(timeout_ms);
+        g_source_set_callback(proc->timeout_source, on_subprocess_timeout, proc, NULL);
+        g_source_attach(proc->timeout_source, context);
+    }
+
+    return TRUE;
+}
+
+/* State for a blocking run */
+typedef struct {
+    GMainLoop *loop;
+    gboolean success;
+    SubprocessLineFunc line_func;
+    gpointer user_data;
+} SubprocessSyncRun;
+
+static void on_subprocess_sync_line(const char *line, gpointer user_data)
+{
+    SubprocessSyncRun *run = (SubprocessSyncRun*)user_data;
+
+    if (run->line_func) {
+        run->line_func(line, run->user_data);
+    }
+}
+
+static void on_subprocess_sync_done(gboolean success, gboolean timed_out, gpointer user_data)
+{
+    SubprocessSyncRun *run = (SubprocessSyncRun*)user_data;
+    (void)timed_out;
+
+    run->success = success;
+    g_main_loop_quit(run->loop);
+}
+
+/* Run a child to completion on a private main context */
+gboolean subprocess_run_sync(const char * const *argv, guint timeout_ms,
+                             SubprocessLineFunc line_func, gpointer user_data)
+{
+    GMainContext *context = g_main_context_new();
+    g_main_context_push_thread_default(context);
+
+    SubprocessSyncRun run;
+    run.loop = g_main_loop_new(context, FALSE);
+    run.success = FALSE;
+    run.line_func = line_func;
+    run.user_data = user_data;
+
+    if (subprocess_run_async(argv, timeout_ms, on_subprocess_sync_line, on_subprocess_sync_done, &run)) {
+        g_main_loop_run(run.loop);
+    }
+
+    g_main_loop_unref(run.loop);
+    g_main_context_pop_thread_default(context);
+    g_main_context_unref(context);
+
+    return run.success;
+}
@@ -0,0 +1,36 @@
+/*
+ * subprocess.h - Shell-free child processes with deadlines
+ */
+
+#ifndef SUBPROCESS_H
+#define SUBPROCESS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Called for each line of the child's stdout (without the trailing newline) */
+typedef void (*SubprocessLineFunc)(const char *line, gpointer user_data);
+
+/* Called once the child has exited and its stdout is drained.
+ * success: exited with status 0 before the deadline.
+ * timed_out: the deadline passed and the child was killed. */
+typedef void (*SubprocessDoneFunc)(gboolean success, gboolean timed_out, gpointer user_data);
+
+/* Run argv[0] (looked up in PATH, no shell) with stdout streamed line by line
+ * into line_func from a main loop source; stderr is discarded. A child still
+ * running after timeout_ms is killed with SIGKILL. Sources are attached to the
+ * thread-default main context. Returns FALSE if the process could not be
+ * started, in which case done_func is not called. */
+gboolean subprocess_run_async(const char * const *argv, guint timeout_ms,
+                              SubprocessLineFunc line_func, SubprocessDoneFunc done_func,
+                              gpointer user_data);
+
+/* Blocking variant for worker threads: runs the child on a private main
+ * context and returns the success value passed to done_func. */
+gboolean subprocess_run_sync(const char * const *argv, guint timeout_ms,
+                             SubprocessLineFunc line_func, gpointer user_data);
+
+G_END_DECLS
+
+#endif /* SUBPROCESS_H */